@@ -0,0 +1,157 @@
+#ifndef CTDB_BENCH_BENCH_HPP
+#define CTDB_BENCH_BENCH_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace ctdb::bench {
+
+// maintained by replaced global operator new/delete (see main.cpp)
+struct allocation_counters {
+	uint64_t count;
+	uint64_t live_bytes;
+};
+
+auto allocations() noexcept -> allocation_counters;
+
+struct result {
+	std::string name;
+	size_t rows;
+	size_t ops;
+	double ns_per_op;
+	double allocs_per_op;
+	double bytes_per_record;
+};
+
+// one run of a benchmark with given number of rows
+class context {
+	size_t row_count;
+	std::vector<result> & output;
+
+public:
+	constexpr context(size_t rows, std::vector<result> & out) noexcept: row_count{rows}, output{out} { }
+
+	constexpr size_t rows() const noexcept {
+		return row_count;
+	}
+
+	// `fn` does `ops` operations, memory which stays allocated after it is reported per row
+	template <typename Fn> void measure(std::string_view name, size_t ops, Fn && fn) {
+		const auto before = allocations();
+		const auto start = std::chrono::steady_clock::now();
+
+		fn();
+
+		const auto finish = std::chrono::steady_clock::now();
+		const auto after = allocations();
+
+		const double nanoseconds = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start).count());
+		const double retained = static_cast<double>(after.live_bytes) - static_cast<double>(before.live_bytes);
+
+		ops = std::max(ops, size_t{1});
+
+		output.push_back(result{std::string{name}, row_count, ops, nanoseconds / static_cast<double>(ops), static_cast<double>(after.count - before.count) / static_cast<double>(ops), retained / static_cast<double>(std::max(row_count, size_t{1}))});
+	}
+};
+
+struct benchmark {
+	std::string_view name;
+	void (*run)(context &);
+};
+
+inline auto registry() -> std::vector<benchmark> & {
+	static std::vector<benchmark> benchmarks{};
+	return benchmarks;
+}
+
+struct registration {
+	registration(std::string_view name, void (*run)(context &)) {
+		registry().push_back(benchmark{name, run});
+	}
+};
+
+// keeps result of a computation alive, so it's not optimized away
+template <typename T> inline void do_not_optimize(const T & value) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+	asm volatile("" : : "r,m"(value) : "memory");
+#else
+	static const void * volatile sink = nullptr;
+	sink = &value;
+#endif
+}
+
+// datasets are always generated with the same seed, so runs are comparable between commits
+namespace dataset {
+
+	inline constexpr unsigned seed = 20240101u;
+
+	// unique keys in random order
+	inline auto keys(size_t rows) -> std::vector<std::string> {
+		std::vector<std::string> result{};
+		result.reserve(rows);
+
+		for (size_t i = 0z; i != rows; ++i) {
+			result.push_back("key" + std::to_string(i * 2654435761u % 1000000007u));
+		}
+
+		std::ranges::shuffle(result, std::mt19937{seed});
+		return result;
+	}
+
+	inline auto vocabulary() -> std::vector<std::string> {
+		constexpr std::string_view letters = "etaoinshrdlucmfwypvbgkqjxz";
+
+		std::mt19937 rng{seed};
+		std::vector<std::string> result{};
+
+		for (size_t i = 0z; i != 2000z; ++i) {
+			std::string word{};
+			const size_t length = 3z + rng() % 8u;
+
+			for (size_t c = 0z; c != length; ++c) {
+				// skewed towards common letters
+				word += letters[std::min(rng() % 26u, rng() % 26u)];
+			}
+
+			result.push_back(std::move(word));
+		}
+
+		return result;
+	}
+
+	// texts of 4 to 24 words with zipf-like distribution of words
+	inline auto documents(size_t rows) -> std::vector<std::string> {
+		const auto words = vocabulary();
+
+		std::mt19937 rng{seed + 1u};
+		std::vector<std::string> result{};
+		result.reserve(rows);
+
+		for (size_t i = 0z; i != rows; ++i) {
+			std::string text{};
+			const size_t count = 4z + rng() % 21u;
+
+			for (size_t w = 0z; w != count; ++w) {
+				const size_t rank = static_cast<size_t>(static_cast<double>(words.size()) * std::pow(std::generate_canonical<double, 32>(rng), 3.0));
+				text += words[std::min(rank, words.size() - 1z)];
+				text += ' ';
+			}
+
+			result.push_back(std::move(text));
+		}
+
+		return result;
+	}
+
+} // namespace dataset
+
+} // namespace ctdb::bench
+
+#endif
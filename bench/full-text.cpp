@@ -0,0 +1,74 @@
+#include "bench.hpp"
+#include <ctdb/indices/full-text.hpp>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace {
+
+template <size_t N> void fulltext_benchmark(ctdb::bench::context & ctx) {
+	using iterator = std::vector<std::string>::const_iterator;
+	using index_type = ctdb::simple_fulltext_reverse_index<iterator, N>;
+
+	const auto documents = ctdb::bench::dataset::documents(ctx.rows());
+
+	std::vector<std::pair<std::string_view, iterator>> batch{};
+	batch.reserve(documents.size());
+
+	for (auto it = documents.begin(); it != documents.end(); ++it) {
+		batch.emplace_back(*it, it);
+	}
+
+	index_type index;
+
+	ctx.measure("emplace_batch", documents.size(), [&] { index.emplace_batch(batch); });
+
+	// queries are words (and pairs of words) from the vocabulary, both frequent and rare ones
+	const auto words = ctdb::bench::dataset::vocabulary();
+
+	std::mt19937 rng{ctdb::bench::dataset::seed + 4u};
+	std::vector<std::string> queries{};
+
+	for (size_t i = 0z; i != 1000z; ++i) {
+		std::string query = words[rng() % words.size()];
+
+		if (i % 4z == 0z) {
+			query += ' ';
+			query += words[rng() % words.size()];
+		}
+
+		if (query.size() >= N) {
+			queries.push_back(std::move(query));
+		}
+	}
+
+	ctx.measure("find_all", queries.size(), [&] {
+		size_t found = 0z;
+
+		for (const auto & query: queries) {
+			found += index.find_all(std::string_view{query}).size();
+		}
+
+		ctdb::bench::do_not_optimize(found);
+	});
+
+	ctx.measure("find_documents", queries.size(), [&] {
+		size_t found = 0z;
+
+		for (const auto & query: queries) {
+			found += index.find_documents(std::string_view{query}).size();
+		}
+
+		ctdb::bench::do_not_optimize(found);
+	});
+}
+
+const ctdb::bench::registration fulltext2{"fulltext/2", fulltext_benchmark<2>};
+const ctdb::bench::registration fulltext3{"fulltext/3", fulltext_benchmark<3>};
+const ctdb::bench::registration fulltext4{"fulltext/4", fulltext_benchmark<4>};
+const ctdb::bench::registration fulltext5{"fulltext/5", fulltext_benchmark<5>};
+const ctdb::bench::registration fulltext6{"fulltext/6", fulltext_benchmark<6>};
+
+} // namespace
@@ -0,0 +1,172 @@
+#include "bench.hpp"
+#include <atomic>
+#include <charconv>
+#include <iostream>
+#include <new>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+
+// every allocation has a small header with its size, so live bytes can be tracked without allocator support
+namespace {
+
+std::atomic<uint64_t> allocation_count{0u};
+std::atomic<uint64_t> allocated_bytes{0u};
+
+constexpr size_t header_size = alignof(std::max_align_t);
+
+void * counted_allocate(size_t size) noexcept {
+	auto * block = static_cast<std::byte *>(std::malloc(size + header_size));
+
+	if (block == nullptr) {
+		return nullptr;
+	}
+
+	*reinterpret_cast<size_t *>(block) = size;
+
+	allocation_count.fetch_add(1u, std::memory_order_relaxed);
+	allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+
+	return block + header_size;
+}
+
+void counted_free(void * ptr) noexcept {
+	if (ptr == nullptr) {
+		return;
+	}
+
+	auto * block = static_cast<std::byte *>(ptr) - header_size;
+
+	allocated_bytes.fetch_sub(*reinterpret_cast<size_t *>(block), std::memory_order_relaxed);
+	std::free(block);
+}
+
+// allows 1e3 .. 1e7 notation, nothing for anything which isn't a list of non-negative numbers
+auto parse_sizes(std::string_view in) -> std::optional<std::vector<size_t>> {
+	std::vector<size_t> result{};
+
+	for (;;) {
+		const auto comma = in.find(',');
+		const auto part = in.substr(0, comma);
+
+		double value = 0.0;
+		const auto [end, ec] = std::from_chars(part.data(), part.data() + part.size(), value);
+
+		if (part.empty() || ec != std::errc{} || end != part.data() + part.size() || !(value >= 0.0 && value < 1e15)) {
+			return std::nullopt;
+		}
+
+		result.push_back(static_cast<size_t>(value));
+
+		if (comma == std::string_view::npos) {
+			return result;
+		}
+
+		in.remove_prefix(comma + 1z);
+	}
+}
+
+} // namespace
+
+void * operator new(size_t size) {
+	if (void * ptr = counted_allocate(size)) {
+		return ptr;
+	}
+
+	throw std::bad_alloc{};
+}
+
+void * operator new[](size_t size) {
+	return operator new(size);
+}
+
+void * operator new(size_t size, const std::nothrow_t &) noexcept {
+	return counted_allocate(size);
+}
+
+void * operator new[](size_t size, const std::nothrow_t &) noexcept {
+	return counted_allocate(size);
+}
+
+void operator delete(void * ptr) noexcept {
+	counted_free(ptr);
+}
+
+void operator delete[](void * ptr) noexcept {
+	counted_free(ptr);
+}
+
+void operator delete(void * ptr, size_t) noexcept {
+	counted_free(ptr);
+}
+
+void operator delete[](void * ptr, size_t) noexcept {
+	counted_free(ptr);
+}
+
+auto ctdb::bench::allocations() noexcept -> allocation_counters {
+	return {allocation_count.load(std::memory_order_relaxed), allocated_bytes.load(std::memory_order_relaxed)};
+}
+
+// usage: ctdb_bench [--rows 1e3,1e4,1e5] [--filter substring] [--list]
+// output is CSV (one line per measured operation), so results of two commits can be compared directly
+int main(int argc, char ** argv) {
+	std::vector<size_t> sizes{1000z, 10000z, 100000z};
+	std::string_view filter{};
+
+	const auto usage = [&] {
+		std::cerr << "usage: " << argv[0] << " [--rows 1e3,1e4,...] [--filter substring] [--list]\n";
+		return 1;
+	};
+
+	for (int i = 1; i < argc; ++i) {
+		const std::string_view arg{argv[i]};
+
+		if (arg == "--rows" && i + 1 < argc) {
+			auto parsed = parse_sizes(argv[++i]);
+
+			if (!parsed) {
+				std::cerr << "invalid number of rows: " << argv[i] << '\n';
+				return usage();
+			}
+
+			sizes = std::move(*parsed);
+		} else if (arg == "--filter" && i + 1 < argc) {
+			filter = argv[++i];
+		} else if (arg == "--list") {
+			for (const auto & b: ctdb::bench::registry()) {
+				std::cout << b.name << '\n';
+			}
+
+			return 0;
+		} else {
+			return usage();
+		}
+	}
+
+	std::cout << "benchmark,rows,ops,ns_per_op,allocs_per_op,bytes_per_record\n";
+
+	for (const auto & b: ctdb::bench::registry()) {
+		if (!filter.empty() && b.name.find(filter) == std::string_view::npos) {
+			continue;
+		}
+
+		for (const size_t rows: sizes) {
+			std::vector<ctdb::bench::result> results{};
+			ctdb::bench::context ctx{rows, results};
+
+			b.run(ctx);
+
+			for (const auto & r: results) {
+				char line[256];
+				std::snprintf(line, sizeof(line), "%.*s/%s,%zu,%zu,%.2f,%.3f,%.1f\n", static_cast<int>(b.name.size()), b.name.data(), r.name.c_str(), r.rows, r.ops, r.ns_per_op, r.allocs_per_op, r.bytes_per_record);
+				std::cout << line << std::flush;
+			}
+		}
+	}
+}
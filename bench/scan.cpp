@@ -0,0 +1,89 @@
+#include "bench.hpp"
+#include <ctdb/columnar-table.hpp>
+#include <ctdb/table.hpp>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct sale {
+	uint32_t id;
+	int32_t quantity;
+	double price;
+	std::string customer;
+
+	constexpr friend bool operator==(const sale &, const sale &) noexcept = default;
+};
+
+auto sales(size_t rows) -> std::vector<sale> {
+	const auto keys = ctdb::bench::dataset::keys(rows);
+
+	std::mt19937 rng{ctdb::bench::dataset::seed + 4u};
+	std::vector<sale> result{};
+	result.reserve(rows);
+
+	for (size_t i = 0z; i != rows; ++i) {
+		result.push_back(sale{static_cast<uint32_t>(i), static_cast<int32_t>(rng() % 100u), static_cast<double>(rng() % 10000u) / 100.0, keys[i]});
+	}
+
+	return result;
+}
+
+// unindexed filter and sum over one field: whole records in a list (serial and chunks in the pool) vs. two columns
+void row_scan_benchmark(ctdb::bench::context & ctx) {
+	const auto input = sales(ctx.rows());
+
+	ctdb::table<sale, ctdb::scan_chunks> tbl;
+
+	ctx.measure("emplace", input.size(), [&] {
+		for (const auto & s: input) {
+			tbl.emplace(s);
+		}
+	});
+
+	ctx.measure("filter_sum", tbl.size(), [&] {
+		double total = 0.0;
+
+		for (const sale & s: tbl.all()) {
+			if (s.quantity > 90) {
+				total += s.price;
+			}
+		}
+
+		ctdb::bench::do_not_optimize(total);
+	});
+
+	ctx.measure("parallel_filter_sum", tbl.size(), [&] {
+		const double total = tbl.reduce(0.0, std::plus<>{}, [](const sale & s) { return (s.quantity > 90) ? s.price : 0.0; }, &ctdb::support::default_pool());
+		ctdb::bench::do_not_optimize(total);
+	});
+
+	ctx.measure("parallel_count", tbl.size(), [&] {
+		const size_t count = tbl.count_if([](const sale & s) { return s.quantity > 90; }, &ctdb::support::default_pool());
+		ctdb::bench::do_not_optimize(count);
+	});
+}
+
+void columnar_scan_benchmark(ctdb::bench::context & ctx) {
+	const auto input = sales(ctx.rows());
+
+	ctdb::columnar_table<sale> tbl;
+
+	ctx.measure("emplace", input.size(), [&] {
+		for (const auto & s: input) {
+			tbl.insert(s);
+		}
+	});
+
+	ctx.measure("filter_sum", tbl.size(), [&] {
+		const double total = tbl.sum<2>(tbl.where<1>(std::greater<>{}, int32_t{90}));
+		ctdb::bench::do_not_optimize(total);
+	});
+}
+
+const ctdb::bench::registration row_scan{"scan/rows", row_scan_benchmark};
+const ctdb::bench::registration columnar_scan{"scan/columnar", columnar_scan_benchmark};
+
+} // namespace
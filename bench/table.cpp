@@ -0,0 +1,223 @@
+#include "bench.hpp"
+#include <ctdb/join.hpp>
+#include <ctdb/table.hpp>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+template <typename Index> void table_benchmark(ctdb::bench::context & ctx) {
+	using table_type = ctdb::table<std::string, Index>;
+	using primary_key = typename table_type::primary_key;
+
+	const auto keys = ctdb::bench::dataset::keys(ctx.rows());
+
+	table_type tbl;
+	std::vector<primary_key> inserted{};
+	inserted.reserve(keys.size());
+
+	ctx.measure("emplace", keys.size(), [&] {
+		for (const auto & key: keys) {
+			inserted.push_back(*tbl.emplace(key));
+		}
+	});
+
+	// lookups in different order than insertion
+	std::vector<std::string_view> queries(keys.begin(), keys.end());
+	std::ranges::shuffle(queries, std::mt19937{ctdb::bench::dataset::seed + 2u});
+
+	ctx.measure("equal", queries.size(), [&] {
+		size_t found = 0z;
+
+		for (const auto query: queries) {
+			found += tbl.equal(query).size();
+		}
+
+		ctdb::bench::do_not_optimize(found);
+	});
+
+	ctx.measure("all", tbl.size(), [&] {
+		size_t length = 0z;
+
+		for (const std::string & record: tbl.template all<std::string_view>()) {
+			length += record.size();
+		}
+
+		ctdb::bench::do_not_optimize(length);
+	});
+
+	std::ranges::shuffle(inserted, std::mt19937{ctdb::bench::dataset::seed + 3u});
+
+	ctx.measure("erase", inserted.size(), [&] {
+		for (const auto pkey: inserted) {
+			tbl.erase(pkey);
+		}
+	});
+}
+
+// low-cardinality view (few distinct values for many records)
+struct first_letter {
+	char value;
+
+	explicit constexpr first_letter(char c) noexcept: value{c} { }
+	explicit constexpr first_letter(std::string_view in) noexcept: value{in.empty() ? '\0' : in.front()} { }
+
+	constexpr friend bool operator==(first_letter, first_letter) noexcept = default;
+	constexpr friend auto operator<=>(first_letter, first_letter) noexcept = default;
+};
+
+template <typename Index> void low_cardinality_benchmark(ctdb::bench::context & ctx) {
+	using table_type = ctdb::table<std::string, Index>;
+	using primary_key = typename table_type::primary_key;
+
+	const auto keys = ctdb::bench::dataset::keys(ctx.rows());
+
+	table_type tbl;
+	std::vector<primary_key> inserted{};
+	inserted.reserve(keys.size());
+
+	ctx.measure("emplace", keys.size(), [&] {
+		for (const auto & key: keys) {
+			inserted.push_back(*tbl.emplace(key));
+		}
+	});
+
+	ctx.measure("equal", tbl.size(), [&] {
+		size_t length = 0z;
+
+		for (char c = 'a'; c <= 'z'; ++c) {
+			for (const std::string & record: tbl.equal(first_letter{c})) {
+				length += record.size();
+			}
+		}
+
+		ctdb::bench::do_not_optimize(length);
+	});
+
+	std::ranges::shuffle(inserted, std::mt19937{ctdb::bench::dataset::seed + 3u});
+
+	ctx.measure("erase", inserted.size(), [&] {
+		for (const auto pkey: inserted) {
+			tbl.erase(pkey);
+		}
+	});
+}
+
+// per-group sum of lengths: walk of a sorted index range vs. incrementally maintained aggregates
+struct name_length {
+	size_t value{0z};
+
+	constexpr name_length() noexcept = default;
+	explicit constexpr name_length(size_t v) noexcept: value{v} { }
+	explicit constexpr name_length(std::string_view in) noexcept: value{in.size()} { }
+
+	constexpr friend auto operator+(name_length lhs, name_length rhs) noexcept {
+		return name_length{lhs.value + rhs.value};
+	}
+
+	constexpr friend auto operator-(name_length lhs, name_length rhs) noexcept {
+		return name_length{lhs.value - rhs.value};
+	}
+};
+
+void group_sum_benchmark(ctdb::bench::context & ctx) {
+	using by_letter = ctdb::aggregate<first_letter, ctdb::aggregators::sum<name_length>>;
+	using table_type = ctdb::table<std::string, ctdb::sorted<first_letter>, by_letter>;
+
+	const auto keys = ctdb::bench::dataset::keys(ctx.rows());
+
+	table_type tbl;
+
+	ctx.measure("emplace", keys.size(), [&] {
+		for (const auto & key: keys) {
+			tbl.emplace(key);
+		}
+	});
+
+	ctx.measure("walk", 1z, [&] {
+		size_t length = 0z;
+
+		for (char c = 'a'; c <= 'z'; ++c) {
+			for (const std::string & record: tbl.equal(first_letter{c})) {
+				length += record.size();
+			}
+		}
+
+		ctdb::bench::do_not_optimize(length);
+	});
+
+	ctx.measure("aggregate", 1z, [&] {
+		size_t length = 0z;
+
+		for (char c = 'a'; c <= 'z'; ++c) {
+			length += tbl.aggregates<by_letter>().group(first_letter{c}).get<ctdb::aggregators::sum<name_length>>().value;
+		}
+
+		ctdb::bench::do_not_optimize(length);
+	});
+}
+
+// join of two tables with same keys: lookup of each record vs. merge of sorted indices vs. hash join
+void join_benchmark(ctdb::bench::context & ctx) {
+	const auto keys = ctdb::bench::dataset::keys(ctx.rows());
+
+	std::vector<std::string_view> shuffled(keys.begin(), keys.end());
+	std::ranges::shuffle(shuffled, std::mt19937{ctdb::bench::dataset::seed + 4u});
+
+	ctdb::table<std::string, ctdb::sorted<std::string_view>> left;
+	ctdb::table<std::string, ctdb::sorted<std::string_view>> sorted_right;
+	ctdb::table<std::string, ctdb::unique<std::string_view>> hashed_right;
+
+	for (const auto & key: keys) {
+		left.emplace(key);
+	}
+
+	for (const auto key: shuffled) {
+		sorted_right.emplace(key);
+		hashed_right.emplace(key);
+	}
+
+	ctx.measure("lookup", left.size(), [&] {
+		size_t length = 0z;
+
+		for (const std::string & record: left.all()) {
+			for (const std::string & other: sorted_right.equal(std::string_view{record})) {
+				length += other.size();
+			}
+		}
+
+		ctdb::bench::do_not_optimize(length);
+	});
+
+	ctx.measure("merge", left.size(), [&] {
+		size_t length = 0z;
+
+		for (const auto & [record, other]: ctdb::join(left, sorted_right, ctdb::on<std::string_view>)) {
+			length += other.size();
+		}
+
+		ctdb::bench::do_not_optimize(length);
+	});
+
+	ctx.measure("hash", left.size(), [&] {
+		size_t length = 0z;
+
+		for (const auto & [record, other]: ctdb::join(left, hashed_right, ctdb::on<std::string_view>)) {
+			length += other.size();
+		}
+
+		ctdb::bench::do_not_optimize(length);
+	});
+}
+
+const ctdb::bench::registration sorted_table{"table/sorted", table_benchmark<ctdb::sorted<std::string_view>>};
+const ctdb::bench::registration unique_sorted_table{"table/unique_sorted", table_benchmark<ctdb::unique_sorted<std::string_view>>};
+const ctdb::bench::registration unique_table{"table/unique", table_benchmark<ctdb::unique<std::string_view>>};
+const ctdb::bench::registration sorted_letter_table{"table/sorted_letter", low_cardinality_benchmark<ctdb::sorted<first_letter>>};
+const ctdb::bench::registration bitmap_letter_table{"table/bitmap_letter", low_cardinality_benchmark<ctdb::bitmap<first_letter>>};
+const ctdb::bench::registration group_sum_table{"table/group_sum", group_sum_benchmark};
+const ctdb::bench::registration join_table{"table/join", join_benchmark};
+
+} // namespace
@@ -0,0 +1,358 @@
+#ifndef CTDB_COLUMNAR_TABLE_HPP
+#define CTDB_COLUMNAR_TABLE_HPP
+
+#include "indices/support/simd.hpp"
+#include "support/aggregate.hpp"
+#include <algorithm>
+#include <bit>
+#include <iterator>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <concepts>
+
+namespace ctdb {
+
+// set of slots of a columnar table (one bit per slot), result of a scan
+class slot_selection {
+	std::vector<uint64_t> words{};
+	size_t count{0z};
+
+public:
+	constexpr slot_selection() noexcept = default;
+	constexpr slot_selection(std::vector<uint64_t> w, size_t c) noexcept: words{std::move(w)}, count{c} { }
+
+	class const_iterator {
+		const uint64_t * word{nullptr};
+		const uint64_t * last{nullptr};
+		uint64_t rest{0u};
+		size_t base{0z};
+
+		constexpr void settle() noexcept {
+			while (rest == 0u && word != last) {
+				if (++word != last) {
+					rest = *word;
+					base += 64z;
+				}
+			}
+		}
+
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = size_t;
+		using difference_type = std::ptrdiff_t;
+		using reference = size_t;
+		using pointer = void;
+
+		constexpr const_iterator() noexcept = default;
+
+		constexpr const_iterator(const uint64_t * w, const uint64_t * l) noexcept: word{w}, last{l}, rest{(w != l) ? *w : 0u} {
+			settle();
+		}
+
+		constexpr size_t operator*() const noexcept {
+			return base + static_cast<size_t>(std::countr_zero(rest));
+		}
+
+		constexpr const_iterator & operator++() noexcept {
+			rest &= rest - 1u;
+			settle();
+			return *this;
+		}
+
+		constexpr const_iterator operator++(int) noexcept {
+			auto copy = *this;
+			++*this;
+			return copy;
+		}
+
+		friend constexpr bool operator==(const const_iterator & lhs, const const_iterator & rhs) noexcept {
+			return lhs.word == rhs.word && lhs.rest == rhs.rest;
+		}
+	};
+
+	constexpr auto begin() const noexcept -> const_iterator {
+		return {words.data(), words.data() + words.size()};
+	}
+
+	constexpr auto end() const noexcept -> const_iterator {
+		return {words.data() + words.size(), words.data() + words.size()};
+	}
+
+	constexpr size_t size() const noexcept {
+		return count;
+	}
+
+	constexpr bool empty() const noexcept {
+		return count == 0z;
+	}
+
+	constexpr bool contains(size_t slot) const noexcept {
+		return slot / 64z < words.size() && ((words[slot / 64z] >> (slot % 64z)) & 1u);
+	}
+
+	constexpr auto bits() const noexcept -> std::span<const uint64_t> {
+		return words;
+	}
+
+	// slots in both (selections from a table which grew in between are fine, missing words are empty)
+	friend auto operator&(const slot_selection & lhs, const slot_selection & rhs) -> slot_selection {
+		const size_t common = std::min(lhs.words.size(), rhs.words.size());
+		std::vector<uint64_t> result(common);
+
+		const size_t c = support::combine_words(lhs.words.data(), rhs.words.data(), result.data(), common, support::and_words{});
+		return {std::move(result), c};
+	}
+
+	// slots in any of them
+	friend auto operator|(const slot_selection & lhs, const slot_selection & rhs) -> slot_selection {
+		const auto & longer = (lhs.words.size() >= rhs.words.size()) ? lhs : rhs;
+		const auto & shorter = (lhs.words.size() >= rhs.words.size()) ? rhs : lhs;
+
+		std::vector<uint64_t> result = longer.words;
+		size_t c = support::combine_words(lhs.words.data(), rhs.words.data(), result.data(), shorter.words.size(), support::or_words{});
+
+		for (size_t i = shorter.words.size(); i != result.size(); ++i) {
+			c += static_cast<size_t>(std::popcount(result[i]));
+		}
+
+		return {std::move(result), c};
+	}
+
+	slot_selection & operator&=(const slot_selection & other) {
+		return *this = (*this & other);
+	}
+
+	slot_selection & operator|=(const slot_selection & other) {
+		return *this = (*this | other);
+	}
+};
+
+// 64bit accumulator for integers (so sum of 32bit values doesn't overflow), same type otherwise
+template <typename T> struct column_accumulator {
+	using type = T;
+};
+
+template <std::signed_integral T> struct column_accumulator<T> {
+	using type = int64_t;
+};
+
+template <std::unsigned_integral T> struct column_accumulator<T> {
+	using type = uint64_t;
+};
+
+template <> struct column_accumulator<bool> {
+	using type = size_t;
+};
+
+template <typename T> using column_accumulator_t = typename column_accumulator<T>::type;
+
+template <typename Tuple> struct columns_of;
+
+template <typename... Fields> struct columns_of<std::tuple<Fields...>> {
+	using type = std::tuple<std::vector<Fields>...>;
+};
+
+// aggregate records stored as columns (struct of arrays), one contiguous vector for each field:
+// - records are addressed by slot id, which is stable until the record is erased (then it's reused)
+// - scans read only columns they need, comparisons of 32bit and floating point fields with
+//   std comparison functors run as SIMD kernels and produce a `slot_selection`
+// - records are not stored as a whole, `get` assembles a copy of one
+// fields must be nothrow move constructible (record is built first and then moved into columns)
+template <support::decomposable_aggregate Record> class columnar_table {
+public:
+	using record_type = Record;
+	using slot_type = size_t;
+	using field_types = support::field_types<Record>;
+
+	static constexpr size_t field_count = support::field_count<Record>;
+
+	template <size_t I> using field_type = std::tuple_element_t<I, field_types>;
+
+private:
+	static_assert([]<size_t... I>(std::index_sequence<I...>) { return (std::is_nothrow_move_constructible_v<field_type<I>> && ...); }(std::make_index_sequence<field_count>{}));
+
+	typename columns_of<field_types>::type columns{};
+
+	// bit for each used slot
+	std::vector<uint64_t> alive{};
+	std::vector<slot_type> free_slots{};
+	size_t live{0z};
+
+	using field_indices = std::make_index_sequence<field_count>;
+
+public:
+	constexpr size_t size() const noexcept {
+		return live;
+	}
+
+	constexpr bool empty() const noexcept {
+		return live == 0z;
+	}
+
+	// number of slots (used or free), length of each column
+	constexpr size_t slot_count() const noexcept {
+		return std::get<0>(columns).size();
+	}
+
+	void reserve(size_t n) {
+		[&]<size_t... I>(std::index_sequence<I...>) { (std::get<I>(columns).reserve(n), ...); }(field_indices{});
+		alive.reserve((n + 63z) / 64z);
+	}
+
+	auto insert(Record record) -> slot_type {
+		auto fields = support::tie_fields(record);
+
+		if (!free_slots.empty()) {
+			const slot_type slot = free_slots.back();
+			free_slots.pop_back();
+
+			[&]<size_t... I>(std::index_sequence<I...>) { ((std::get<I>(columns)[slot] = std::move(std::get<I>(fields))), ...); }(field_indices{});
+			mark(slot);
+			return slot;
+		}
+
+		const slot_type slot = slot_count();
+
+		// all allocations happen before the first column is changed, moves don't throw
+		if (full(field_indices{})) {
+			reserve(std::max(slot * 2z, size_t{64}));
+		}
+
+		if (slot / 64z == alive.size()) {
+			alive.push_back(0u);
+		}
+
+		[&]<size_t... I>(std::index_sequence<I...>) { (std::get<I>(columns).push_back(std::move(std::get<I>(fields))), ...); }(field_indices{});
+		mark(slot);
+		return slot;
+	}
+
+	template <typename... Args>
+	requires requires(Args &&... args) { Record{std::forward<Args>(args)...}; }
+	auto emplace(Args &&... args) -> slot_type {
+		return insert(Record{std::forward<Args>(args)...});
+	}
+
+	// values of an erased record are reset (if they can be), so they don't keep their memory
+	bool erase(slot_type slot) {
+		if (!contains(slot)) {
+			return false;
+		}
+
+		free_slots.push_back(slot);
+
+		alive[slot / 64z] &= ~(uint64_t{1} << (slot % 64z));
+		--live;
+
+		[&]<size_t... I>(std::index_sequence<I...>) {
+			(
+				[&] {
+					if constexpr (std::is_nothrow_default_constructible_v<field_type<I>>) {
+						std::get<I>(columns)[slot] = field_type<I>{};
+					}
+				}(),
+				...);
+		}(field_indices{});
+
+		return true;
+	}
+
+	constexpr bool contains(slot_type slot) const noexcept {
+		return slot / 64z < alive.size() && ((alive[slot / 64z] >> (slot % 64z)) & 1u);
+	}
+
+	// copy of the record assembled from its columns
+	auto get(slot_type slot) const -> Record {
+		assert(contains(slot));
+		return [&]<size_t... I>(std::index_sequence<I...>) { return Record{std::get<I>(columns)[slot]...}; }(field_indices{});
+	}
+
+	template <size_t I> constexpr auto field(slot_type slot) const noexcept -> const field_type<I> & {
+		assert(contains(slot));
+		return std::get<I>(columns)[slot];
+	}
+
+	// whole column including free slots (use with a selection)
+	template <size_t I> constexpr auto column() const noexcept -> std::span<const field_type<I>> {
+		return std::get<I>(columns);
+	}
+
+	auto all() const -> slot_selection {
+		return {alive, live};
+	}
+
+	// records where `op(field, value)` is true
+	// (vectorized for 32bit integers, float and double compared with a value of the same type using std::less<> etc.)
+	template <size_t I, typename Op, typename T> auto where(Op op, const T & value) const -> slot_selection {
+		const auto & data = std::get<I>(columns);
+
+		std::vector<uint64_t> result(alive.size());
+		support::compare_to_bits(data.data(), data.size(), value, op, result.data());
+
+		const size_t c = support::combine_words(result.data(), alive.data(), result.data(), result.size(), support::and_words{});
+		return {std::move(result), c};
+	}
+
+	// records where `pred(field)` is true
+	template <size_t I, typename Pred> auto where(Pred pred) const -> slot_selection {
+		return where<I>([&](const field_type<I> & lhs, std::nullptr_t) { return pred(lhs); }, nullptr);
+	}
+
+	// tuples of selected fields for each record of the selection (in order of slots)
+	template <size_t... I> auto project(const slot_selection & selection) const -> std::vector<std::tuple<field_type<I>...>> {
+		std::vector<std::tuple<field_type<I>...>> result{};
+		result.reserve(selection.size());
+
+		for (const slot_type slot: selection) {
+			result.emplace_back(std::get<I>(columns)[slot]...);
+		}
+
+		return result;
+	}
+
+	// sum of a field over the selection (full words of the selection are summed as a contiguous block)
+	template <size_t I> auto sum(const slot_selection & selection) const -> column_accumulator_t<field_type<I>> {
+		using result_type = column_accumulator_t<field_type<I>>;
+
+		const auto & data = std::get<I>(columns);
+		const auto bits = selection.bits();
+
+		result_type result{};
+
+		for (size_t w = 0z; w != bits.size(); ++w) {
+			if (bits[w] == ~uint64_t{0}) {
+				for (size_t j = 0z; j != 64z; ++j) {
+					result += static_cast<result_type>(data[w * 64z + j]);
+				}
+
+				continue;
+			}
+
+			for (uint64_t word = bits[w]; word != 0u; word &= word - 1u) {
+				result += static_cast<result_type>(data[w * 64z + static_cast<size_t>(std::countr_zero(word))]);
+			}
+		}
+
+		return result;
+	}
+
+private:
+	template <size_t... I> constexpr bool full(std::index_sequence<I...>) const noexcept {
+		return ((std::get<I>(columns).size() == std::get<I>(columns).capacity()) || ...);
+	}
+
+	void mark(slot_type slot) noexcept {
+		alive[slot / 64z] |= uint64_t{1} << (slot % 64z);
+		++live;
+	}
+};
+
+} // namespace ctdb
+
+#endif
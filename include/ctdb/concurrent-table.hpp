@@ -0,0 +1,275 @@
+#ifndef CTDB_CONCURRENT_TABLE_HPP
+#define CTDB_CONCURRENT_TABLE_HPP
+
+#include "support/hash.hpp"
+#include "support/slot-storage.hpp"
+#include "table.hpp"
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+#include <cstdint>
+
+namespace ctdb {
+
+// one index split into independently locked stripes by hash of its view
+// sorted indices can't be split this way (their order goes across all stripes), they have only one stripe
+template <typename Index, typename PKey, size_t Stripes> struct striped_index {
+	using index_traits = index_storage_traits_of<Index>;
+	using storage_type = index_storage_of<Index, PKey>;
+	using helper = index_helper<index_traits, PKey>;
+
+	static constexpr size_t stripe_count = is_sorted_container<storage_type> ? 1z : Stripes;
+
+	struct stripe {
+		mutable std::mutex lock{};
+		storage_type data{};
+	};
+
+	std::array<stripe, stripe_count> stripes{};
+
+	// equal values (and records with equal views) always end in the same stripe
+	template <typename T> static constexpr size_t stripe_of(const T & value) noexcept {
+		if constexpr (stripe_count == 1z) {
+			return 0z;
+		} else {
+			return support::bucket_of(static_cast<uint64_t>(typename storage_type::hasher{}(value)), stripe_count);
+		}
+	}
+};
+
+template <typename PKey, size_t Stripes, typename...> struct concurrent_indices;
+
+template <typename PKey, size_t Stripes> struct concurrent_indices<PKey, Stripes> {
+	static constexpr size_t index_count = 0z;
+
+	constexpr void collect_locks(PKey, std::mutex **) const noexcept { }
+
+	constexpr bool insert(PKey) const noexcept {
+		return true;
+	}
+
+	constexpr bool remove(PKey) const noexcept {
+		return true;
+	}
+
+	template <typename Type> constexpr void equal(const Type &, std::vector<PKey> &) const noexcept {
+		static_assert(type_is_not_compatible_with_any_index<Type>);
+	}
+
+	template <typename Type> constexpr auto size() const noexcept -> size_t {
+		static_assert(type_is_not_compatible_with_any_index<Type>);
+		return 0z;
+	}
+};
+
+// same all or nothing insertion as `indices_tuple`, but caller must hold locks of all stripes where the key belongs
+template <typename PKey, size_t Stripes, typename Head, typename... Tail> struct concurrent_indices<PKey, Stripes, Head, Tail...> {
+	using index_type = striped_index<Head, PKey, Stripes>;
+	using helper = typename index_type::helper;
+
+	index_type head;
+	concurrent_indices<PKey, Stripes, Tail...> tail;
+
+	static constexpr size_t index_count = 1z + concurrent_indices<PKey, Stripes, Tail...>::index_count;
+
+	// one mutex per index, written into `output[0 .. index_count)`
+	void collect_locks(PKey key, std::mutex ** output) const noexcept {
+		output[0] = &head.stripes[index_type::stripe_of(key)].lock;
+		tail.collect_locks(key, output + 1);
+	}
+
+	bool insert(PKey key) {
+		auto & data = head.stripes[index_type::stripe_of(key)].data;
+		const auto opt_it = helper::insert(data, key);
+
+		if (!opt_it) {
+			return false;
+		}
+
+		if (!tail.insert(key)) {
+			helper::remove(data, *opt_it);
+			return false;
+		}
+
+		return true;
+	}
+
+	bool remove(PKey key) noexcept {
+		auto & data = head.stripes[index_type::stripe_of(key)].data;
+		const auto it = helper::find(data, key);
+
+		if (it == helper::end(data)) {
+			return false;
+		}
+
+		if (!tail.remove(key)) {
+			return false;
+		}
+
+		helper::remove(data, it);
+
+		return true;
+	}
+
+	// only the stripe which can contain the value is locked
+	template <typename Type> void equal(const Type & value, std::vector<PKey> & output) const {
+		if constexpr (helper::template compatible_type<Type>) {
+			const auto & s = head.stripes[index_type::stripe_of(value)];
+
+			std::lock_guard _{s.lock};
+			const auto [first, last] = helper::equal_range(s.data, value);
+			output.insert(output.end(), first, last);
+
+		} else {
+			tail.equal(value, output);
+		}
+	}
+
+	template <typename Type> size_t size() const {
+		if constexpr (helper::template compatible_type<Type>) {
+			size_t result = 0z;
+
+			for (const auto & s: head.stripes) {
+				std::lock_guard _{s.lock};
+				result += helper::size(s.data);
+			}
+
+			return result;
+
+		} else {
+			return tail.template size<Type>();
+		}
+	}
+};
+
+// record with generation of its slot, a key of an erased record never refers to a record which reused the slot
+template <typename Record> struct concurrent_key {
+	Record * record{nullptr};
+	uint64_t generation{0u};
+
+	constexpr auto operator*() const noexcept -> Record & {
+		return *record;
+	}
+
+	constexpr auto operator->() const noexcept -> Record * {
+		return record;
+	}
+
+	friend constexpr bool operator==(concurrent_key, concurrent_key) noexcept = default;
+};
+
+// table which can be modified from many threads at once:
+// - records are allocated from per-thread blocks of slots (no shared lock per record)
+// - hashed indices (`unique<T>`) are split into lock-striped parts, sorted indices have one lock each
+// - insertion locks exactly one stripe in each index (in address order, so it can't deadlock)
+//   and then it's same all or nothing insertion as in `table`
+// returned records stay valid until they are erased
+template <typename Record, typename... Indices> class concurrent_table {
+public:
+	using record_type = Record;
+	using primary_key = concurrent_key<Record>;
+
+	static constexpr size_t stripes = 64z;
+
+private:
+	using indices_type = concurrent_indices<primary_key, stripes, Indices...>;
+
+	support::slot_storage<record_type> content{};
+	indices_type indices{};
+
+	// locks all stripes where the key belongs
+	class key_lock {
+		std::array<std::mutex *, indices_type::index_count> mutexes{};
+
+	public:
+		key_lock(const indices_type & idx, primary_key key) noexcept {
+			idx.collect_locks(key, mutexes.data());
+			std::ranges::sort(mutexes, std::less<>{});
+
+			for (std::mutex * m: mutexes) {
+				m->lock();
+			}
+		}
+
+		key_lock(const key_lock &) = delete;
+		key_lock & operator=(const key_lock &) = delete;
+
+		~key_lock() noexcept {
+			for (auto it = mutexes.rbegin(); it != mutexes.rend(); ++it) {
+				(*it)->unlock();
+			}
+		}
+	};
+
+public:
+	concurrent_table() = default;
+
+	concurrent_table(const concurrent_table &) = delete;
+	concurrent_table & operator=(const concurrent_table &) = delete;
+
+	template <typename... Args> auto emplace(Args &&... args) -> std::optional<primary_key> {
+		Record * const record = content.emplace(std::forward<Args>(args)...);
+		const primary_key key{record, content.generation(record)};
+
+		bool inserted = false;
+
+		{
+			const key_lock _{indices, key};
+			inserted = indices.insert(key);
+		}
+
+		if (!inserted) {
+			// nobody else has seen the record
+			content.erase(record);
+			return std::nullopt;
+		}
+
+		return key;
+	}
+
+	// returns false for a key which was already erased, even when its slot holds another record now
+	// (erasing same key from more threads at once is not allowed)
+	bool erase(primary_key key) noexcept {
+		if (!content.contains(key.record, key.generation)) {
+			// record is gone, its views can't be computed anymore
+			return false;
+		}
+
+		{
+			const key_lock _{indices, key};
+
+			if (!indices.remove(key)) {
+				return false;
+			}
+		}
+
+		content.erase(key.record);
+		return true;
+	}
+
+	size_t size() const noexcept {
+		return content.size();
+	}
+
+	template <typename Type> size_t size() const {
+		return indices.template size<Type>();
+	}
+
+	template <typename Type> auto equal(const Type & value) const -> merged_range<primary_key> {
+		merged_range<primary_key> result{};
+		indices.equal(value, result.keys);
+		return result;
+	}
+
+	template <typename Type> auto operator==(const Type & value) const {
+		return equal<Type>(value);
+	}
+};
+
+} // namespace ctdb
+
+#endif
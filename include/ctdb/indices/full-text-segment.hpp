@@ -0,0 +1,279 @@
+#ifndef CTDB_INDICES_FULLTEXT_SEGMENT_HPP
+#define CTDB_INDICES_FULLTEXT_SEGMENT_HPP
+
+#include "full-text.hpp"
+#include "support/mapped-file.hpp"
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <vector>
+#include <cstdint>
+
+namespace ctdb {
+
+// immutable full-text segment file, which is searched directly from mapped memory
+// layout (native endianity, checked by `byte_order`):
+// - header
+// - offsets: uint64_t[ngrams + 1] (postings of ngram `i` are in range [offsets[i], offsets[i+1]))
+// - postings: fulltext_posting[postings] (sorted by document and position for each ngram)
+// - keys: char[ngrams][N] (sorted same way as `support::ngram<N>`)
+// documents are identified by uint32_t ids provided by the writer, as records can't be persisted
+
+struct fulltext_posting {
+	uint32_t document;
+	uint32_t position;
+
+	friend constexpr bool operator==(fulltext_posting, fulltext_posting) noexcept = default;
+	friend constexpr auto operator<=>(fulltext_posting, fulltext_posting) noexcept = default;
+};
+
+struct fulltext_segment_header {
+	static constexpr std::array<char, 8> expected_magic{'c', 't', 'd', 'b', 'f', 't', 's', '1'};
+	static constexpr uint32_t expected_byte_order = 0x01020304u;
+
+	std::array<char, 8> magic{expected_magic};
+	uint32_t byte_order{expected_byte_order};
+	uint32_t ngram_size{0u};
+	uint64_t ngrams{0u};
+	uint64_t postings{0u};
+	uint64_t documents{0u};
+
+	constexpr size_t offsets_begin() const noexcept {
+		return sizeof(fulltext_segment_header);
+	}
+
+	constexpr size_t postings_begin() const noexcept {
+		return offsets_begin() + (ngrams + 1u) * sizeof(uint64_t);
+	}
+
+	constexpr size_t keys_begin() const noexcept {
+		return postings_begin() + postings * sizeof(fulltext_posting);
+	}
+
+	constexpr size_t file_size() const noexcept {
+		return keys_begin() + ngrams * ngram_size;
+	}
+};
+
+static_assert(sizeof(fulltext_segment_header) % alignof(uint64_t) == 0z);
+static_assert(sizeof(fulltext_posting) == 8z);
+
+// write content of the index into a segment file, `document_id(pkey)` gives id of each document
+// removed documents are not written, file is written and synced next to the destination and then renamed,
+// so readers never see partial file (not even after a crash), temporary file is removed when anything fails
+// (returns false also when the directory couldn't be synced, then the new file might not survive a crash)
+template <typename PKey, size_t N, typename DocumentId> bool write_fulltext_segment(const std::filesystem::path & path, const simple_fulltext_reverse_index<PKey, N> & index, DocumentId && document_id) {
+	fulltext_segment_header header{};
+	header.ngram_size = static_cast<uint32_t>(N);
+
+	std::vector<uint64_t> offsets{0u};
+	std::vector<fulltext_posting> postings{};
+	std::vector<char> keys{};
+	std::vector<uint32_t> documents{};
+
+	offsets.reserve(index.data.size() + 1z);
+	postings.reserve(index.ngram_count());
+	keys.reserve(index.data.size() * N);
+
+	for (const auto & [ngram, entries]: index.data) {
+		const size_t first = postings.size();
+
+		for (const auto & e: entries) {
+			if (index.is_removed(e)) {
+				continue;
+			}
+
+			const auto id = static_cast<uint32_t>(document_id(e.pkey));
+			postings.push_back(fulltext_posting{id, e.position});
+			documents.push_back(id);
+		}
+
+		if (postings.size() == first) {
+			continue;
+		}
+
+		// entries in the index are ordered by address of records, not by their id
+		std::sort(postings.begin() + static_cast<ptrdiff_t>(first), postings.end());
+
+		offsets.push_back(postings.size());
+		keys.insert(keys.end(), ngram.value.begin(), ngram.value.end());
+	}
+
+	std::sort(documents.begin(), documents.end());
+
+	header.ngrams = offsets.size() - 1z;
+	header.postings = postings.size();
+	header.documents = static_cast<uint64_t>(std::unique(documents.begin(), documents.end()) - documents.begin());
+
+	auto temporary = path;
+	temporary += ".tmp";
+
+	std::error_code ec{};
+
+	const auto fail = [&] {
+		std::filesystem::remove(temporary, ec);
+		return false;
+	};
+
+	// content must be on the disk before it's published under the final name
+	if (!support::write_synced_file(temporary.c_str(), {std::as_bytes(std::span{&header, 1z}), std::as_bytes(std::span{offsets}), std::as_bytes(std::span{postings}), std::as_bytes(std::span{keys})})) {
+		return fail();
+	}
+
+	std::filesystem::rename(temporary, path, ec);
+
+	if (ec) {
+		return fail();
+	}
+
+	// and the rename itself must survive a crash too
+	const auto directory = path.has_parent_path() ? path.parent_path() : std::filesystem::path{"."};
+	return support::sync_directory(directory.c_str());
+}
+
+// read-only view of a segment file, nothing is deserialized, all lookups go directly to mapped pages
+template <size_t N> struct fulltext_segment {
+	using entry = fulltext_posting;
+
+	support::mapped_file file{};
+	const fulltext_segment_header * header{nullptr};
+	const uint64_t * offsets{nullptr};
+	const fulltext_posting * postings{nullptr};
+	const char * keys{nullptr};
+
+	static auto open(const std::filesystem::path & path) -> std::optional<fulltext_segment> {
+		auto file = support::mapped_file::open(path.c_str());
+
+		if (!file) {
+			return std::nullopt;
+		}
+
+		const auto bytes = file->bytes();
+
+		if (bytes.size() < sizeof(fulltext_segment_header)) {
+			return std::nullopt;
+		}
+
+		fulltext_segment result{};
+		result.header = reinterpret_cast<const fulltext_segment_header *>(bytes.data());
+
+		const auto & h = *result.header;
+
+		if (h.magic != fulltext_segment_header::expected_magic || h.byte_order != fulltext_segment_header::expected_byte_order || h.ngram_size != N) {
+			return std::nullopt;
+		}
+
+		// counts are limited so size calculation can't overflow
+		if (h.ngrams > bytes.size() || h.postings > bytes.size() || h.file_size() != bytes.size()) {
+			return std::nullopt;
+		}
+
+		result.offsets = reinterpret_cast<const uint64_t *>(bytes.data() + h.offsets_begin());
+		result.postings = reinterpret_cast<const fulltext_posting *>(bytes.data() + h.postings_begin());
+		result.keys = reinterpret_cast<const char *>(bytes.data() + h.keys_begin());
+
+		if (result.offsets[0] != 0u || result.offsets[h.ngrams] != h.postings) {
+			return std::nullopt;
+		}
+
+		result.file = std::move(*file);
+		return result;
+	}
+
+	size_t ngram_known() const noexcept {
+		return header->ngrams;
+	}
+
+	size_t ngram_count() const noexcept {
+		return header->postings;
+	}
+
+	size_t document_count() const noexcept {
+		return header->documents;
+	}
+
+	auto key(size_t i) const noexcept -> support::ngram<N> {
+		return support::ngram<N>{keys + i * N};
+	}
+
+	// binary search in the dictionary, returns all postings of the ngram
+	auto find_ngram(support::ngram<N> value) const noexcept -> std::span<const fulltext_posting> {
+		size_t lo = 0z;
+		size_t hi = header->ngrams;
+
+		while (lo < hi) {
+			const size_t mid = lo + (hi - lo) / 2z;
+
+			if (key(mid) < value) {
+				lo = mid + 1z;
+			} else {
+				hi = mid;
+			}
+		}
+
+		if (lo == header->ngrams || key(lo) != value) {
+			return {};
+		}
+
+		const auto first = offsets[lo];
+		const auto last = offsets[lo + 1z];
+
+		// corrupted file must not read outside of the mapping
+		if (first > last || last > header->postings) {
+			return {};
+		}
+
+		return {postings + first, postings + last};
+	}
+
+	// same semantic as `simple_fulltext_reverse_index::find_all`, but documents are ids
+	// result is sorted by document and position
+	auto find_all(support::view_as_ngrams<N> input) const -> std::vector<fulltext_posting> {
+		struct ngram_postings {
+			std::span<const fulltext_posting> postings;
+			unsigned relative_position;
+		};
+
+		std::vector<ngram_postings> matches{};
+		matches.reserve(input.size());
+
+		for (auto ng: input) {
+			matches.push_back(ngram_postings{find_ngram(ng.value), ng.position});
+		}
+
+		if (matches.empty()) {
+			return {};
+		}
+
+		// smallest posting list drives the search, others are only probed
+		std::sort(matches.begin(), matches.end(), [](const ngram_postings & lhs, const ngram_postings & rhs) { return lhs.postings.size() < rhs.postings.size(); });
+
+		std::vector<fulltext_posting> result{};
+
+		const auto & driver = matches.front();
+
+		for (const fulltext_posting & p: driver.postings) {
+			if (p.position < driver.relative_position) {
+				continue;
+			}
+
+			const uint32_t start = p.position - driver.relative_position;
+
+			const bool all = std::all_of(matches.begin() + 1, matches.end(), [&](const ngram_postings & other) {
+				return std::binary_search(other.postings.begin(), other.postings.end(), fulltext_posting{p.document, start + other.relative_position});
+			});
+
+			if (all) {
+				result.push_back(fulltext_posting{p.document, start});
+			}
+		}
+
+		return result;
+	}
+};
+
+} // namespace ctdb
+
+#endif
@@ -1,14 +1,28 @@
 #ifndef CTDB_INDICES_FULLTEXT_HPP
 #define CTDB_INDICES_FULLTEXT_HPP
 
+#include "../instrumentation.hpp"
+#include "support/levenshtein.hpp"
 #include "support/ngram.hpp"
+#include "support/normalize.hpp"
+#include "support/radix-sort.hpp"
+#include "support/simd.hpp"
+#include "support/text-query.hpp"
 #include <algorithm>
+#include <functional>
+#include <iterator>
 #include <limits>
 #include <map>
+#include <optional>
 #include <ostream>
 #include <set>
+#include <string>
 #include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 #include <cassert>
+#include <cmath>
 #include <concepts>
 
 // iostream
@@ -22,51 +36,162 @@ struct whole_record_as_string {
 	}
 };
 
-template <typename PKey, size_t N> struct simple_fulltext_reverse_index {
-	struct entry {
+// match of a full-text search: record and position of the match inside it
+// (address of the record is stored, so entries of removed records are ordered and compared without touching the record)
+template <typename PKey> struct fulltext_entry {
+	PKey pkey;
+	const void * address;
+	unsigned position;
+
+	constexpr fulltext_entry(PKey pk, unsigned pos) noexcept: pkey{pk}, address{std::addressof(*pk)}, position{pos} { }
+	constexpr fulltext_entry(PKey pk, const void * addr, unsigned pos) noexcept: pkey{pk}, address{addr}, position{pos} { }
+
+	// same record at another position
+	constexpr auto at(unsigned pos) const noexcept -> fulltext_entry {
+		return {pkey, address, pos};
+	}
+
+	friend constexpr bool operator==(const fulltext_entry & lhs, const fulltext_entry & rhs) noexcept {
+		return std::tie(lhs.address, lhs.position) == std::tie(rhs.address, rhs.position);
+	}
+
+	friend constexpr auto operator<=>(const fulltext_entry & lhs, const fulltext_entry & rhs) noexcept {
+		return std::tie(lhs.address, lhs.position) <=> std::tie(rhs.address, rhs.position);
+	}
+
+	friend std::ostream & operator<<(std::ostream & os, const fulltext_entry & e) {
+		return os << e.address << " '" << *e.pkey << "'@" << e.position;
+	}
+};
+
+// queries shorter than N are answered only if they have at least `MinQuery` characters (if MinQuery < N)
+// - start of the query is a prefix of an ngram, so it's found with a range scan over ngrams with the prefix
+// - last N-1 positions of each document don't start any ngram, so they are kept separately as `tails`
+//   (at most N - MinQuery postings per document)
+// `Instrumentation` counts ngram lookups (probes), intersections and latency of operations (see instrumentation.hpp)
+// and tracks memory of the dictionary, postings and statistics separately
+template <typename PKey, size_t N, size_t MinQuery = N, typename Instrumentation = no_instrumentation> struct simple_fulltext_reverse_index {
+	static_assert(MinQuery > 0z && MinQuery <= N);
+
+	using entry = fulltext_entry<PKey>;
+
+	static constexpr bool short_queries = (MinQuery < N);
+
+	// same as std::allocator without instrumentation
+	template <typename T> using allocator_type = instrumented_allocator_t<T, Instrumentation>;
+
+	// all posting sets share one allocator (and so one memory account)
+	using posting_set = std::set<entry, std::less<entry>, allocator_type<entry>>;
+
+	[[no_unique_address]] allocator_type<entry> posting_allocator{};
+
+	size_t count{0z};
+	std::map<support::ngram<N>, posting_set, std::less<support::ngram<N>>, allocator_type<std::pair<const support::ngram<N>, posting_set>>> data;
+
+	// postings of document suffixes shorter than N (only used with short queries)
+	size_t tail_count{0z};
+	std::map<std::string, posting_set, std::less<>, allocator_type<std::pair<const std::string, posting_set>>> tails;
+
+	// documents removed with `remove(pkey)` which are still present in postings (keyed by address of the record)
+	std::unordered_map<const void *, PKey, std::hash<const void *>, std::equal_to<const void *>, allocator_type<std::pair<const void * const, PKey>>> tombstones;
+
+	// statistics for scoring, maintained together with postings
+	// (removed documents are subtracted from ngram statistics when their postings are compacted)
+	struct ngram_statistics {
+		unsigned documents{0u};
+		unsigned max_frequency{0u};
+	};
+
+	std::map<support::ngram<N>, ngram_statistics, std::less<support::ngram<N>>, allocator_type<std::pair<const support::ngram<N>, ngram_statistics>>> statistics;
+
+	// every live document (keyed by address of its record) with its length in ngrams
+	struct document_info {
 		PKey pkey;
-		unsigned position;
+		unsigned length{0u};
+	};
 
-		constexpr entry(PKey pk, unsigned pos) noexcept: pkey{pk}, position{pos} { }
+	std::unordered_map<const void *, document_info, std::hash<const void *>, std::equal_to<const void *>, allocator_type<std::pair<const void * const, document_info>>> document_lengths;
+	size_t total_length{0z};
 
-		friend constexpr bool operator==(const entry & lhs, const entry & rhs) noexcept {
-			const auto lhs_addr = std::addressof(*lhs.pkey);
-			const auto rhs_addr = std::addressof(*rhs.pkey);
+	[[no_unique_address]] Instrumentation instrumentation{};
 
-			return std::tie(lhs_addr, lhs.position) == std::tie(rhs_addr, rhs.position);
-		}
+	simple_fulltext_reverse_index() = default;
+	simple_fulltext_reverse_index(const simple_fulltext_reverse_index &) requires(!Instrumentation::enabled) = default;
+	simple_fulltext_reverse_index(simple_fulltext_reverse_index &&) noexcept = default;
 
-		friend constexpr auto operator<=>(const entry & lhs, const entry & rhs) noexcept {
-			const auto lhs_addr = std::addressof(*lhs.pkey);
-			const auto rhs_addr = std::addressof(*rhs.pkey);
+	// copied posting sets must use allocator of the copy
+	simple_fulltext_reverse_index(const simple_fulltext_reverse_index & other)
+	requires(Instrumentation::enabled)
+	{
+		merge(other);
+		tombstones.insert(other.tombstones.begin(), other.tombstones.end());
+	}
 
-			return std::tie(lhs_addr, lhs.position) <=> std::tie(rhs_addr, rhs.position);
+	simple_fulltext_reverse_index & operator=(const simple_fulltext_reverse_index & other) {
+		if (this != &other) {
+			simple_fulltext_reverse_index tmp{other};
+			*this = std::move(tmp);
 		}
 
-		friend std::ostream & operator<<(std::ostream & os, const entry & e) {
-			return os << std::addressof(*e.pkey) << " '" << *e.pkey << "'@" << e.value.position;
+		return *this;
+	}
+
+	simple_fulltext_reverse_index & operator=(simple_fulltext_reverse_index &&) noexcept = default;
+
+	// snapshot of counters (always empty without instrumentation)
+	auto stats() const noexcept -> instrumentation_stats {
+		return instrumentation.stats();
+	}
+
+	struct memory_usage_type {
+		// ngrams and tails with their nodes
+		memory_footprint dictionary{};
+		// all entries of all posting sets
+		memory_footprint postings{};
+		// scoring statistics, document lengths and tombstones
+		memory_footprint statistics{};
+
+		constexpr auto total() const noexcept -> memory_footprint {
+			return dictionary + postings + statistics;
 		}
 	};
 
-	size_t count{0z};
-	std::map<support::ngram<N>, std::set<entry>> data;
+	// memory is tracked by the allocators, so it's available only with instrumentation
+	// (keys of tails are std::string and their heap buffers are not counted)
+	auto memory_usage() const noexcept -> memory_usage_type
+	requires(Instrumentation::enabled)
+	{
+		memory_usage_type result{};
+		result.dictionary = data.get_allocator().footprint() + tails.get_allocator().footprint();
+		result.postings = posting_allocator.footprint();
+		result.statistics = statistics.get_allocator().footprint() + document_lengths.get_allocator().footprint() + tombstones.get_allocator().footprint();
+		return result;
+	}
 
 	size_t ngram_known() const noexcept {
-		return data.size();
+		return data.size() + tails.size();
 	}
 
 	size_t ngram_count() const noexcept {
-		return count;
+		return count + tail_count;
 	}
 
 	auto emplace(support::view_as_ngrams<N> ngrams, PKey pkey) {
+		const typename Instrumentation::scope _{instrumentation, operation::insert};
+
+		compact_if_reused(pkey);
+		emplace_tails(ngrams.input, pkey);
+
+		for_each_frequency(ngrams, [&](const support::ngram<N> & value, unsigned frequency) { add_statistics(value, frequency); });
+		add_document_length(pkey, ngrams.size());
+
 		for (auto ngram: ngrams) {
 			auto it = data.lower_bound(ngram.value);
 
-			if (it->first == ngram.value) {
+			if (it != data.end() && it->first == ngram.value) {
 				it->second.emplace(pkey, ngram.position);
 			} else {
-				auto it2 = data.emplace_hint(it, ngram.value, std::set<entry>{});
+				auto it2 = data.emplace_hint(it, ngram.value, posting_set{posting_allocator});
 				it2->second.emplace(pkey, ngram.position);
 			}
 
@@ -74,7 +199,153 @@ template <typename PKey, size_t N> struct simple_fulltext_reverse_index {
 		}
 	}
 
+	struct occurrence {
+		using key_type = std::conditional_t<support::ngram_is_packable<N>, uint64_t, support::ngram<N>>;
+
+		key_type key;
+		PKey pkey;
+		unsigned position;
+
+		constexpr occurrence(support::ngram_with_position<N> ng, PKey pk) noexcept: key{pack(ng.value)}, pkey{pk}, position{ng.position} { }
+		constexpr occurrence(key_type k, PKey pk, unsigned pos) noexcept: key{k}, pkey{pk}, position{pos} { }
+
+		static constexpr auto pack(support::ngram<N> value) noexcept -> key_type {
+			if constexpr (support::ngram_is_packable<N>) {
+				return support::pack_ngram(value);
+			} else {
+				return value;
+			}
+		}
+
+		constexpr auto value() const noexcept -> support::ngram<N> {
+			if constexpr (support::ngram_is_packable<N>) {
+				return support::unpack_ngram<N>(key);
+			} else {
+				return key;
+			}
+		}
+	};
+
+	// insert many documents at once, input is range of (text, pkey) pairs
+	// all ngrams are collected into one buffer and sorted, so each ngram is looked up only once per batch
+	template <typename Range> auto emplace_batch(const Range & documents) {
+		const typename Instrumentation::scope _{instrumentation, operation::insert};
+
+		size_t total = 0z;
+
+		for (const auto & [text, pkey]: documents) {
+			compact_if_reused(pkey);
+			emplace_tails(std::string_view(text), pkey);
+			add_document_length(pkey, support::view_as_ngrams<N>(text).size());
+			total += support::view_as_ngrams<N>(text).size();
+		}
+
+		std::vector<occurrence> buffer{};
+		buffer.reserve(total);
+
+		if constexpr (support::ngram_is_packable<N>) {
+			// all ngrams of a document are packed in one pass
+			std::vector<uint64_t> keys{};
+
+			for (const auto & [text, pkey]: documents) {
+				const auto input = std::string_view(text);
+
+				keys.resize(support::ngram_generate_count<N>(input.size()));
+				support::pack_ngrams<N>(input, keys.data());
+
+				for (size_t i = 0z; i != keys.size(); ++i) {
+					buffer.emplace_back(keys[i], pkey, static_cast<unsigned>(i));
+				}
+			}
+		} else {
+			for (const auto & [text, pkey]: documents) {
+				for (auto ngram: support::view_as_ngrams<N>(text)) {
+					buffer.emplace_back(ngram, pkey);
+				}
+			}
+		}
+
+		// sort is stable, so order of documents and positions inside a run is kept
+		if constexpr (support::ngram_is_packable<N>) {
+			support::radix_sort<N>(buffer, [](const occurrence & o) { return o.key; });
+		} else {
+			std::stable_sort(buffer.begin(), buffer.end(), [](const occurrence & lhs, const occurrence & rhs) { return lhs.key < rhs.key; });
+		}
+
+		// merge each run of same ngram into its posting set
+		for (auto first = buffer.begin(); first != buffer.end();) {
+			const auto last = std::find_if(first, buffer.end(), [key = first->key](const occurrence & o) { return o.key != key; });
+			const auto value = first->value();
+
+			auto it = data.lower_bound(value);
+
+			if (it == data.end() || it->first != value) {
+				it = data.emplace_hint(it, value, posting_set{posting_allocator});
+			}
+
+			auto & postings = it->second;
+
+			for (auto occ = first; occ != last; ++occ) {
+				postings.emplace_hint(postings.end(), occ->pkey, occ->position);
+			}
+
+			// occurrences of each document are next to each other
+			for (auto occ = first; occ != last;) {
+				const auto next = std::find_if(occ, last, [address = std::addressof(*occ->pkey)](const occurrence & o) { return std::addressof(*o.pkey) != address; });
+				add_statistics(value, static_cast<unsigned>(next - occ));
+				occ = next;
+			}
+
+			first = last;
+		}
+
+		count += buffer.size();
+	}
+
+	// add all postings from other index (documents in both indices are expected to be disjoint)
+	auto merge(const simple_fulltext_reverse_index & other) {
+		for (const auto & [value, postings]: other.data) {
+			auto it = data.lower_bound(value);
+
+			if (it == data.end() || it->first != value) {
+				it = data.emplace_hint(it, value, posting_set{posting_allocator});
+			}
+
+			it->second.insert(postings.begin(), postings.end());
+		}
+
+		for (const auto & [suffix, postings]: other.tails) {
+			auto it = tails.lower_bound(suffix);
+
+			if (it == tails.end() || it->first != suffix) {
+				it = tails.emplace_hint(it, suffix, posting_set{posting_allocator});
+			}
+
+			it->second.insert(postings.begin(), postings.end());
+		}
+
+		for (const auto & [value, stats]: other.statistics) {
+			auto & mine = statistics[value];
+			mine.documents += stats.documents;
+			mine.max_frequency = std::max(mine.max_frequency, stats.max_frequency);
+		}
+
+		for (const auto & [address, info]: other.document_lengths) {
+			document_lengths.emplace(address, info);
+		}
+
+		total_length += other.total_length;
+
+		count += other.count;
+		tail_count += other.tail_count;
+	}
+
 	auto remove(support::view_as_ngrams<N> ngrams, PKey pkey) {
+		const typename Instrumentation::scope _{instrumentation, operation::erase};
+
+		for_each_frequency(ngrams, [&](const support::ngram<N> & value, unsigned) { remove_statistics(value); });
+		remove_document_length(pkey);
+
 		for (auto ngram: ngrams) {
 			auto it = data.find(ngram.value);
 			assert(it != data.end());
@@ -86,9 +357,193 @@ template <typename PKey, size_t N> struct simple_fulltext_reverse_index {
 				data.erase(it);
 			}
 		}
+
+		for_each_tail(ngrams.input, [&](std::string_view suffix, unsigned position) {
+			auto it = tails.find(suffix);
+			assert(it != tails.end());
+
+			it->second.erase(entry{pkey, position});
+			--tail_count;
+
+			if (it->second.empty()) {
+				tails.erase(it);
+			}
+		});
+	}
+
+	// mark document as removed without touching its postings, they are removed later by `compact()`
+	// (record isn't needed anymore and it can be destroyed right after this call, keys of removed documents are never dereferenced)
+	void remove(PKey pkey) {
+		const typename Instrumentation::scope _{instrumentation, operation::erase};
+
+		tombstones.emplace(std::addressof(*pkey), pkey);
+		remove_document_length(pkey);
+	}
+
+	bool is_removed(const PKey & pkey) const noexcept {
+		return !tombstones.empty() && tombstones.contains(std::addressof(*pkey));
+	}
+
+	// record of the entry can be gone already
+	bool is_removed(const entry & e) const noexcept {
+		return !tombstones.empty() && tombstones.contains(e.address);
+	}
+
+	size_t removed_count() const noexcept {
+		return tombstones.size();
+	}
+
+	// physically remove postings of all removed documents
+	void compact() {
+		if (tombstones.empty()) {
+			return;
+		}
+
+		count -= compact_postings(data, [&](const support::ngram<N> & value, const posting_set &, unsigned documents) { remove_statistics(value, documents); });
+		tail_count -= compact_postings(tails, [](const auto &, const auto &, unsigned) {});
+
+		tombstones.clear();
+	}
+
+	// returns number of removed postings, `removed(key, postings, documents)` is called for every key which lost some documents
+	auto compact_postings(auto & map, auto && removed) -> size_t {
+		size_t result = 0z;
+
+		for (auto it = map.begin(); it != map.end();) {
+			auto & postings = it->second;
+			unsigned removed_documents = 0u;
+
+			if (tombstones.size() * 8z < postings.size()) {
+				// only a few documents were removed => erase their ranges
+				// (entries are ordered by address of the record, so each document is a contiguous range)
+				for (const auto & [address, pkey]: tombstones) {
+					const auto first = postings.lower_bound(entry{pkey, address, 0u});
+					const auto last = std::find_if(first, postings.end(), [address = address](const entry & e) { return e.address != address; });
+
+					if (first != last) {
+						++removed_documents;
+					}
+
+					result += static_cast<size_t>(std::distance(first, last));
+					postings.erase(first, last);
+				}
+			} else {
+				const void * previous = nullptr;
+
+				for (auto e = postings.begin(); e != postings.end();) {
+					const void * address = e->address;
+
+					if (!tombstones.contains(address)) {
+						++e;
+						continue;
+					}
+
+					if (address != previous) {
+						++removed_documents;
+						previous = address;
+					}
+
+					e = postings.erase(e);
+					++result;
+				}
+			}
+
+			if (removed_documents != 0u) {
+				removed(it->first, postings, removed_documents);
+			}
+
+			if (postings.empty()) {
+				it = map.erase(it);
+			} else {
+				++it;
+			}
+		}
+
+		return result;
+	}
+
+	// call `fn(ngram, frequency)` for each distinct ngram of a document
+	static constexpr void for_each_frequency(support::view_as_ngrams<N> ngrams, auto && fn) {
+		std::vector<support::ngram<N>> values{};
+		values.reserve(ngrams.size());
+
+		for (auto ngram: ngrams) {
+			values.emplace_back(ngram.value);
+		}
+
+		std::sort(values.begin(), values.end());
+
+		for (auto first = values.begin(); first != values.end();) {
+			const auto last = std::find_if(first, values.end(), [&](const support::ngram<N> & v) { return v != *first; });
+			fn(*first, static_cast<unsigned>(last - first));
+			first = last;
+		}
+	}
+
+	void add_statistics(const support::ngram<N> & value, unsigned frequency) {
+		auto & stats = statistics[value];
+		++stats.documents;
+		stats.max_frequency = std::max(stats.max_frequency, frequency);
+	}
+
+	void remove_statistics(const support::ngram<N> & value, unsigned documents = 1u) {
+		// maximal frequency stays as it is, it's still an upper bound
+		if (const auto it = statistics.find(value); it != statistics.end()) {
+			it->second.documents -= std::min(it->second.documents, documents);
+
+			if (it->second.documents == 0u) {
+				statistics.erase(it);
+			}
+		}
 	}
 
-	constexpr auto find_ngram_occurences(support::ngram<N> value) const noexcept -> const std::set<entry> * {
+	void add_document_length(const PKey & pkey, size_t length) {
+		document_lengths.try_emplace(std::addressof(*pkey), document_info{pkey}).first->second.length += static_cast<unsigned>(length);
+		total_length += length;
+	}
+
+	void remove_document_length(const PKey & pkey) {
+		if (const auto it = document_lengths.find(std::addressof(*pkey)); it != document_lengths.end()) {
+			total_length -= it->second.length;
+			document_lengths.erase(it);
+		}
+	}
+
+	// positions which don't start a full ngram (last N-1 of the document) with their suffix
+	// only suffixes which can match a query (at least MinQuery long) are interesting
+	static constexpr void for_each_tail(std::string_view text, auto && fn) {
+		if constexpr (short_queries) {
+			const size_t first = (text.size() >= N) ? text.size() - (N - 1z) : 0z;
+
+			for (size_t position = first; position + MinQuery <= text.size(); ++position) {
+				fn(text.substr(position), static_cast<unsigned>(position));
+			}
+		}
+	}
+
+	void emplace_tails(std::string_view text, PKey pkey) {
+		for_each_tail(text, [&](std::string_view suffix, unsigned position) {
+			auto it = tails.lower_bound(suffix);
+
+			if (it == tails.end() || it->first != suffix) {
+				it = tails.emplace_hint(it, std::string(suffix), posting_set{posting_allocator});
+			}
+
+			it->second.emplace(pkey, position);
+			++tail_count;
+		});
+	}
+
+	// address of removed record can be reused for a new one, so old postings must be gone first
+	void compact_if_reused(const PKey & pkey) {
+		if (is_removed(pkey)) {
+			compact();
+		}
+	}
+
+	constexpr auto find_ngram_occurences(support::ngram<N> value) const noexcept -> const posting_set * {
+		Instrumentation::probe();
+
 		if (const auto it = data.find(value); it != data.end()) {
 			return std::addressof(it->second);
 		} else {
@@ -98,9 +553,9 @@ template <typename PKey, size_t N> struct simple_fulltext_reverse_index {
 
 	struct ngram_matches {
 		support::ngram_with_position<N> value;
-		const std::set<entry> * matches;
+		const posting_set * matches;
 
-		constexpr ngram_matches(support::ngram_with_position<N> v, const std::set<entry> * m) noexcept: value{v}, matches{m} { }
+		constexpr ngram_matches(support::ngram_with_position<N> v, const posting_set * m) noexcept: value{v}, matches{m} { }
 
 		constexpr size_t size() const noexcept {
 			if (matches) {
@@ -125,7 +580,7 @@ template <typename PKey, size_t N> struct simple_fulltext_reverse_index {
 			return lhs.value == rhs.value;
 		}
 
-		constexpr const std::set<entry> & get_set() const noexcept {
+		constexpr const posting_set & get_set() const noexcept {
 			return *matches;
 		}
 
@@ -141,18 +596,20 @@ template <typename PKey, size_t N> struct simple_fulltext_reverse_index {
 		// O(a * log(b))
 		if (lhs.size() <= rhs.size()) {
 			for (const auto & lhs_entry: lhs.get_set()) {
-				if (rhs.get_set().contains(entry{lhs_entry.pkey, lhs_entry.position - lhs.get_relative_position() + rhs.get_relative_position()})) {
-					result.emplace(entry{lhs_entry.pkey, lhs_entry.position - lhs.get_relative_position()});
+				if (rhs.get_set().contains(lhs_entry.at(lhs_entry.position - lhs.get_relative_position() + rhs.get_relative_position()))) {
+					result.emplace(lhs_entry.at(lhs_entry.position - lhs.get_relative_position()));
 				}
 			}
 		} else {
 			for (const auto & rhs_entry: rhs.get_set()) {
-				if (lhs.get_set().contains(entry{rhs_entry.pkey, rhs_entry.position - rhs.get_relative_position() + lhs.get_relative_position()})) {
-					result.emplace(entry{rhs_entry.pkey, rhs_entry.position - rhs.get_relative_position()});
+				if (lhs.get_set().contains(rhs_entry.at(rhs_entry.position - rhs.get_relative_position() + lhs.get_relative_position()))) {
+					result.emplace(rhs_entry.at(rhs_entry.position - rhs.get_relative_position()));
 				}
 			}
 		}
 
+		Instrumentation::intersection(result.size());
+
 		return result;
 	}
 
@@ -161,24 +618,28 @@ template <typename PKey, size_t N> struct simple_fulltext_reverse_index {
 			// erase each one which is not present in RHS
 			for (auto it = lhs.begin(); it != lhs.end();) {
 				// filter out everything which is not in RHS
-				if (!rhs.get_set().contains(entry{it->pkey, it->position + rhs.get_relative_position()})) {
+				if (!rhs.get_set().contains(it->at(it->position + rhs.get_relative_position()))) {
 					it = lhs.erase(it);
 				} else {
 					++it;
 				}
 			}
 
+			Instrumentation::intersection(lhs.size());
+
 			return lhs;
 		} else {
 			std::set<entry> result{};
 
 			// iterate over RHS and find each element from LHS, if it's there, extract it from LHS and move to result
 			for (const auto & rhs_entry: rhs.get_set()) {
-				if (auto it = lhs.find(entry{rhs_entry.pkey, rhs_entry.position - rhs.get_relative_position()}); it != lhs.end()) {
+				if (auto it = lhs.find(rhs_entry.at(rhs_entry.position - rhs.get_relative_position())); it != lhs.end()) {
 					result.insert(lhs.extract(it));
 				}
 			}
 
+			Instrumentation::intersection(result.size());
+
 			return result;
 		}
 	}
@@ -202,6 +663,14 @@ template <typename PKey, size_t N> struct simple_fulltext_reverse_index {
 	}
 
 	constexpr auto find_all(support::view_as_ngrams<N> input) const -> std::set<entry> {
+		const typename Instrumentation::scope _{instrumentation, operation::lookup};
+
+		if constexpr (short_queries) {
+			if (input.input.size() < N) {
+				return find_short(input.input);
+			}
+		}
+
 		// this looks for each ngram and gets range (std::set) of its matches
 		// as the index is stored as std::map<ngram, std::set<entry>>
 		const auto matches = get_sorted_ngram_matches(input);
@@ -221,7 +690,7 @@ template <typename PKey, size_t N> struct simple_fulltext_reverse_index {
 
 		if (matches.size() == 1z) {
 			// if there was only one ngram at all (we can't intersect it with anything)
-			return first_match.get_set();
+			return without_removed(std::set<entry>(first_match.get_set().begin(), first_match.get_set().end()));
 		}
 
 		const auto & second_match = matches[1];
@@ -241,27 +710,991 @@ template <typename PKey, size_t N> struct simple_fulltext_reverse_index {
 			assert(result.size() <= result_size_before);
 		}
 
-		return result;
+		return without_removed(std::move(result));
 	}
-};
 
-struct contains_string {
-	std::string_view input;
+	// query shorter than N (but at least MinQuery) is prefix of ngrams or of a tail
+	constexpr auto find_short(std::string_view input) const -> std::set<entry> {
+		std::set<entry> result{};
 
-	explicit constexpr contains_string(std::string_view in) noexcept: input{in} { }
-};
+		if (input.size() < MinQuery || input.size() >= N) {
+			return result;
+		}
 
-template <typename Extractor = whole_record_as_string, size_t N = 4> struct basic_fulltext {
-	std::string_view input;
+		// all ngrams with same prefix are next to each other, the first one is padded with the smallest character
+		std::array<char, N> lowest{};
+		lowest.fill((std::numeric_limits<char>::min)());
+		std::copy(input.begin(), input.end(), lowest.begin());
+
+		const auto has_prefix = [&](const auto & value) { return std::equal(input.begin(), input.end(), std::begin(value)); };
+
+		for (auto it = data.lower_bound(support::ngram<N>{lowest.data()}); it != data.end() && has_prefix(it->first.value); ++it) {
+			result.insert(it->second.begin(), it->second.end());
+		}
+
+		for (auto it = tails.lower_bound(input); it != tails.end() && std::string_view{it->first}.starts_with(input); ++it) {
+			result.insert(it->second.begin(), it->second.end());
+		}
 
-	explicit constexpr basic_fulltext(std::string_view) noexcept {
+		return without_removed(std::move(result));
 	}
 
-	// iterator generating ngrams
-	constexpr auto begin() {
+	constexpr auto without_removed(std::set<entry> result) const -> std::set<entry> {
+		if (!tombstones.empty()) {
+			std::erase_if(result, [&](const entry & e) { return is_removed(e); });
+		}
+
+		return result;
 	}
 
-	constexpr auto end() {
+	// lazily evaluated search, matches are produced on demand with leapfrog intersection of posting sets
+	// (index must outlive the query and must not be modified while the query is used)
+	// queries shorter than N (but at least MinQuery) have no ngrams to intersect, their matches are found at once by `find_short`
+	struct lazy_query {
+		const simple_fulltext_reverse_index * index;
+		std::vector<ngram_matches> matches;
+		size_t max_results{(std::numeric_limits<size_t>::max)()};
+		bool short_query{false};
+		std::vector<entry> short_matches{};
+
+		using cursor_type = typename posting_set::const_iterator;
+
+		struct sentinel { };
+
+		struct iterator {
+			const lazy_query * query{nullptr};
+			std::vector<cursor_type> cursors{};
+			std::optional<entry> current{std::nullopt};
+			size_t produced{0z};
+
+			using value_type = entry;
+			using difference_type = std::ptrdiff_t;
+
+			constexpr iterator() noexcept = default;
+
+			constexpr explicit iterator(const lazy_query & q): query{&q} {
+				if (q.short_query) {
+					if (!q.short_matches.empty() && q.max_results != 0z) {
+						current = q.short_matches.front();
+					}
+					return;
+				}
+
+				if (q.matches.empty() || q.matches.front().empty() || q.max_results == 0z) {
+					// input shorter than N or smallest ngram doesn't exist
+					return;
+				}
+
+				cursors.reserve(q.matches.size());
+
+				for (const auto & m: q.matches) {
+					cursors.emplace_back(m.get_set().begin());
+				}
+
+				if (settle(0z)) {
+					find_next();
+				}
+			}
+
+			constexpr const entry & operator*() const noexcept {
+				return *current;
+			}
+
+			constexpr const entry * operator->() const noexcept {
+				return std::addressof(*current);
+			}
+
+			constexpr iterator & operator++() {
+				if (++produced == query->max_results) {
+					current = std::nullopt;
+					return *this;
+				}
+
+				if (query->short_query) {
+					if (produced < query->short_matches.size()) {
+						current = query->short_matches[produced];
+					} else {
+						current = std::nullopt;
+					}
+					return *this;
+				}
+
+				// all cursors are at current match, move first one and continue
+				++cursors[0];
+
+				if (settle(0z)) {
+					find_next();
+				} else {
+					current = std::nullopt;
+				}
+
+				return *this;
+			}
+
+			constexpr void operator++(int) {
+				++*this;
+			}
+
+			constexpr friend bool operator==(const iterator & it, sentinel) noexcept {
+				return !it.current.has_value();
+			}
+
+		private:
+			constexpr const posting_set & set_of(size_t i) const noexcept {
+				return query->matches[i].get_set();
+			}
+
+			constexpr unsigned relative_position_of(size_t i) const noexcept {
+				return query->matches[i].get_relative_position();
+			}
+
+			// entry in set `i` corresponds to a match starting at `position - relative_position`
+			constexpr auto start_of(size_t i) const noexcept {
+				return std::make_pair(cursors[i]->address, cursors[i]->position - relative_position_of(i));
+			}
+
+			// skip entries which can't be a part of any match as they are too close to beginning of the document
+			constexpr bool settle(size_t i) {
+				auto & it = cursors[i];
+				const auto & set = set_of(i);
+				const auto rel = relative_position_of(i);
+
+				while (it != set.end() && it->position < rel) {
+					it = set.lower_bound(it->at(rel));
+				}
+
+				return it != set.end();
+			}
+
+			// move cursor `i` to first entry which is not before match starting at `start`
+			constexpr bool seek(size_t i, const entry & start) {
+				const auto target = start.at(start.position + relative_position_of(i));
+
+				if (*cursors[i] < target) {
+					cursors[i] = set_of(i).lower_bound(target);
+				}
+
+				return settle(i);
+			}
+
+			constexpr void find_next() {
+				const size_t k = cursors.size();
+
+				for (;;) {
+					auto candidate = cursors[0]->at(cursors[0]->position - relative_position_of(0z));
+					size_t agreed = 1z;
+
+					for (size_t i = 1z % k; agreed != k; i = (i + 1z) % k) {
+						if (!seek(i, candidate)) {
+							current = std::nullopt;
+							return;
+						}
+
+						const auto start = start_of(i);
+
+						if (start == std::make_pair(candidate.address, candidate.position)) {
+							++agreed;
+						} else {
+							candidate = cursors[i]->at(start.second);
+							agreed = 1z;
+						}
+					}
+
+					if (!query->index->is_removed(candidate)) {
+						current = candidate;
+						return;
+					}
+
+					// match in removed document, continue with next one
+					++cursors[0];
+
+					if (!settle(0z)) {
+						current = std::nullopt;
+						return;
+					}
+				}
+			}
+		};
+
+		constexpr auto begin() const {
+			return iterator{*this};
+		}
+
+		constexpr auto end() const noexcept {
+			return sentinel{};
+		}
+
+		// same query but it will stop after k matches
+		constexpr auto limit(size_t k) const -> lazy_query {
+			return lazy_query{index, matches, std::min(k, max_results), short_query, short_matches};
+		}
+
+		constexpr bool exists() const {
+			return begin() != end();
+		}
+
+		constexpr size_t count() const {
+			size_t result = 0z;
+
+			for (auto it = begin(); it != end(); ++it) {
+				++result;
+			}
+
+			return result;
+		}
+	};
+
+	constexpr auto search(support::view_as_ngrams<N> input) const -> lazy_query {
+		if constexpr (short_queries) {
+			if (input.input.size() < N) {
+				const auto found = find_short(input.input);
+				return lazy_query{this, {}, (std::numeric_limits<size_t>::max)(), true, std::vector<entry>(found.begin(), found.end())};
+			}
+		}
+
+		return lazy_query{this, get_sorted_ngram_matches(input)};
+	}
+
+	// documents sorted by address of their record
+	using document_list = std::vector<PKey>;
+
+	static constexpr bool document_less(const PKey & lhs, const PKey & rhs) noexcept {
+		return std::less<const void *>{}(std::addressof(*lhs), std::addressof(*rhs));
+	}
+
+	static constexpr auto intersect_documents(const document_list & lhs, const document_list & rhs) -> document_list {
+		document_list result{};
+		result.reserve(std::min(lhs.size(), rhs.size()));
+		std::set_intersection(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), std::back_inserter(result), document_less);
+		Instrumentation::intersection(result.size());
+		return result;
+	}
+
+	static constexpr auto unite_documents(const document_list & lhs, const document_list & rhs) -> document_list {
+		document_list result{};
+		result.reserve(lhs.size() + rhs.size());
+		std::set_union(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), std::back_inserter(result), document_less);
+		return result;
+	}
+
+	// all documents containing the input (each only once)
+	constexpr auto find_documents(support::view_as_ngrams<N> input) const -> document_list {
+		const typename Instrumentation::scope _{instrumentation, operation::lookup};
+
+		document_list result{};
+
+		// matches are ordered by address of the record, so same documents are next to each other
+		const auto add = [&](const entry & e) {
+			if (result.empty() || std::addressof(*result.back()) != e.address) {
+				result.emplace_back(e.pkey);
+			}
+		};
+
+		if constexpr (short_queries) {
+			if (input.input.size() < N) {
+				for (const entry & e: find_short(input.input)) {
+					add(e);
+				}
+
+				return result;
+			}
+		}
+
+		for (const entry & e: search(input)) {
+			add(e);
+		}
+
+		return result;
+	}
+
+	static constexpr auto subtract_documents(const document_list & lhs, const document_list & rhs) -> document_list {
+		document_list result{};
+		result.reserve(lhs.size());
+		std::set_difference(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), std::back_inserter(result), document_less);
+		return result;
+	}
+
+	// every document in the index (documents too short to have any ngram included)
+	constexpr auto all_documents() const -> document_list {
+		document_list result{};
+		result.reserve(document_lengths.size());
+
+		for (const auto & [address, info]: document_lengths) {
+			result.emplace_back(info.pkey);
+		}
+
+		std::sort(result.begin(), result.end(), document_less);
+		return result;
+	}
+
+	// upper estimate of number of matches of a query (to evaluate cheaper operands first)
+	constexpr auto estimate(const support::text_query & query) const -> size_t {
+		using kind = support::text_query::kind;
+		constexpr auto unknown = (std::numeric_limits<size_t>::max)();
+
+		switch (query.type) {
+		case kind::term: {
+			if (query.term.size() < N) {
+				return unknown;
+			}
+
+			// matches are sorted, first one is the smallest
+			const auto matches = get_sorted_ngram_matches(std::string_view{query.term});
+			return matches.front().size();
+		}
+
+		case kind::all_of:
+		case kind::near: {
+			size_t result = unknown;
+
+			for (const auto & child: query.children) {
+				result = std::min(result, estimate(child));
+			}
+
+			return result;
+		}
+
+		case kind::any_of: {
+			size_t result = 0z;
+
+			for (const auto & child: query.children) {
+				const auto sub = estimate(child);
+				result = (sub > unknown - result) ? unknown : result + sub;
+			}
+
+			return result;
+		}
+
+		default:
+			return unknown;
+		}
+	}
+
+	// documents where `lhs` and `rhs` start at most `distance` characters apart
+	constexpr auto find_near(std::string_view lhs, std::string_view rhs, unsigned distance) const -> document_list {
+		document_list result{};
+
+		auto left = search(lhs);
+		auto right = search(rhs);
+
+		auto l = left.begin();
+		auto r = right.begin();
+
+		const auto address_of = [](const entry & e) { return e.address; };
+
+		// both streams are ordered by (document, position), so it's a single merge pass
+		while (l != left.end() && r != right.end()) {
+			const void * const doc = address_of(*l);
+
+			if (std::less<const void *>{}(doc, address_of(*r))) {
+				++l;
+				continue;
+			}
+
+			if (doc != address_of(*r)) {
+				++r;
+				continue;
+			}
+
+			bool found = false;
+
+			while (l != left.end() && r != right.end() && address_of(*l) == doc && address_of(*r) == doc) {
+				const auto lpos = l->position;
+				const auto rpos = r->position;
+
+				if ((lpos < rpos ? rpos - lpos : lpos - rpos) <= distance) {
+					found = true;
+					break;
+				}
+
+				// move the one which is behind
+				if (lpos < rpos) {
+					++l;
+				} else {
+					++r;
+				}
+			}
+
+			if (found) {
+				result.emplace_back(l->pkey);
+			}
+
+			// skip rest of the document
+			while (l != left.end() && address_of(*l) == doc) {
+				++l;
+			}
+
+			while (r != right.end() && address_of(*r) == doc) {
+				++r;
+			}
+		}
+
+		return result;
+	}
+
+	// documents of a query, `exact` is false when they are only a superset which must be verified
+	// (terms shorter than MinQuery can't be searched and they are treated as "anything")
+	struct candidate_documents {
+		document_list documents;
+		bool exact;
+	};
+
+	// evaluate boolean query over the index, std::nullopt means the index can't restrict the result
+	// - terms (at least MinQuery long) and `near` of terms at least N long are exact
+	// - negation is subtracted only when its operand is exact, otherwise it's skipped and the result is a superset
+	constexpr auto find_candidate_documents(const support::text_query & query) const -> std::optional<candidate_documents> {
+		using kind = support::text_query::kind;
+
+		switch (query.type) {
+		case kind::any:
+			return std::nullopt;
+
+		case kind::term:
+			if (query.term.size() < MinQuery) {
+				// too short to be searched
+				return std::nullopt;
+			}
+			return candidate_documents{find_documents(std::string_view{query.term}), true};
+
+		case kind::all_of: {
+			std::vector<std::pair<size_t, const support::text_query *>> positive{};
+			std::vector<const support::text_query *> negative{};
+
+			for (const auto & child: query.children) {
+				if (child.type == kind::none_of) {
+					negative.emplace_back(std::addressof(child.children.front()));
+				} else {
+					positive.emplace_back(estimate(child), std::addressof(child));
+				}
+			}
+
+			// smallest first, so intersection is as small as possible from the beginning
+			std::stable_sort(positive.begin(), positive.end(), [](const auto & lhs, const auto & rhs) { return lhs.first < rhs.first; });
+
+			std::optional<candidate_documents> result{std::nullopt};
+			bool exact = true;
+
+			for (const auto & [size, child]: positive) {
+				auto sub = find_candidate_documents(*child);
+
+				if (!sub) {
+					exact = false;
+					continue;
+				}
+
+				exact = exact && sub->exact;
+				result = candidate_documents{result ? intersect_documents(result->documents, sub->documents) : std::move(sub->documents), exact};
+
+				if (result->documents.empty()) {
+					// nothing can match a superset
+					result->exact = true;
+					return result;
+				}
+			}
+
+			if (!result) {
+				if (!positive.empty() || negative.empty()) {
+					// positive part can't be restricted, so neither the whole query
+					return std::nullopt;
+				}
+
+				// only negative part => subtract from all documents
+				result = candidate_documents{all_documents(), true};
+			}
+
+			result->exact = exact;
+
+			for (const auto * child: negative) {
+				const auto sub = find_candidate_documents(*child);
+
+				if (sub && sub->exact) {
+					result->documents = subtract_documents(result->documents, sub->documents);
+				} else {
+					// removing a superset could remove real matches
+					result->exact = false;
+				}
+			}
+
+			return result;
+		}
+
+		case kind::any_of: {
+			candidate_documents result{{}, true};
+
+			for (const auto & child: query.children) {
+				const auto sub = find_candidate_documents(child);
+
+				if (!sub) {
+					return std::nullopt;
+				}
+
+				result.documents = unite_documents(result.documents, sub->documents);
+				result.exact = result.exact && sub->exact;
+			}
+
+			return result;
+		}
+
+		case kind::none_of: {
+			const auto excluded = find_candidate_documents(query.children.front());
+
+			if (!excluded || !excluded->exact) {
+				return std::nullopt;
+			}
+
+			return candidate_documents{subtract_documents(all_documents(), excluded->documents), true};
+		}
+
+		case kind::near: {
+			const auto & lhs = query.children[0].term;
+			const auto & rhs = query.children[1].term;
+
+			if (lhs.size() < N || rhs.size() < N) {
+				// we can't search for positions of short terms, at least both of them must be there
+				auto result = find_candidate_documents(support::text_query::all_of({query.children[0], query.children[1]}));
+
+				if (result) {
+					result->exact = false;
+				}
+
+				return result;
+			}
+
+			return candidate_documents{find_near(std::string_view{lhs}, std::string_view{rhs}, query.distance), true};
+		}
+		}
+
+		return std::nullopt;
+	}
+
+	// documents which can match the query (superset when the query isn't exact, see `find_candidate_documents`)
+	constexpr auto find_candidates(const support::text_query & query) const -> std::optional<document_list> {
+		if (auto result = find_candidate_documents(query)) {
+			return std::move(result->documents);
+		}
+
+		return std::nullopt;
+	}
+
+	// matches confirmed against current text of the record (positions which doesn't contain the input anymore are dropped)
+	template <typename Extractor = whole_record_as_string> auto find_verified(std::string_view input, Extractor extractor = {}) const -> std::set<entry> {
+		auto result = find_all(input);
+
+		std::erase_if(result, [&](const entry & e) { return !support::matches_at(extractor(*e.pkey), input, e.position); });
+
+		return result;
+	}
+
+	// keep only documents which really contain the needle (used to verify candidates of queries with short terms)
+	template <typename Extractor = whole_record_as_string> static auto filter_containing(document_list documents, std::string_view needle, Extractor extractor = {}) -> document_list {
+		std::erase_if(documents, [&](const PKey & pkey) { return support::find_substring(extractor(*pkey), needle) == std::string_view::npos; });
+
+		return documents;
+	}
+
+	// documents matching boolean query (queries which can't be answered by the index return all documents
+	// and queries with terms shorter than MinQuery return a superset which must be verified)
+	constexpr auto find_documents(const support::text_query & query) const -> document_list {
+		const typename Instrumentation::scope _{instrumentation, operation::lookup};
+
+		if (auto result = find_candidates(query)) {
+			return std::move(*result);
+		}
+
+		return all_documents();
+	}
+
+	struct fuzzy_match {
+		PKey pkey;
+		unsigned distance;
+
+		constexpr fuzzy_match(PKey pk, unsigned d) noexcept: pkey{pk}, distance{d} { }
+	};
+
+	// documents which contain substring within `max_edits` edits (Levenshtein) of the query
+	// - q-gram count lemma: such substring shares at least `ngrams(query) - max_edits * N` ngrams with the query
+	// - postings of query's ngrams are merged with a heap and documents under the threshold are filtered out
+	// - survivors are verified with bounded Levenshtein
+	// (documents shorter than N are not in the index, so they are never found)
+	template <typename Extractor = whole_record_as_string> auto find_fuzzy(std::string_view query, unsigned max_edits, Extractor extractor = {}) const -> std::vector<fuzzy_match> {
+		// distinct ngrams of the query with their multiplicity
+		std::map<support::ngram<N>, unsigned> grams{};
+
+		for (auto ng: support::view_as_ngrams<N>(query)) {
+			++grams[ng.value];
+		}
+
+		const auto total = static_cast<long long>(support::ngram_generate_count<N>(query.size()));
+		const auto threshold = total - static_cast<long long>(max_edits) * static_cast<long long>(N);
+
+		using cursor_type = typename posting_set::const_iterator;
+
+		struct stream {
+			cursor_type current;
+			cursor_type end;
+			unsigned weight;
+		};
+
+		std::vector<stream> streams{};
+
+		if (threshold > 0) {
+			for (const auto & [value, weight]: grams) {
+				if (const auto * postings = find_ngram_occurences(value)) {
+					streams.push_back(stream{postings->begin(), postings->end(), weight});
+				}
+			}
+		} else {
+			// not enough ngrams to filter anything => every document is a candidate
+			for (const auto & [value, postings]: data) {
+				streams.push_back(stream{postings.begin(), postings.end(), 0u});
+			}
+		}
+
+		const auto address_of = [&](size_t i) { return streams[i].current->address; };
+
+		// min-heap of streams ordered by document they are pointing to
+		const auto heap_compare = [&](size_t lhs, size_t rhs) { return std::less<const void *>{}(address_of(rhs), address_of(lhs)); };
+
+		std::vector<size_t> heap{};
+		heap.reserve(streams.size());
+
+		for (size_t i = 0z; i != streams.size(); ++i) {
+			heap.push_back(i);
+		}
+
+		std::make_heap(heap.begin(), heap.end(), heap_compare);
+
+		std::vector<fuzzy_match> result{};
+
+		while (!heap.empty()) {
+			const entry first = *streams[heap.front()].current;
+			const void * const address = first.address;
+			long long shared = 0;
+
+			// take all streams pointing to the same document
+			while (!heap.empty() && address_of(heap.front()) == address) {
+				std::pop_heap(heap.begin(), heap.end(), heap_compare);
+				stream & str = streams[heap.back()];
+
+				shared += str.weight;
+
+				// skip rest of positions in this document
+				while (str.current != str.end && str.current->address == address) {
+					++str.current;
+				}
+
+				if (str.current != str.end) {
+					std::push_heap(heap.begin(), heap.end(), heap_compare);
+				} else {
+					heap.pop_back();
+				}
+			}
+
+			if ((threshold > 0 && shared < threshold) || is_removed(first)) {
+				continue;
+			}
+
+			if (const auto distance = support::bounded_substring_distance(query, extractor(*first.pkey), max_edits)) {
+				result.emplace_back(first.pkey, *distance);
+			}
+		}
+
+		// best matches first
+		std::stable_sort(result.begin(), result.end(), [](const fuzzy_match & lhs, const fuzzy_match & rhs) { return lhs.distance < rhs.distance; });
+
+		return result;
+	}
+
+	size_t document_count() const noexcept {
+		return document_lengths.size();
+	}
+
+	double average_document_length() const noexcept {
+		return document_lengths.empty() ? 0.0 : static_cast<double>(total_length) / static_cast<double>(document_lengths.size());
+	}
+
+	unsigned document_frequency(support::ngram<N> value) const noexcept {
+		if (const auto it = statistics.find(value); it != statistics.end()) {
+			return it->second.documents;
+		}
+
+		return 0u;
+	}
+
+	struct bm25_parameters {
+		double k1{1.2};
+		double b{0.75};
+	};
+
+	struct scored_document {
+		PKey pkey;
+		double score;
+	};
+
+	// best `k` documents for query scored with BM25 over its ngrams (document doesn't need to contain all of them)
+	// WAND: postings are walked in document order and a document is scored only if upper bounds of its ngrams
+	// can beat current k-th best score, other postings are skipped with a seek
+	auto find_top_k(support::view_as_ngrams<N> input, size_t k, bm25_parameters params = {}) const -> std::vector<scored_document> {
+		const typename Instrumentation::scope _{instrumentation, operation::lookup};
+
+		std::vector<scored_document> best{};
+
+		if (k == 0z || document_lengths.empty()) {
+			return best;
+		}
+
+		const auto address_of = [](const entry & e) -> const void * { return e.address; };
+		const auto before = std::less<const void *>{};
+		const double documents = static_cast<double>(document_lengths.size());
+		const double average = average_document_length();
+
+		struct cursor {
+			const posting_set * postings;
+			typename posting_set::const_iterator it;
+			double weight;
+			double upper_bound;
+		};
+
+		std::vector<cursor> cursors{};
+
+		for_each_frequency(input, [&](const support::ngram<N> & value, unsigned query_frequency) {
+			const auto postings = data.find(value);
+			const auto stats = statistics.find(value);
+
+			if (postings == data.end() || stats == statistics.end()) {
+				return;
+			}
+
+			const double df = stats->second.documents;
+			const double idf = std::log(1.0 + (documents - df + 0.5) / (df + 0.5));
+			const double weight = idf * query_frequency;
+
+			// score grows with frequency and drops with length of the document, so empty document with max frequency is the best case
+			const double max_tf = stats->second.max_frequency;
+			const double upper_bound = weight * max_tf * (params.k1 + 1.0) / (max_tf + params.k1 * (1.0 - params.b));
+
+			cursors.push_back(cursor{&postings->second, postings->second.begin(), weight, upper_bound});
+		});
+
+		// min-heap of best documents, top is the k-th best
+		const auto worse = [](const scored_document & lhs, const scored_document & rhs) { return lhs.score > rhs.score; };
+
+		const auto document_of = [&](const cursor & c) { return address_of(*c.it); };
+
+		const auto skip_document = [&](cursor & c) -> unsigned {
+			const void * const address = document_of(c);
+			unsigned frequency = 0u;
+
+			while (c.it != c.postings->end() && address_of(*c.it) == address) {
+				++c.it;
+				++frequency;
+			}
+
+			return frequency;
+		};
+
+		while (!cursors.empty()) {
+			std::sort(cursors.begin(), cursors.end(), [&](const cursor & lhs, const cursor & rhs) { return before(document_of(lhs), document_of(rhs)); });
+
+			const bool full = (best.size() == k);
+			const double threshold = full ? best.front().score : 0.0;
+
+			// first document which can get over the threshold with all ngrams up to it
+			size_t pivot = 0z;
+			double sum = 0.0;
+
+			for (; pivot != cursors.size(); ++pivot) {
+				sum += cursors[pivot].upper_bound;
+
+				if (!full || sum > threshold) {
+					break;
+				}
+			}
+
+			if (pivot == cursors.size()) {
+				break;
+			}
+
+			const entry candidate = *cursors[pivot].it;
+			const void * const address = candidate.address;
+
+			if (document_of(cursors.front()) == address) {
+				// all preceding cursors are on the candidate => score it
+				double score = 0.0;
+				const bool removed = is_removed(candidate);
+				const auto length_it = document_lengths.find(address);
+				const double length = (length_it != document_lengths.end()) ? length_it->second.length : average;
+
+				for (cursor & c: cursors) {
+					if (c.it == c.postings->end() || document_of(c) != address) {
+						break;
+					}
+
+					const double tf = skip_document(c);
+					score += c.weight * tf * (params.k1 + 1.0) / (tf + params.k1 * (1.0 - params.b + params.b * length / average));
+				}
+
+				if (!removed && (!full || score > threshold)) {
+					if (full) {
+						std::pop_heap(best.begin(), best.end(), worse);
+						best.pop_back();
+					}
+
+					best.push_back(scored_document{candidate.pkey, score});
+					std::push_heap(best.begin(), best.end(), worse);
+				}
+			} else {
+				// nothing before pivot can get over the threshold => jump to the pivot document
+				for (size_t i = 0z; i != pivot; ++i) {
+					cursors[i].it = cursors[i].postings->lower_bound(candidate.at(0u));
+				}
+			}
+
+			std::erase_if(cursors, [](const cursor & c) { return c.it == c.postings->end(); });
+		}
+
+		std::sort_heap(best.begin(), best.end(), worse);
+
+		return best;
+	}
+};
+
+struct contains_string {
+	std::string_view input;
+
+	explicit constexpr contains_string(std::string_view in) noexcept: input{in} { }
+};
+
+// extractor stage which normalizes text of the record once when it's indexed
+// (same normalizer is used for queries, so only one lookup is needed for any variant of the query)
+template <typename Normalizer, typename Extractor = whole_record_as_string> struct normalizing_extractor {
+	Extractor extractor{};
+	Normalizer normalizer{};
+
+	constexpr auto operator()(const auto & record) -> support::normalized_text {
+		return normalizer(std::string_view(extractor(record)));
+	}
+
+	constexpr auto normalize(std::string_view query) const -> std::string {
+		return normalizer(query).text;
+	}
+};
+
+// ngrams of text of a record (as given by the extractor)
+template <typename Extractor = whole_record_as_string, size_t N = 4> struct basic_fulltext {
+	support::normalized_text content;
+
+	explicit constexpr basic_fulltext(const auto & record, Extractor extractor = {}): content{extract(extractor, record)} { }
+
+	constexpr auto text() const noexcept -> std::string_view {
+		return content.text;
+	}
+
+	constexpr auto ngrams() const noexcept -> support::view_as_ngrams<N> {
+		return text();
+	}
+
+	// iterator generating ngrams
+	constexpr auto begin() const noexcept {
+		return ngrams().begin();
+	}
+
+	constexpr auto end() const noexcept {
+		return ngrams().end();
+	}
+
+	constexpr unsigned original_position(unsigned position) const noexcept {
+		return content.original_position(position);
+	}
+
+	static constexpr auto normalize_query(const Extractor & extractor, std::string_view query) -> std::string {
+		if constexpr (requires { extractor.normalize(query); }) {
+			return extractor.normalize(query);
+		} else {
+			return std::string(query);
+		}
+	}
+
+private:
+	static constexpr auto extract(Extractor & extractor, const auto & record) -> support::normalized_text {
+		if constexpr (std::same_as<std::remove_cvref_t<decltype(extractor(record))>, support::normalized_text>) {
+			return extractor(record);
+		} else {
+			return support::normalized_text{std::string_view(extractor(record))};
+		}
+	}
+};
+
+// index of records, text of each record is extracted (and normalized) only once when it's inserted
+// queries are normalized same way and positions of matches are mapped back into the original text
+template <typename PKey, typename Extractor = whole_record_as_string, size_t N = 4> struct fulltext_index {
+	using reverse_index = simple_fulltext_reverse_index<PKey, N>;
+	using entry = fulltext_entry<PKey>;
+	using document_list = typename reverse_index::document_list;
+
+	reverse_index index{};
+	Extractor extractor{};
+
+	// positions in original text, only for records where normalization changed positions
+	std::unordered_map<const void *, std::vector<unsigned>> origins{};
+
+	size_t ngram_known() const noexcept {
+		return index.ngram_known();
+	}
+
+	size_t ngram_count() const noexcept {
+		return index.ngram_count();
+	}
+
+	void emplace(PKey pkey) {
+		basic_fulltext<Extractor, N> document{*pkey, extractor};
+
+		index.emplace(document.ngrams(), pkey);
+
+		if (!document.content.identity()) {
+			origins.insert_or_assign(std::addressof(*pkey), std::move(document.content.origin));
+		}
+	}
+
+	void remove(PKey pkey) {
+		index.remove(pkey);
+		origins.erase(std::addressof(*pkey));
+	}
+
+	void compact() {
+		index.compact();
+	}
+
+	auto find_all(std::string_view query) const -> std::set<entry> {
+		const auto normalized = basic_fulltext<Extractor, N>::normalize_query(extractor, query);
+
+		auto found = index.find_all(std::string_view{normalized});
+
+		if (origins.empty()) {
+			return found;
+		}
+
+		// mapping is monotonic, so order of entries is same
+		std::set<entry> result{};
+
+		for (const entry & e: found) {
+			result.emplace_hint(result.end(), e.pkey, original_position(e.pkey, e.position));
+		}
+
+		return result;
+	}
+
+	auto find_documents(std::string_view query) const -> document_list {
+		const auto normalized = basic_fulltext<Extractor, N>::normalize_query(extractor, query);
+		return index.find_documents(std::string_view{normalized});
+	}
+
+	unsigned original_position(const PKey & pkey, unsigned position) const noexcept {
+		if (const auto it = origins.find(std::addressof(*pkey)); it != origins.end()) {
+			return it->second[position];
+		}
+
+		return position;
 	}
 };
 
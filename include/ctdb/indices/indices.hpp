@@ -1,12 +1,22 @@
 #ifndef CTDB_INDICES_INDICES_HPP
 #define CTDB_INDICES_INDICES_HPP
 
+#include "../instrumentation.hpp"
+#include "../support/parallel-sort.hpp"
+#include "../support/work-stealing-pool.hpp"
 #include "../traits/traits.hpp"
+#include <algorithm>
+#include <array>
+#include <functional>
 #include <iterator>
+#include <span>
+#include <vector>
 
 namespace ctdb {
 
-template <typename PKey, typename...> struct indices_tuple;
+template <typename Instrumentation, typename PKey, typename...> struct basic_indices_tuple;
+
+template <typename PKey, typename... Indices> using indices_tuple = basic_indices_tuple<no_instrumentation, PKey, Indices...>;
 
 template <typename> inline constexpr bool type_is_not_compatible_with_any_index = false;
 template <typename> inline constexpr bool unknown_order_tag = false;
@@ -24,7 +34,7 @@ template <typename OrigIterator> struct index_iterator: OrigIterator {
 	constexpr index_iterator(OrigIterator orig): OrigIterator{orig} { }
 
 	constexpr reference_type operator*() const noexcept {
-		return OrigIterator::operator*().operator*();
+		return *OrigIterator::operator*();
 	}
 };
 
@@ -58,11 +68,25 @@ template <typename T> struct index_range {
 	}
 };
 
-template <typename PKey> struct indices_tuple<PKey> {
+template <typename Instrumentation, typename PKey> struct basic_indices_tuple<Instrumentation, PKey> {
+	static constexpr size_t index_count = 0z;
+
+	template <typename Type> static constexpr bool has_index_for = false;
+
 	constexpr bool insert(PKey) const noexcept {
 		return true;
 	}
 
+	constexpr bool bulk_insert(std::span<const PKey>, support::work_stealing_pool *) const noexcept {
+		return true;
+	}
+
+	constexpr bool insert_into(size_t, std::span<const PKey>, support::work_stealing_pool *) const noexcept {
+		return true;
+	}
+
+	constexpr void remove_from(size_t, std::span<const PKey>) const noexcept { }
+
 	constexpr bool remove(PKey) const noexcept {
 		return true;
 	}
@@ -76,17 +100,30 @@ template <typename PKey> struct indices_tuple<PKey> {
 		static_assert(type_is_not_compatible_with_any_index<Type>);
 		return 0z;
 	}
+
+	template <typename Type> constexpr auto index_for() const noexcept -> const basic_indices_tuple & {
+		static_assert(type_is_not_compatible_with_any_index<Type>);
+		return *this;
+	}
+
+	constexpr void memory_usage(memory_footprint *) const noexcept { }
 };
 
-template <typename PKey, typename Head, typename... Tail> struct indices_tuple<PKey, Head, Tail...> {
+// with enabled instrumentation storages count comparisons, hash probes and allocations
+template <typename Instrumentation, typename PKey, typename Head, typename... Tail> struct basic_indices_tuple<Instrumentation, PKey, Head, Tail...> {
 	using record_type = std::remove_cvref_t<decltype(*std::declval<PKey>())>;
-	using index_traits = index_storage_traits_of<Head>;
-	using storage_type = index_storage_of<Head, PKey>;
+	using index_traits = instrumented_index_traits_t<index_storage_traits_of<Head>, Instrumentation>;
+	using storage_type = typename index_traits::template storage_type<PKey>;
 
 	using helper = index_helper<index_traits, PKey>;
 
 	storage_type index_data;
-	indices_tuple<PKey, Tail...> tail;
+	basic_indices_tuple<Instrumentation, PKey, Tail...> tail;
+
+	static constexpr size_t index_count = 1z + basic_indices_tuple<Instrumentation, PKey, Tail...>::index_count;
+
+	// some index serves queries by `Type` (`index_for<Type>()` can be used)
+	template <typename Type> static constexpr bool has_index_for = helper::template compatible_type<Type> || basic_indices_tuple<Instrumentation, PKey, Tail...>::template has_index_for<Type>;
 
 	constexpr bool insert(PKey key) {
 		const auto opt_it = helper::insert(index_data, key);
@@ -103,10 +140,58 @@ template <typename PKey, typename Head, typename... Tail> struct indices_tuple<P
 		return true;
 	}
 
+	// insert many keys into all indices, each index is built by its own task (if there is a pool)
+	// it's all or nothing: if any index refuses any key, none of the keys is left in any index
+	bool bulk_insert(std::span<const PKey> keys, support::work_stealing_pool * pool) {
+		std::array<bool, index_count> inserted{};
+
+		const auto build = [&](size_t i) { inserted[i] = insert_into(i, keys, pool); };
+
+		if (pool != nullptr) {
+			pool->parallel_for(index_count, build);
+		} else {
+			for (size_t i = 0z; i != index_count; ++i) {
+				build(i);
+			}
+		}
+
+		if (std::ranges::all_of(inserted, std::identity{})) {
+			return true;
+		}
+
+		for (size_t i = 0z; i != index_count; ++i) {
+			if (inserted[i]) {
+				remove_from(i, keys);
+			}
+		}
+
+		return false;
+	}
+
+	bool insert_into(size_t index, std::span<const PKey> keys, support::work_stealing_pool * pool) {
+		if (index == 0z) {
+			return insert_own(keys, pool);
+		}
+
+		return tail.insert_into(index - 1z, keys, pool);
+	}
+
+	void remove_from(size_t index, std::span<const PKey> keys) noexcept {
+		if (index != 0z) {
+			tail.remove_from(index - 1z, keys);
+			return;
+		}
+
+		// all keys were accepted by this index, so lookup by key finds exactly its entry
+		for (const PKey & key: keys) {
+			helper::remove(index_data, helper::find(index_data, key));
+		}
+	}
+
 	constexpr bool remove(PKey key) noexcept {
 		const auto it = helper::find(index_data, key);
 
-		if (it == helper_end(index_data)) {
+		if (it == helper::end(index_data)) {
 			return false;
 		}
 
@@ -119,6 +204,57 @@ template <typename PKey, typename Head, typename... Tail> struct indices_tuple<P
 		return true;
 	}
 
+private:
+	// only this index (without the tail), all or nothing
+	bool insert_own(std::span<const PKey> keys, support::work_stealing_pool * pool) {
+		std::vector<typename helper::iterator_type> inserted{};
+		inserted.reserve(keys.size());
+
+		const auto rollback = [&] {
+			for (const auto it: inserted) {
+				helper::remove(index_data, it);
+			}
+
+			return false;
+		};
+
+		if constexpr (is_sorted_container<storage_type>) {
+			// sorted keys are inserted with exact hint (no tree search when the index was empty)
+			std::vector<PKey> sorted(keys.begin(), keys.end());
+			support::parallel_stable_sort(sorted.begin(), sorted.end(), index_data.key_comp(), pool);
+
+			auto hint = index_data.end();
+
+			for (const PKey & key: sorted) {
+				const size_t before = index_data.size();
+				const auto it = index_data.emplace_hint(hint, key);
+
+				if (index_data.size() == before) {
+					return rollback();
+				}
+
+				inserted.push_back(it);
+				hint = std::next(it);
+			}
+		} else {
+			// no rehashing, so collected iterators stay valid
+			index_data.reserve(index_data.size() + keys.size());
+
+			for (const PKey & key: keys) {
+				const auto opt_it = helper::insert(index_data, key);
+
+				if (!opt_it) {
+					return rollback();
+				}
+
+				inserted.push_back(*opt_it);
+			}
+		}
+
+		return true;
+	}
+
+public:
 	template <typename Type> constexpr auto size() const noexcept {
 		if constexpr (helper::template compatible_type<Type>) {
 			return helper::size(index_data);
@@ -139,12 +275,47 @@ template <typename PKey, typename Head, typename... Tail> struct indices_tuple<P
 
 	template <typename Type> constexpr auto equal(const Type & value) const noexcept {
 		if constexpr (helper::template compatible_type<Type>) {
-			return index_range{helper::lower_bound(index_data, value), helper::upper_bound(index_data, value)};
+			const auto [first, last] = helper::equal_range(index_data, value);
+			return index_range{first, last};
 
 		} else {
 			return tail.equal(value);
 		}
 	}
+
+	// half-open range [from, to) of a sorted index
+	template <typename Type> constexpr auto range(const Type & from, const Type & to) const noexcept {
+		if constexpr (helper::template compatible_type<Type>) {
+			return index_range{helper::lower_bound(index_data, from), helper::lower_bound(index_data, to)};
+
+		} else {
+			return tail.range(from, to);
+		}
+	}
+
+	// live memory of each index (in order of `Indices`), storage must use the tracking allocator
+	constexpr void memory_usage(memory_footprint * out) const noexcept
+	requires(Instrumentation::enabled)
+	{
+		if constexpr (requires { index_data.footprint(); }) {
+			// storage which is not a standard container knows its memory itself
+			*out = index_data.footprint();
+		} else {
+			*out = index_data.get_allocator().footprint();
+		}
+
+		tail.memory_usage(out + 1);
+	}
+
+	// storage of the index which is used for queries by `Type`
+	template <typename Type> constexpr const auto & index_for() const noexcept {
+		if constexpr (helper::template compatible_type<Type>) {
+			return index_data;
+
+		} else {
+			return tail.template index_for<Type>();
+		}
+	}
 };
 
 } // namespace ctdb
@@ -0,0 +1,240 @@
+#ifndef CTDB_INDICES_SEGMENTED_FULLTEXT_HPP
+#define CTDB_INDICES_SEGMENTED_FULLTEXT_HPP
+
+#include "../support/work-stealing-pool.hpp"
+#include "full-text.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <shared_mutex>
+#include <stop_token>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace ctdb {
+
+// full-text index built from immutable segments:
+// - each batch is split between tasks of a pool, each of them builds its own segment
+// - single documents are collected in a pending segment, which is published when it's full (or by `flush()`)
+// - background thread merges segments of same tier together (tiered / LSM style)
+// - readers take snapshot of current segment list and never see partially built segment
+template <typename PKey, size_t N> struct segmented_fulltext_reverse_index {
+	using segment_type = simple_fulltext_reverse_index<PKey, N>;
+	using entry = typename segment_type::entry;
+
+	struct segment {
+		std::shared_ptr<const segment_type> index;
+		unsigned tier;
+
+		constexpr segment(std::shared_ptr<const segment_type> i, unsigned t) noexcept: index{std::move(i)}, tier{t} { }
+	};
+
+	using snapshot_type = std::shared_ptr<const std::vector<segment>>;
+
+private:
+	mutable std::mutex lock{};
+	mutable std::condition_variable_any changed{};
+	snapshot_type current{std::make_shared<const std::vector<segment>>()};
+	size_t merge_factor;
+	bool merging{false};
+
+	// pending segment is guarded by its own lock (taken before `lock`)
+	mutable std::shared_mutex pending_lock{};
+	std::unique_ptr<segment_type> pending{};
+	size_t pending_documents{0z};
+	size_t pending_limit;
+
+	// must be last, so it's joined before everything else is destroyed
+	std::jthread merger;
+
+public:
+	explicit segmented_fulltext_reverse_index(size_t factor = 4z, size_t limit = 1024z): merge_factor{std::max(factor, size_t{2})}, pending_limit{std::max(limit, size_t{1})}, merger{[this](std::stop_token stop) { merge_loop(stop); }} { }
+
+	segmented_fulltext_reverse_index(const segmented_fulltext_reverse_index &) = delete;
+	segmented_fulltext_reverse_index & operator=(const segmented_fulltext_reverse_index &) = delete;
+
+	auto snapshot() const -> snapshot_type {
+		std::lock_guard guard{lock};
+		return current;
+	}
+
+	// published segments (pending one is not counted)
+	size_t segment_count() const {
+		return snapshot()->size();
+	}
+
+	size_t ngram_count() const {
+		size_t result = 0z;
+
+		for (const segment & seg: *snapshot()) {
+			result += seg.index->ngram_count();
+		}
+
+		return result;
+	}
+
+	// input is random-access range of (text, pkey) pairs, it's split into `parts` segments (one for each worker of the pool by default)
+	// which are built by tasks of the pool
+	template <typename Range> void emplace_batch(const Range & documents, size_t parts = 0z, support::work_stealing_pool * pool = nullptr) {
+		const auto first = std::ranges::begin(documents);
+		const auto size = static_cast<size_t>(std::ranges::distance(documents));
+
+		if (size == 0z) {
+			return;
+		}
+
+		support::work_stealing_pool & workers = (pool != nullptr) ? *pool : support::default_pool();
+		parts = std::clamp((parts != 0z) ? parts : workers.size(), size_t{1}, size);
+
+		std::vector<std::shared_ptr<const segment_type>> built(parts);
+
+		workers.parallel_for(parts, [&](size_t i) {
+			const auto begin = first + static_cast<std::ptrdiff_t>(size * i / parts);
+			const auto end = first + static_cast<std::ptrdiff_t>(size * (i + 1z) / parts);
+
+			auto seg = std::make_shared<segment_type>();
+			seg->emplace_batch(std::ranges::subrange(begin, end));
+			built[i] = std::move(seg);
+		});
+
+		publish([&](std::vector<segment> & segments) {
+			for (auto & seg: built) {
+				segments.emplace_back(std::move(seg), 0u);
+			}
+		});
+	}
+
+	// document is added into the pending segment (visible to readers at once), full pending segment is published
+	template <typename Text> void emplace(const Text & text, PKey pkey) {
+		std::unique_lock guard{pending_lock};
+
+		if (pending == nullptr) {
+			pending = std::make_unique<segment_type>();
+		}
+
+		pending->emplace(support::view_as_ngrams<N>(std::string_view{text}), pkey);
+
+		if (++pending_documents >= pending_limit) {
+			publish_pending();
+		}
+	}
+
+	// publish the pending segment (so it can be merged with others)
+	void flush() {
+		std::unique_lock guard{pending_lock};
+		publish_pending();
+	}
+
+	// fan out the query to all segments of a snapshot (and the pending one) and union results
+	auto find_all(support::view_as_ngrams<N> input) const -> std::set<entry> {
+		std::set<entry> result{};
+		snapshot_type segments{};
+
+		{
+			// snapshot is taken under the pending lock, so a document being published is seen exactly once
+			std::shared_lock guard{pending_lock};
+
+			if (pending != nullptr) {
+				result = pending->find_all(input);
+			}
+
+			segments = snapshot();
+		}
+
+		for (const segment & seg: *segments) {
+			result.merge(seg.index->find_all(input));
+		}
+
+		return result;
+	}
+
+	// block until background merger has nothing to do
+	void wait_for_merges() const {
+		std::unique_lock guard{lock};
+		changed.wait(guard, [&] { return !merging && !find_mergeable_tier(*current); });
+	}
+
+private:
+	// `pending_lock` must be held
+	void publish_pending() {
+		if (pending == nullptr) {
+			return;
+		}
+
+		std::shared_ptr<const segment_type> seg = std::move(pending);
+		pending_documents = 0z;
+
+		publish([&](std::vector<segment> & segments) { segments.emplace_back(std::move(seg), 0u); });
+	}
+
+	template <typename Fn> void publish(Fn && modify) {
+		{
+			std::lock_guard guard{lock};
+			auto next = std::make_shared<std::vector<segment>>(*current);
+			modify(*next);
+			current = std::move(next);
+		}
+
+		changed.notify_all();
+	}
+
+	auto find_mergeable_tier(const std::vector<segment> & segments) const noexcept -> std::optional<unsigned> {
+		// there is only a few segments, quadratic scan is fine
+		for (const segment & seg: segments) {
+			const auto same_tier = std::ranges::count_if(segments, [&](const segment & other) { return other.tier == seg.tier; });
+
+			if (static_cast<size_t>(same_tier) >= merge_factor) {
+				return seg.tier;
+			}
+		}
+
+		return std::nullopt;
+	}
+
+	void merge_loop(std::stop_token stop) {
+		while (!stop.stop_requested()) {
+			std::vector<std::shared_ptr<const segment_type>> inputs{};
+			unsigned tier = 0u;
+
+			{
+				std::unique_lock guard{lock};
+
+				if (!changed.wait(guard, stop, [&] { return find_mergeable_tier(*current).has_value(); })) {
+					return;
+				}
+
+				tier = *find_mergeable_tier(*current);
+
+				for (const segment & seg: *current) {
+					if (seg.tier == tier && inputs.size() < merge_factor) {
+						inputs.emplace_back(seg.index);
+					}
+				}
+
+				merging = true;
+			}
+
+			// merging is done outside of the lock, readers still see old segments
+			auto merged = std::make_shared<segment_type>(*inputs.front());
+
+			for (auto it = std::next(inputs.begin()); it != inputs.end(); ++it) {
+				merged->merge(**it);
+			}
+
+			publish([&](std::vector<segment> & segments) {
+				std::erase_if(segments, [&](const segment & seg) { return std::ranges::find(inputs, seg.index) != inputs.end(); });
+				segments.emplace_back(std::move(merged), tier + 1u);
+				merging = false;
+			});
+		}
+	}
+};
+
+} // namespace ctdb
+
+#endif
@@ -0,0 +1,183 @@
+#ifndef CTDB_INDICES_SUFFIX_ARRAY_HPP
+#define CTDB_INDICES_SUFFIX_ARRAY_HPP
+
+#include "full-text.hpp"
+#include "support/suffix-array.hpp"
+#include <algorithm>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+#include <cstdint>
+
+namespace ctdb {
+
+// substring index over concatenated texts of all documents
+// - answers queries of any length (unlike ngram index which needs at least N characters)
+// - each emplace rebuilds whole suffix array, so it's meant for static or rarely appended corpora
+// - uses same entries as `simple_fulltext_reverse_index`, so they are interchangeable
+template <typename PKey> struct suffix_array_index {
+	using entry = fulltext_entry<PKey>;
+
+	struct document {
+		size_t offset;
+		size_t length;
+		PKey pkey;
+
+		constexpr document(size_t o, size_t l, PKey pk) noexcept: offset{o}, length{l}, pkey{pk} { }
+	};
+
+	// all documents separated by '\0'
+	std::string text{};
+	std::vector<document> documents{};
+	std::vector<int32_t> suffixes{};
+
+	// removed documents stays in the text until next `compact()`
+	std::unordered_set<const void *> tombstones{};
+
+	size_t size() const noexcept {
+		return documents.size() - tombstones.size();
+	}
+
+	template <typename Range> void emplace_batch(const Range & input) {
+		for (const auto & [content, pkey]: input) {
+			append(std::string_view(content), pkey);
+		}
+
+		rebuild();
+	}
+
+	void emplace(std::string_view content, PKey pkey) {
+		append(content, pkey);
+		rebuild();
+	}
+
+	void remove(PKey pkey) {
+		tombstones.emplace(std::addressof(*pkey));
+	}
+
+	bool is_removed(const PKey & pkey) const noexcept {
+		return !tombstones.empty() && tombstones.contains(std::addressof(*pkey));
+	}
+
+	// rebuild text and suffix array without removed documents
+	void compact() {
+		if (tombstones.empty()) {
+			return;
+		}
+
+		auto old_text = std::move(text);
+		auto old_documents = std::move(documents);
+
+		text.clear();
+		documents.clear();
+
+		for (const document & doc: old_documents) {
+			if (!tombstones.contains(std::addressof(*doc.pkey))) {
+				append(std::string_view{old_text}.substr(doc.offset, doc.length), doc.pkey);
+			}
+		}
+
+		tombstones.clear();
+		rebuild();
+	}
+
+	// O(m log n) search for range of suffixes starting with the input
+	auto find_all(std::string_view input) const -> std::set<entry> {
+		std::set<entry> result{};
+
+		if (input.empty()) {
+			return result;
+		}
+
+		const auto [first, last] = equal_range(input);
+
+		for (size_t i = first; i != last; ++i) {
+			const auto offset = static_cast<size_t>(suffixes[i]);
+			const document & doc = document_of(offset);
+
+			// match can't cross boundary of a document (only possible if input contains separator)
+			if (offset + input.size() > doc.offset + doc.length || is_removed(doc.pkey)) {
+				continue;
+			}
+
+			result.emplace(doc.pkey, static_cast<unsigned>(offset - doc.offset));
+		}
+
+		return result;
+	}
+
+	auto equal_range(std::string_view input) const -> std::pair<size_t, size_t> {
+		return {bound(input, false), bound(input, true)};
+	}
+
+private:
+	void append(std::string_view content, PKey pkey) {
+		if (!documents.empty()) {
+			text += '\0';
+		}
+
+		documents.emplace_back(text.size(), content.size(), pkey);
+		text += content;
+	}
+
+	void rebuild() {
+		suffixes = support::build_suffix_array(text);
+	}
+
+	const document & document_of(size_t offset) const noexcept {
+		const auto it = std::upper_bound(documents.begin(), documents.end(), offset, [](size_t off, const document & doc) { return off < doc.offset; });
+		return *std::prev(it);
+	}
+
+	// compare input with suffix, first `skip` characters are known to be same
+	// returns <0 if input is smaller, 0 if suffix starts with input, >0 if input is bigger and length of common prefix
+	std::pair<int, size_t> compare(std::string_view input, size_t suffix, size_t skip) const noexcept {
+		const auto rest = std::string_view{text}.substr(suffix);
+
+		size_t i = skip;
+
+		while (i != input.size() && i != rest.size() && input[i] == rest[i]) {
+			++i;
+		}
+
+		if (i == input.size()) {
+			return {0, i};
+		}
+
+		if (i == rest.size()) {
+			return {1, i};
+		}
+
+		return {static_cast<unsigned char>(input[i]) < static_cast<unsigned char>(rest[i]) ? -1 : 1, i};
+	}
+
+	// first suffix which is not smaller than input (or bigger if `upper`)
+	// binary search remembers common prefix with both boundaries, so characters known to match are not compared again
+	size_t bound(std::string_view input, bool upper) const noexcept {
+		size_t lo = 0z;
+		size_t hi = suffixes.size();
+		size_t lcp_lo = 0z;
+		size_t lcp_hi = 0z;
+
+		while (lo < hi) {
+			const size_t mid = lo + (hi - lo) / 2z;
+			const auto [cmp, lcp] = compare(input, static_cast<size_t>(suffixes[mid]), std::min(lcp_lo, lcp_hi));
+
+			if (cmp < 0 || (cmp == 0 && !upper)) {
+				hi = mid;
+				lcp_hi = lcp;
+			} else {
+				lo = mid + 1z;
+				lcp_lo = lcp;
+			}
+		}
+
+		return lo;
+	}
+};
+
+} // namespace ctdb
+
+#endif
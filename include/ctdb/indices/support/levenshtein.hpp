@@ -0,0 +1,73 @@
+#ifndef CTDB_INDICES_SUPPORT_LEVENSHTEIN_HPP
+#define CTDB_INDICES_SUPPORT_LEVENSHTEIN_HPP
+
+#include <algorithm>
+#include <optional>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+
+namespace ctdb::support {
+
+// smallest edit distance between `pattern` and any substring of `text` (Sellers' algorithm)
+// only distances up to `max_edits` are interesting, so rows which can't get under the limit
+// are not computed at all (Ukkonen's cut-off) and it returns std::nullopt if there is no such substring
+constexpr auto bounded_substring_distance(std::string_view pattern, std::string_view text, unsigned max_edits) -> std::optional<unsigned> {
+	const size_t m = pattern.size();
+	const unsigned over_limit = max_edits + 1u;
+
+	// column of the DP matrix, row `i` is distance of pattern[0..i) to best substring ending at current position
+	std::vector<unsigned> column(m + 1z);
+
+	for (size_t i = 0z; i <= m; ++i) {
+		column[i] = static_cast<unsigned>(std::min<size_t>(i, over_limit));
+	}
+
+	// last row which is still within the limit
+	size_t last = std::min<size_t>(max_edits, m);
+
+	unsigned best = (last == m) ? column[m] : over_limit;
+
+	for (const char c: text) {
+		if (best == 0u) {
+			break;
+		}
+
+		const size_t limit = std::min(last + 1z, m);
+
+		if (last + 1z <= m) {
+			// row after last active one is over the limit by definition
+			column[last + 1z] = over_limit;
+		}
+
+		// substring can start anywhere => first row is always zero
+		unsigned diagonal = 0u;
+
+		for (size_t i = 1z; i <= limit; ++i) {
+			const unsigned previous = column[i];
+			const unsigned substitution = diagonal + (pattern[i - 1z] != c ? 1u : 0u);
+			column[i] = std::min({substitution, previous + 1u, column[i - 1z] + 1u, over_limit});
+			diagonal = previous;
+		}
+
+		last = limit;
+
+		while (last != 0z && column[last] > max_edits) {
+			--last;
+		}
+
+		if (last == m) {
+			best = std::min(best, column[m]);
+		}
+	}
+
+	if (best > max_edits) {
+		return std::nullopt;
+	}
+
+	return best;
+}
+
+} // namespace ctdb::support
+
+#endif
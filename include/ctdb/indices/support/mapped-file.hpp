@@ -0,0 +1,124 @@
+#ifndef CTDB_INDICES_SUPPORT_MAPPED_FILE_HPP
+#define CTDB_INDICES_SUPPORT_MAPPED_FILE_HPP
+
+#include <initializer_list>
+#include <optional>
+#include <span>
+#include <utility>
+#include <cerrno>
+#include <cstddef>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ctdb::support {
+
+// read-only memory mapping of whole file (POSIX)
+// pages are shared between all processes mapping same file
+class mapped_file {
+	const std::byte * ptr{nullptr};
+	size_t length{0z};
+
+	constexpr mapped_file(const std::byte * p, size_t l) noexcept: ptr{p}, length{l} { }
+
+public:
+	constexpr mapped_file() noexcept = default;
+
+	static auto open(const char * path) noexcept -> std::optional<mapped_file> {
+		const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+
+		if (fd < 0) {
+			return std::nullopt;
+		}
+
+		struct stat info { };
+
+		if (::fstat(fd, &info) != 0 || info.st_size <= 0) {
+			::close(fd);
+			return std::nullopt;
+		}
+
+		const auto size = static_cast<size_t>(info.st_size);
+		void * address = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+
+		// mapping keeps its own reference to the file
+		::close(fd);
+
+		if (address == MAP_FAILED) {
+			return std::nullopt;
+		}
+
+		return mapped_file{static_cast<const std::byte *>(address), size};
+	}
+
+	constexpr mapped_file(mapped_file && other) noexcept: ptr{std::exchange(other.ptr, nullptr)}, length{std::exchange(other.length, 0z)} { }
+
+	mapped_file & operator=(mapped_file && other) noexcept {
+		mapped_file tmp{std::move(other)};
+		std::swap(ptr, tmp.ptr);
+		std::swap(length, tmp.length);
+		return *this;
+	}
+
+	mapped_file(const mapped_file &) = delete;
+	mapped_file & operator=(const mapped_file &) = delete;
+
+	~mapped_file() noexcept {
+		if (ptr != nullptr) {
+			::munmap(const_cast<std::byte *>(ptr), length);
+		}
+	}
+
+	constexpr auto bytes() const noexcept -> std::span<const std::byte> {
+		return {ptr, length};
+	}
+
+	constexpr size_t size() const noexcept {
+		return length;
+	}
+};
+
+// write all parts into a new file (replacing existing one) and flush it to the disk before returning (POSIX)
+inline bool write_synced_file(const char * path, std::initializer_list<std::span<const std::byte>> parts) noexcept {
+	const int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+	if (fd < 0) {
+		return false;
+	}
+
+	bool ok = true;
+
+	for (auto part: parts) {
+		while (ok && !part.empty()) {
+			const auto written = ::write(fd, part.data(), part.size());
+
+			if (written < 0) {
+				ok = (errno == EINTR);
+				continue;
+			}
+
+			part = part.subspan(static_cast<size_t>(written));
+		}
+	}
+
+	ok = ok && ::fsync(fd) == 0;
+	return (::close(fd) == 0) && ok;
+}
+
+// make changes of directory entries (created and renamed files) durable (POSIX)
+inline bool sync_directory(const char * path) noexcept {
+	const int fd = ::open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+	if (fd < 0) {
+		return false;
+	}
+
+	const bool ok = ::fsync(fd) == 0;
+	return (::close(fd) == 0) && ok;
+}
+
+} // namespace ctdb::support
+
+#endif
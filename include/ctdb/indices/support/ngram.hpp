@@ -2,9 +2,14 @@
 #define CTDB_INDICES_SUPPORT_NGRAM_HPP
 
 #include <array>
+#include <limits>
 #include <ostream>
+#include <tuple>
+#include <type_traits>
+#include <vector>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
 
 namespace ctdb::support {
 
@@ -62,6 +67,37 @@ public:
 	}
 };
 
+// ngrams up to 8 characters can be packed into an integer with same ordering
+template <size_t N> constexpr inline bool ngram_is_packable = (N <= sizeof(uint64_t));
+
+// char can be signed, we need to flip the sign bit to keep order of ngram's operator<=>
+constexpr inline unsigned char ngram_order_mask = std::is_signed_v<char> ? 0x80u : 0x00u;
+
+template <size_t N> constexpr auto pack_ngram(const ngram<N> & in) noexcept -> uint64_t
+requires(ngram_is_packable<N>)
+{
+	uint64_t result{0};
+
+	for (size_t i = 0z; i != N; ++i) {
+		result = (result << 8u) | static_cast<unsigned char>(static_cast<unsigned char>(in.value[i]) ^ ngram_order_mask);
+	}
+
+	return result;
+}
+
+template <size_t N> constexpr auto unpack_ngram(uint64_t in) noexcept -> ngram<N>
+requires(ngram_is_packable<N>)
+{
+	std::array<char, N> tmp{};
+
+	for (size_t i = N; i != 0z; --i) {
+		tmp[i - 1z] = static_cast<char>(static_cast<unsigned char>(in & 0xFFu) ^ ngram_order_mask);
+		in >>= 8u;
+	}
+
+	return ngram<N>{tmp.data()};
+}
+
 template <size_t N> struct ngram_with_position {
 	using value_type = ngram<N>;
 
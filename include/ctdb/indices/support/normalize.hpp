@@ -0,0 +1,302 @@
+#ifndef CTDB_INDICES_SUPPORT_NORMALIZE_HPP
+#define CTDB_INDICES_SUPPORT_NORMALIZE_HPP
+
+#include "simd.hpp"
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace ctdb::support {
+
+// text prepared for indexing with map of each character back into the original text
+// `origin` is empty when positions didn't change (most of the time, ASCII only text)
+struct normalized_text {
+	std::string text{};
+	std::vector<unsigned> origin{};
+
+	constexpr normalized_text() noexcept = default;
+	constexpr normalized_text(std::string_view in): text{in} { }
+
+	constexpr unsigned original_position(unsigned position) const noexcept {
+		if (origin.empty()) {
+			return position;
+		}
+
+		return origin[position];
+	}
+
+	constexpr bool identity() const noexcept {
+		return origin.empty();
+	}
+};
+
+constexpr auto encode_utf8(char32_t cp, char * out) noexcept -> size_t {
+	if (cp < 0x80u) {
+		out[0] = static_cast<char>(cp);
+		return 1z;
+	} else if (cp < 0x800u) {
+		out[0] = static_cast<char>(0xC0u | (cp >> 6u));
+		out[1] = static_cast<char>(0x80u | (cp & 0x3Fu));
+		return 2z;
+	} else if (cp < 0x10000u) {
+		out[0] = static_cast<char>(0xE0u | (cp >> 12u));
+		out[1] = static_cast<char>(0x80u | ((cp >> 6u) & 0x3Fu));
+		out[2] = static_cast<char>(0x80u | (cp & 0x3Fu));
+		return 3z;
+	} else {
+		out[0] = static_cast<char>(0xF0u | (cp >> 18u));
+		out[1] = static_cast<char>(0x80u | ((cp >> 12u) & 0x3Fu));
+		out[2] = static_cast<char>(0x80u | ((cp >> 6u) & 0x3Fu));
+		out[3] = static_cast<char>(0x80u | (cp & 0x3Fu));
+		return 4z;
+	}
+}
+
+// decode one code point, returns its length or 0 if the sequence is not valid
+constexpr auto decode_utf8(std::string_view in, char32_t & cp) noexcept -> size_t {
+	const auto at = [&](size_t i) { return static_cast<unsigned char>(in[i]); };
+
+	const unsigned char lead = at(0);
+	size_t length = 0z;
+
+	if (lead >= 0xC2u && lead <= 0xDFu) {
+		length = 2z;
+		cp = lead & 0x1Fu;
+	} else if (lead >= 0xE0u && lead <= 0xEFu) {
+		length = 3z;
+		cp = lead & 0x0Fu;
+	} else if (lead >= 0xF0u && lead <= 0xF4u) {
+		length = 4z;
+		cp = lead & 0x07u;
+	} else {
+		return 0z;
+	}
+
+	if (in.size() < length) {
+		return 0z;
+	}
+
+	for (size_t i = 1z; i != length; ++i) {
+		if ((at(i) & 0xC0u) != 0x80u) {
+			return 0z;
+		}
+
+		cp = (cp << 6u) | (at(i) & 0x3Fu);
+	}
+
+	// overlong sequences and surrogates
+	if ((length == 3z && (cp < 0x800u || (cp >= 0xD800u && cp <= 0xDFFFu))) || (length == 4z && (cp < 0x10000u || cp > 0x10FFFFu))) {
+		return 0z;
+	}
+
+	return length;
+}
+
+// simple (one to one) lowercase of Latin-1, Latin Extended-A, Greek and Cyrillic
+constexpr auto lowercase_code_point(char32_t cp) noexcept -> char32_t {
+	if (cp >= 0xC0u && cp <= 0xDEu && cp != 0xD7u) {
+		return cp + 0x20u;
+	}
+
+	if (cp == 0x130u) {
+		return U'i';
+	}
+
+	if ((cp >= 0x100u && cp <= 0x137u) || (cp >= 0x14Au && cp <= 0x177u)) {
+		return cp | 1u;
+	}
+
+	if ((cp >= 0x139u && cp <= 0x148u) || (cp >= 0x179u && cp <= 0x17Eu)) {
+		return (cp & 1u) ? cp + 1u : cp;
+	}
+
+	if (cp == 0x178u) {
+		return 0xFFu;
+	}
+
+	if (cp >= 0x391u && cp <= 0x3A9u && cp != 0x3A2u) {
+		return cp + 0x20u;
+	}
+
+	if (cp >= 0x410u && cp <= 0x42Fu) {
+		return cp + 0x20u;
+	}
+
+	if (cp >= 0x400u && cp <= 0x40Fu) {
+		return cp + 0x50u;
+	}
+
+	return cp;
+}
+
+// base letter of Latin-1 and Latin Extended-A letters with diacritics, or 0 if there is none
+constexpr auto base_letter(char32_t cp) noexcept -> char {
+	// '_' marks letters without a base letter (Æ, ß, Œ, ...) and other symbols
+	constexpr std::string_view latin1 = "aaaaaa_ceeeeiiiidnooooo_ouuuuy__aaaaaa_ceeeeiiiidnooooo_ouuuuy_y";
+	constexpr std::string_view extended_a = "aaaaaaccccccccdd"
+											"ddeeeeeeeeeegggg"
+											"gggghhhhiiiiiiii"
+											"ii__jjkkklllllll"
+											"lllnnnnnnn__oooo"
+											"oo__rrrrrrssssss"
+											"ssttttttuuuuuuuu"
+											"uuuuwwyyyzzzzzzs";
+
+	static_assert(latin1.size() == 0x40z);
+	static_assert(extended_a.size() == 0x80z);
+
+	char result = '_';
+
+	if (cp >= 0xC0u && cp <= 0xFFu) {
+		result = latin1[cp - 0xC0u];
+	} else if (cp >= 0x100u && cp <= 0x17Fu) {
+		result = extended_a[cp - 0x100u];
+	}
+
+	return (result == '_') ? '\0' : result;
+}
+
+// only ASCII letters are lowercased, everything else is kept as is (positions never change)
+struct ascii_folding {
+	auto operator()(std::string_view input) const -> normalized_text {
+		normalized_text result{};
+		result.text.resize(input.size());
+
+		for (size_t i = 0z; i != input.size();) {
+			i += ascii_lowercase_prefix(input.substr(i), result.text.data() + i);
+
+			if (i != input.size()) {
+				result.text[i] = input[i];
+				++i;
+			}
+		}
+
+		return result;
+	}
+};
+
+// case folding of UTF-8 text (and optionally removal of diacritics: "Šarlota" => "sarlota")
+// invalid UTF-8 sequences are copied as they are
+template <bool RemoveDiacritics> struct unicode_folding {
+	auto operator()(std::string_view input) const -> normalized_text {
+		normalized_text result{};
+
+		// folded character is never longer than the original one
+		result.text.resize(input.size());
+
+		char * const out = result.text.data();
+		size_t o = 0z;
+		size_t i = 0z;
+
+		// `origin` is built only after first character which changed its length
+		bool same_positions = true;
+
+		const auto emit = [&](std::string_view folded, size_t length) {
+			if (same_positions && folded.size() != length) {
+				same_positions = false;
+				result.origin.resize(o);
+
+				for (size_t k = 0z; k != o; ++k) {
+					result.origin[k] = static_cast<unsigned>(k);
+				}
+			}
+
+			if (!same_positions) {
+				result.origin.insert(result.origin.end(), folded.size(), static_cast<unsigned>(i));
+			}
+
+			std::copy(folded.begin(), folded.end(), out + o);
+			o += folded.size();
+			i += length;
+		};
+
+		while (i != input.size()) {
+			// fast path for ASCII runs
+			const size_t ascii = ascii_lowercase_prefix(input.substr(i), out + o);
+
+			if (!same_positions) {
+				for (size_t k = 0z; k != ascii; ++k) {
+					result.origin.push_back(static_cast<unsigned>(i + k));
+				}
+			}
+
+			i += ascii;
+			o += ascii;
+
+			if (i == input.size()) {
+				break;
+			}
+
+			char32_t cp{};
+			const size_t length = decode_utf8(input.substr(i), cp);
+
+			if (length == 0z) {
+				emit(input.substr(i, 1z), 1z);
+				continue;
+			}
+
+			if constexpr (RemoveDiacritics) {
+				if (const char base = base_letter(cp); base != '\0') {
+					emit(std::string_view{&base, 1z}, length);
+					continue;
+				}
+			}
+
+			char buffer[4]{};
+			emit(std::string_view{buffer, encode_utf8(lowercase_code_point(cp), buffer)}, length);
+		}
+
+		result.text.resize(o);
+
+		if (!same_positions) {
+			// one past the end
+			result.origin.push_back(static_cast<unsigned>(input.size()));
+		}
+
+		return result;
+	}
+};
+
+using fold_case = unicode_folding<false>;
+using fold_case_and_diacritics = unicode_folding<true>;
+
+// apply normalizers one after another, positions are mapped through all of them
+template <typename... Normalizers> struct normalizer_chain {
+	std::tuple<Normalizers...> normalizers{};
+
+	auto operator()(std::string_view input) const -> normalized_text {
+		normalized_text result{input};
+
+		std::apply([&](const auto &... normalizer) { ((result = then(std::move(result), normalizer)), ...); }, normalizers);
+
+		return result;
+	}
+
+private:
+	static auto then(normalized_text previous, const auto & normalizer) -> normalized_text {
+		normalized_text next = normalizer(previous.text);
+
+		if (previous.identity()) {
+			return next;
+		}
+
+		if (next.identity()) {
+			next.origin = std::move(previous.origin);
+			return next;
+		}
+
+		for (unsigned & position: next.origin) {
+			position = previous.origin[position];
+		}
+
+		return next;
+	}
+};
+
+} // namespace ctdb::support
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef CTDB_INDICES_SUPPORT_RADIX_SORT_HPP
+#define CTDB_INDICES_SUPPORT_RADIX_SORT_HPP
+
+#include <array>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace ctdb::support {
+
+// stable LSD radix sort over lowest `Bytes` bytes of an unsigned key
+// (key is extracted from each element with `get_key`)
+template <size_t Bytes, typename T, typename KeyFn> constexpr void radix_sort(std::vector<T> & input, KeyFn get_key) {
+	static_assert(Bytes > 0z && Bytes <= sizeof(uint64_t));
+
+	if (input.size() < 2z) {
+		return;
+	}
+
+	std::vector<T> buffer{};
+	buffer.reserve(input.size());
+
+	for (size_t pass = 0z; pass != Bytes; ++pass) {
+		const unsigned shift = static_cast<unsigned>(pass * 8z);
+
+		std::array<size_t, 256> offsets{};
+
+		for (const T & item: input) {
+			++offsets[static_cast<uint64_t>(get_key(item) >> shift) & 0xFFu];
+		}
+
+		// all keys have same byte => this pass wouldn't change anything
+		if (offsets[static_cast<uint64_t>(get_key(input.front()) >> shift) & 0xFFu] == input.size()) {
+			continue;
+		}
+
+		size_t sum = 0z;
+		for (size_t & offset: offsets) {
+			const size_t tmp = offset;
+			offset = sum;
+			sum += tmp;
+		}
+
+		buffer.resize(input.size(), input.front());
+
+		for (T & item: input) {
+			buffer[offsets[static_cast<uint64_t>(get_key(item) >> shift) & 0xFFu]++] = std::move(item);
+		}
+
+		input.swap(buffer);
+	}
+}
+
+} // namespace ctdb::support
+
+#endif
@@ -0,0 +1,446 @@
+#ifndef CTDB_INDICES_SUPPORT_REGEX_QUERY_HPP
+#define CTDB_INDICES_SUPPORT_REGEX_QUERY_HPP
+
+#include "text-query.hpp"
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+
+namespace ctdb::support {
+
+// derive substrings which must be present in any text matching a regular expression
+// (only literals at least `MinLength` long are kept, as shorter can't be searched in ngram index)
+//
+// supported subset of ECMAScript syntax: literals, escapes, `.`, `[...]`, groups, `|`, `^`, `$`
+// and quantifiers `*`, `+`, `?`, `{m,n}` (including lazy/possessive variants)
+// everything it doesn't understand is treated as "anything", so the result is always a superset
+template <size_t MinLength> struct regex_query_compiler {
+	std::string_view pattern;
+	size_t pos{0z};
+
+	struct sequence {
+		std::vector<text_query> required{};
+		std::string run{};
+
+		constexpr void flush() {
+			if (run.size() >= MinLength) {
+				required.emplace_back(text_query::substring(run));
+			}
+			run.clear();
+		}
+	};
+
+	enum class repeat { once, at_least_once, optional };
+
+	constexpr bool finished() const noexcept {
+		return pos >= pattern.size();
+	}
+
+	constexpr char peek() const noexcept {
+		return pattern[pos];
+	}
+
+	constexpr auto compile() -> text_query {
+		auto result = alternation();
+
+		if (!finished()) {
+			// unbalanced parenthesis => we can't say anything
+			return text_query::everything();
+		}
+
+		return result;
+	}
+
+	constexpr auto alternation() -> text_query {
+		std::vector<text_query> branches{};
+		branches.emplace_back(branch());
+
+		while (!finished() && peek() == '|') {
+			++pos;
+			branches.emplace_back(branch());
+		}
+
+		return text_query::any_of(std::move(branches));
+	}
+
+	constexpr auto branch() -> text_query {
+		sequence seq{};
+
+		while (!finished() && peek() != '|' && peek() != ')') {
+			const char c = peek();
+
+			if (c == '(') {
+				++pos;
+
+				// non-capturing groups and other extensions
+				if (!finished() && peek() == '?') {
+					++pos;
+					if (!finished() && peek() == ':') {
+						++pos;
+					} else {
+						// lookarounds and named groups are not supported, treat them as anything
+						skip_group();
+						seq.flush();
+						quantifier();
+						continue;
+					}
+				}
+
+				auto group = alternation();
+
+				if (finished() || peek() != ')') {
+					return text_query::everything();
+				}
+
+				++pos;
+				seq.flush();
+
+				if (quantifier() != repeat::optional) {
+					seq.required.emplace_back(std::move(group));
+				}
+
+				continue;
+			}
+
+			if (c == '[') {
+				skip_class();
+				seq.flush();
+				quantifier();
+				continue;
+			}
+
+			if (c == '.' || c == '^' || c == '$') {
+				++pos;
+				seq.flush();
+				quantifier();
+				continue;
+			}
+
+			char literal = c;
+			++pos;
+
+			if (c == '\\') {
+				if (finished()) {
+					return text_query::everything();
+				}
+
+				const auto decoded = escape();
+
+				if (!decoded) {
+					// character classes (\d, \w, ...), assertions (\b), backreferences and code points we can't encode
+					seq.flush();
+					quantifier();
+					continue;
+				}
+
+				literal = *decoded;
+			}
+
+			switch (quantifier()) {
+			case repeat::once:
+				seq.run += literal;
+				break;
+			case repeat::at_least_once:
+				// text continues with the same character
+				seq.run += literal;
+				seq.flush();
+				seq.run += literal;
+				break;
+			case repeat::optional:
+				seq.flush();
+				break;
+			}
+		}
+
+		seq.flush();
+		return text_query::all_of(std::move(seq.required));
+	}
+
+	static constexpr auto hex_value(char c) noexcept -> std::optional<unsigned> {
+		if (c >= '0' && c <= '9') {
+			return static_cast<unsigned>(c - '0');
+		} else if (c >= 'a' && c <= 'f') {
+			return static_cast<unsigned>(c - 'a') + 10u;
+		} else if (c >= 'A' && c <= 'F') {
+			return static_cast<unsigned>(c - 'A') + 10u;
+		}
+		return std::nullopt;
+	}
+
+	// up to `digits` hex digits (all of them must be there)
+	constexpr auto hex_number(size_t digits) noexcept -> std::optional<unsigned> {
+		unsigned result = 0u;
+
+		for (size_t i = 0z; i != digits; ++i) {
+			if (finished() || !hex_value(peek())) {
+				return std::nullopt;
+			}
+
+			result = result * 16u + *hex_value(peek());
+			++pos;
+		}
+
+		return result;
+	}
+
+	// we are after `\`, escape with all its arguments is consumed
+	// returns the character or nothing when it's not a single known character
+	constexpr auto escape() noexcept -> std::optional<char> {
+		const char c = peek();
+		++pos;
+
+		const auto ascii = [](std::optional<unsigned> value) -> std::optional<char> {
+			if (!value || *value >= 0x80u) {
+				// other code points depend on encoding of the text
+				return std::nullopt;
+			}
+			return static_cast<char>(*value);
+		};
+
+		switch (c) {
+		case 'n':
+			return '\n';
+		case 't':
+			return '\t';
+		case 'r':
+			return '\r';
+		case 'f':
+			return '\f';
+		case 'v':
+			return '\v';
+		case 'x':
+			return ascii(hex_number(2z));
+		case 'u':
+			if (!finished() && peek() == '{') {
+				const size_t end = pattern.find('}', pos);
+
+				if (end == std::string_view::npos || end == pos + 1z) {
+					return std::nullopt;
+				}
+
+				++pos;
+				const auto value = hex_number(end - pos);
+				pos = end + 1z;
+				return ascii(value);
+			}
+			return ascii(hex_number(4z));
+		case 'c':
+			if (!finished() && ((peek() >= 'a' && peek() <= 'z') || (peek() >= 'A' && peek() <= 'Z'))) {
+				const char control = static_cast<char>(peek() % 32);
+				++pos;
+				return control;
+			}
+			return std::nullopt;
+		case 'k':
+			// named backreference `\k<name>`
+			if (!finished() && peek() == '<') {
+				const size_t end = pattern.find('>', pos);
+				pos = (end == std::string_view::npos) ? pattern.size() : end + 1z;
+			}
+			return std::nullopt;
+		case '0':
+			if (finished() || peek() < '0' || peek() > '9') {
+				return '\0';
+			}
+			[[fallthrough]];
+		case '1':
+		case '2':
+		case '3':
+		case '4':
+		case '5':
+		case '6':
+		case '7':
+		case '8':
+		case '9':
+			// backreference (with all its digits)
+			while (!finished() && peek() >= '0' && peek() <= '9') {
+				++pos;
+			}
+			return std::nullopt;
+		case 'd':
+		case 'D':
+		case 'w':
+		case 'W':
+		case 's':
+		case 'S':
+		case 'b':
+		case 'B':
+			return std::nullopt;
+		default:
+			return c;
+		}
+	}
+
+	constexpr auto quantifier() -> repeat {
+		if (finished()) {
+			return repeat::once;
+		}
+
+		auto result = repeat::once;
+
+		switch (peek()) {
+		case '*':
+		case '?':
+			++pos;
+			result = repeat::optional;
+			break;
+		case '+':
+			++pos;
+			result = repeat::at_least_once;
+			break;
+		case '{': {
+			const size_t start = pos;
+			++pos;
+			size_t minimum = 0z;
+			bool has_digit = false;
+			bool bounded = true;
+			size_t maximum = 0z;
+
+			while (!finished() && peek() >= '0' && peek() <= '9') {
+				minimum = minimum * 10z + static_cast<size_t>(peek() - '0');
+				has_digit = true;
+				++pos;
+			}
+
+			maximum = minimum;
+
+			if (!finished() && peek() == ',') {
+				++pos;
+				bounded = !finished() && peek() >= '0' && peek() <= '9';
+				maximum = 0z;
+
+				while (!finished() && peek() >= '0' && peek() <= '9') {
+					maximum = maximum * 10z + static_cast<size_t>(peek() - '0');
+					++pos;
+				}
+			}
+
+			if (finished() || !has_digit || peek() != '}') {
+				// not a quantifier, but a literal `{`
+				pos = start;
+				return repeat::once;
+			}
+
+			++pos;
+
+			if (minimum == 0z) {
+				result = repeat::optional;
+			} else if (minimum == 1z && bounded && maximum == 1z) {
+				result = repeat::once;
+			} else {
+				result = repeat::at_least_once;
+			}
+			break;
+		}
+		default:
+			return repeat::once;
+		}
+
+		// lazy and possessive modifiers doesn't change anything for us
+		if (!finished() && (peek() == '?' || peek() == '+')) {
+			++pos;
+		}
+
+		return result;
+	}
+
+	constexpr void skip_class() noexcept {
+		// we are at `[`
+		++pos;
+
+		if (!finished() && peek() == '^') {
+			++pos;
+		}
+
+		// `]` right after opening is literal
+		if (!finished() && peek() == ']') {
+			++pos;
+		}
+
+		while (!finished() && peek() != ']') {
+			if (peek() == '\\') {
+				++pos;
+			}
+			++pos;
+		}
+
+		if (!finished()) {
+			++pos;
+		}
+	}
+
+	constexpr void skip_group() noexcept {
+		// we are after `(?`, skip to matching parenthesis
+		unsigned depth = 1u;
+
+		while (!finished() && depth != 0u) {
+			if (peek() == '\\') {
+				++pos;
+			} else if (peek() == '[') {
+				skip_class();
+				continue;
+			} else if (peek() == '(') {
+				++depth;
+			} else if (peek() == ')') {
+				--depth;
+			}
+			++pos;
+		}
+	}
+};
+
+template <size_t MinLength> constexpr auto regex_to_query(std::string_view pattern) -> text_query {
+	return regex_query_compiler<MinLength>{pattern}.compile();
+}
+
+// glob pattern (`*`, `?`, `[...]` and `\` escape)
+template <size_t MinLength> constexpr auto glob_to_query(std::string_view pattern) -> text_query {
+	std::vector<text_query> required{};
+	std::string run{};
+
+	auto flush = [&] {
+		if (run.size() >= MinLength) {
+			required.emplace_back(text_query::substring(run));
+		}
+		run.clear();
+	};
+
+	for (size_t i = 0z; i < pattern.size(); ++i) {
+		switch (pattern[i]) {
+		case '*':
+		case '?':
+			flush();
+			break;
+		case '[':
+			flush();
+			// skip to end of the class
+			++i;
+			if (i < pattern.size() && (pattern[i] == '!' || pattern[i] == '^')) {
+				++i;
+			}
+			if (i < pattern.size() && pattern[i] == ']') {
+				++i;
+			}
+			while (i < pattern.size() && pattern[i] != ']') {
+				++i;
+			}
+			break;
+		case '\\':
+			if (++i < pattern.size()) {
+				run += pattern[i];
+			}
+			break;
+		default:
+			run += pattern[i];
+		}
+	}
+
+	flush();
+	return text_query::all_of(std::move(required));
+}
+
+} // namespace ctdb::support
+
+#endif
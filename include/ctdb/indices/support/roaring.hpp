@@ -0,0 +1,440 @@
+#ifndef CTDB_INDICES_SUPPORT_ROARING_HPP
+#define CTDB_INDICES_SUPPORT_ROARING_HPP
+
+#include "simd.hpp"
+#include <algorithm>
+#include <bit>
+#include <iterator>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace ctdb::support {
+
+// compressed set of 64bit values (roaring bitmap)
+// - values are split into chunks by their upper 48 bits, each chunk keeps only the lower 16 bits
+// - sparse chunk is a sorted array of 16bit values (2 bytes per value)
+// - dense chunk (more than `array_limit` values) is a bitmap of all 65536 values (8kB)
+class roaring_bitmap {
+public:
+	static constexpr size_t chunk_bits = 65536z;
+	static constexpr size_t chunk_words = chunk_bits / 64z;
+	static constexpr size_t array_limit = 4096z;
+
+private:
+	struct chunk {
+		uint64_t high{0u};
+		size_t count{0z};
+		std::vector<uint16_t> array{};
+		std::vector<uint64_t> words{};
+
+		constexpr bool dense() const noexcept {
+			return !words.empty();
+		}
+
+		constexpr bool contains(uint16_t low) const noexcept {
+			if (dense()) {
+				return (words[low / 64u] >> (low % 64u)) & 1u;
+			}
+
+			return std::binary_search(array.begin(), array.end(), low);
+		}
+
+		constexpr bool add(uint16_t low) {
+			if (dense()) {
+				uint64_t & word = words[low / 64u];
+				const uint64_t bit = uint64_t{1} << (low % 64u);
+
+				if (word & bit) {
+					return false;
+				}
+
+				word |= bit;
+				++count;
+				return true;
+			}
+
+			const auto it = std::lower_bound(array.begin(), array.end(), low);
+
+			if (it != array.end() && *it == low) {
+				return false;
+			}
+
+			array.insert(it, low);
+			++count;
+
+			if (count > array_limit) {
+				to_dense();
+			}
+
+			return true;
+		}
+
+		constexpr bool remove(uint16_t low) {
+			if (dense()) {
+				uint64_t & word = words[low / 64u];
+				const uint64_t bit = uint64_t{1} << (low % 64u);
+
+				if (!(word & bit)) {
+					return false;
+				}
+
+				word &= ~bit;
+				--count;
+
+				// half of the limit, so add/remove around the limit doesn't convert every time
+				if (count <= array_limit / 2z) {
+					to_array();
+				}
+
+				return true;
+			}
+
+			const auto it = std::lower_bound(array.begin(), array.end(), low);
+
+			if (it == array.end() || *it != low) {
+				return false;
+			}
+
+			array.erase(it);
+			--count;
+			return true;
+		}
+
+		constexpr void to_dense() {
+			words.assign(chunk_words, 0u);
+
+			for (const uint16_t low: array) {
+				words[low / 64u] |= uint64_t{1} << (low % 64u);
+			}
+
+			array = {};
+		}
+
+		constexpr void to_array() {
+			std::vector<uint16_t> result{};
+			result.reserve(count);
+
+			for (size_t w = 0z; w != chunk_words; ++w) {
+				for (uint64_t word = words[w]; word != 0u; word &= word - 1u) {
+					result.push_back(static_cast<uint16_t>(w * 64z + static_cast<size_t>(std::countr_zero(word))));
+				}
+			}
+
+			array = std::move(result);
+			words = {};
+		}
+
+		// chunk after a set operation: dense only if it's worth it
+		constexpr void normalize() {
+			if (dense() && count <= array_limit) {
+				to_array();
+			} else if (!dense() && count > array_limit) {
+				to_dense();
+			}
+		}
+
+		// first value at `position` or after it (array index or bit), `end_position()` if there is none
+		constexpr size_t next(size_t position) const noexcept {
+			if (!dense()) {
+				return position;
+			}
+
+			for (size_t w = position / 64z; w < chunk_words; ++w) {
+				uint64_t word = words[w];
+
+				if (w == position / 64z) {
+					word &= ~uint64_t{0} << (position % 64z);
+				}
+
+				if (word != 0u) {
+					return w * 64z + static_cast<size_t>(std::countr_zero(word));
+				}
+			}
+
+			return chunk_bits;
+		}
+
+		constexpr size_t end_position() const noexcept {
+			return dense() ? chunk_bits : array.size();
+		}
+
+		constexpr uint16_t low_at(size_t position) const noexcept {
+			return dense() ? static_cast<uint16_t>(position) : array[position];
+		}
+
+		constexpr size_t position_of(uint16_t low) const noexcept {
+			if (dense()) {
+				return low;
+			}
+
+			return static_cast<size_t>(std::lower_bound(array.begin(), array.end(), low) - array.begin());
+		}
+
+		constexpr size_t memory_bytes() const noexcept {
+			return array.capacity() * sizeof(uint16_t) + words.capacity() * sizeof(uint64_t);
+		}
+	};
+
+	std::vector<chunk> chunks{};
+	size_t cardinality{0z};
+
+	static constexpr uint64_t high_of(uint64_t value) noexcept {
+		return value >> 16u;
+	}
+
+	static constexpr uint16_t low_of(uint64_t value) noexcept {
+		return static_cast<uint16_t>(value & 0xFFFFu);
+	}
+
+	constexpr auto chunk_for(uint64_t high) const noexcept {
+		return std::lower_bound(chunks.begin(), chunks.end(), high, [](const chunk & c, uint64_t h) { return c.high < h; });
+	}
+
+	constexpr auto chunk_for(uint64_t high) noexcept {
+		return std::lower_bound(chunks.begin(), chunks.end(), high, [](const chunk & c, uint64_t h) { return c.high < h; });
+	}
+
+public:
+	class const_iterator {
+		const roaring_bitmap * owner{nullptr};
+		size_t index{0z};
+		size_t position{0z};
+
+		constexpr void settle() noexcept {
+			while (index != owner->chunks.size()) {
+				const chunk & c = owner->chunks[index];
+				position = c.next(position);
+
+				if (position != c.end_position()) {
+					return;
+				}
+
+				++index;
+				position = 0z;
+			}
+		}
+
+		friend class roaring_bitmap;
+
+		constexpr const_iterator(const roaring_bitmap * o, size_t i, size_t p) noexcept: owner{o}, index{i}, position{p} { }
+
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = uint64_t;
+		using difference_type = std::ptrdiff_t;
+		using reference = uint64_t;
+		using pointer = void;
+
+		constexpr const_iterator() noexcept = default;
+
+		constexpr uint64_t operator*() const noexcept {
+			const chunk & c = owner->chunks[index];
+			return (c.high << 16u) | c.low_at(position);
+		}
+
+		constexpr const_iterator & operator++() noexcept {
+			++position;
+			settle();
+			return *this;
+		}
+
+		constexpr const_iterator operator++(int) noexcept {
+			auto copy = *this;
+			++*this;
+			return copy;
+		}
+
+		friend constexpr bool operator==(const const_iterator & lhs, const const_iterator & rhs) noexcept {
+			return lhs.index == rhs.index && lhs.position == rhs.position;
+		}
+	};
+
+	constexpr auto begin() const noexcept -> const_iterator {
+		const_iterator result{this, 0z, 0z};
+		result.settle();
+		return result;
+	}
+
+	constexpr auto end() const noexcept -> const_iterator {
+		return const_iterator{this, chunks.size(), 0z};
+	}
+
+	constexpr auto find(uint64_t value) const noexcept -> const_iterator {
+		const auto it = chunk_for(high_of(value));
+
+		if (it == chunks.end() || it->high != high_of(value) || !it->contains(low_of(value))) {
+			return end();
+		}
+
+		return const_iterator{this, static_cast<size_t>(it - chunks.begin()), it->position_of(low_of(value))};
+	}
+
+	constexpr size_t size() const noexcept {
+		return cardinality;
+	}
+
+	constexpr bool empty() const noexcept {
+		return cardinality == 0z;
+	}
+
+	constexpr bool contains(uint64_t value) const noexcept {
+		const auto it = chunk_for(high_of(value));
+		return it != chunks.end() && it->high == high_of(value) && it->contains(low_of(value));
+	}
+
+	constexpr bool add(uint64_t value) {
+		auto it = chunk_for(high_of(value));
+
+		if (it == chunks.end() || it->high != high_of(value)) {
+			it = chunks.insert(it, chunk{.high = high_of(value)});
+		}
+
+		if (!it->add(low_of(value))) {
+			return false;
+		}
+
+		++cardinality;
+		return true;
+	}
+
+	constexpr bool remove(uint64_t value) {
+		const auto it = chunk_for(high_of(value));
+
+		if (it == chunks.end() || it->high != high_of(value) || !it->remove(low_of(value))) {
+			return false;
+		}
+
+		if (it->count == 0z) {
+			chunks.erase(it);
+		}
+
+		--cardinality;
+		return true;
+	}
+
+	// heap memory of the bitmap (without the object itself)
+	constexpr size_t memory_bytes() const noexcept {
+		size_t result = chunks.capacity() * sizeof(chunk);
+
+		for (const chunk & c: chunks) {
+			result += c.memory_bytes();
+		}
+
+		return result;
+	}
+
+	friend constexpr bool operator==(const roaring_bitmap & lhs, const roaring_bitmap & rhs) noexcept {
+		return lhs.cardinality == rhs.cardinality && std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+	}
+
+	// values in both (dense chunks are combined word by word with SIMD)
+	friend auto operator&(const roaring_bitmap & lhs, const roaring_bitmap & rhs) -> roaring_bitmap {
+		roaring_bitmap result{};
+
+		auto l = lhs.chunks.begin();
+		auto r = rhs.chunks.begin();
+
+		while (l != lhs.chunks.end() && r != rhs.chunks.end()) {
+			if (l->high < r->high) {
+				++l;
+			} else if (r->high < l->high) {
+				++r;
+			} else {
+				chunk c = intersect(*l, *r);
+
+				if (c.count != 0z) {
+					result.cardinality += c.count;
+					result.chunks.push_back(std::move(c));
+				}
+
+				++l;
+				++r;
+			}
+		}
+
+		return result;
+	}
+
+	// values in any of them
+	friend auto operator|(const roaring_bitmap & lhs, const roaring_bitmap & rhs) -> roaring_bitmap {
+		roaring_bitmap result{};
+		result.chunks.reserve(std::max(lhs.chunks.size(), rhs.chunks.size()));
+
+		auto l = lhs.chunks.begin();
+		auto r = rhs.chunks.begin();
+
+		const auto push = [&](chunk c) {
+			result.cardinality += c.count;
+			result.chunks.push_back(std::move(c));
+		};
+
+		while (l != lhs.chunks.end() || r != rhs.chunks.end()) {
+			if (r == rhs.chunks.end() || (l != lhs.chunks.end() && l->high < r->high)) {
+				push(*l++);
+			} else if (l == lhs.chunks.end() || r->high < l->high) {
+				push(*r++);
+			} else {
+				push(unite(*l++, *r++));
+			}
+		}
+
+		return result;
+	}
+
+	roaring_bitmap & operator&=(const roaring_bitmap & other) {
+		return *this = (*this & other);
+	}
+
+	roaring_bitmap & operator|=(const roaring_bitmap & other) {
+		return *this = (*this | other);
+	}
+
+private:
+	static auto intersect(const chunk & lhs, const chunk & rhs) -> chunk {
+		chunk result{.high = lhs.high};
+
+		if (lhs.dense() && rhs.dense()) {
+			result.words.resize(chunk_words);
+			result.count = combine_words(lhs.words.data(), rhs.words.data(), result.words.data(), chunk_words, and_words{});
+		} else if (!lhs.dense() && !rhs.dense()) {
+			std::set_intersection(lhs.array.begin(), lhs.array.end(), rhs.array.begin(), rhs.array.end(), std::back_inserter(result.array));
+			result.count = result.array.size();
+		} else {
+			const chunk & sparse = lhs.dense() ? rhs : lhs;
+			const chunk & dense = lhs.dense() ? lhs : rhs;
+
+			std::ranges::copy_if(sparse.array, std::back_inserter(result.array), [&](uint16_t low) { return dense.contains(low); });
+			result.count = result.array.size();
+		}
+
+		result.normalize();
+		return result;
+	}
+
+	static auto unite(const chunk & lhs, const chunk & rhs) -> chunk {
+		chunk result{.high = lhs.high};
+
+		if (lhs.dense() && rhs.dense()) {
+			result.words.resize(chunk_words);
+			result.count = combine_words(lhs.words.data(), rhs.words.data(), result.words.data(), chunk_words, or_words{});
+		} else if (!lhs.dense() && !rhs.dense()) {
+			std::set_union(lhs.array.begin(), lhs.array.end(), rhs.array.begin(), rhs.array.end(), std::back_inserter(result.array));
+			result.count = result.array.size();
+		} else {
+			const chunk & sparse = lhs.dense() ? rhs : lhs;
+			result = lhs.dense() ? lhs : rhs;
+
+			for (const uint16_t low: sparse.array) {
+				result.add(low);
+			}
+		}
+
+		result.normalize();
+		return result;
+	}
+};
+
+} // namespace ctdb::support
+
+#endif
@@ -0,0 +1,442 @@
+#ifndef CTDB_INDICES_SUPPORT_SIMD_HPP
+#define CTDB_INDICES_SUPPORT_SIMD_HPP
+
+#include "ngram.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <functional>
+#include <string_view>
+#include <type_traits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(_M_X64)) && (defined(__GNUC__) || defined(__clang__))
+#define CTDB_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace ctdb::support {
+
+// pack all ngrams of the input into order preserving integer keys (same as `pack_ngram`)
+// output must have space for `ngram_generate_count<N>(input.size())` keys
+template <size_t N> constexpr size_t pack_ngrams_scalar(std::string_view input, uint64_t * output, size_t start = 0z) noexcept
+requires(ngram_is_packable<N>)
+{
+	constexpr uint64_t mask = (N == 8z) ? ~uint64_t{0} : ((uint64_t{1} << (8z * N)) - 1u);
+
+	const size_t count = ngram_generate_count<N>(input.size());
+
+	if (start >= count) {
+		return count;
+	}
+
+	// rolling window over input, each key is previous one shifted by a character
+	uint64_t key = 0u;
+
+	for (size_t i = start; i != start + N - 1z; ++i) {
+		key = (key << 8u) | static_cast<unsigned char>(static_cast<unsigned char>(input[i]) ^ ngram_order_mask);
+	}
+
+	for (size_t i = start; i != count; ++i) {
+		key = ((key << 8u) | static_cast<unsigned char>(static_cast<unsigned char>(input[i + N - 1z]) ^ ngram_order_mask)) & mask;
+		output[i] = key;
+	}
+
+	return count;
+}
+
+#ifdef CTDB_X86_SIMD
+
+template <size_t N> constexpr auto pack_ngrams_shuffle_mask() noexcept {
+	// each 128bit lane contains same 16 characters, and it produces two keys (lane 0 for positions 0, 1 and lane 1 for 2, 3)
+	// key is big-endian (first character is the most significant byte), bytes after N are zero
+	std::array<char, 32> shuffle{};
+	std::array<char, 32> order{};
+
+	for (size_t lane = 0z; lane != 2z; ++lane) {
+		for (size_t q = 0z; q != 2z; ++q) {
+			const size_t position = lane * 2z + q;
+
+			for (size_t b = 0z; b != 8z; ++b) {
+				const size_t index = lane * 16z + q * 8z + b;
+				shuffle[index] = (b < N) ? static_cast<char>(position + (N - 1z - b)) : static_cast<char>(0x80);
+				order[index] = (b < N) ? static_cast<char>(ngram_order_mask) : char{0};
+			}
+		}
+	}
+
+	return std::array{shuffle, order};
+}
+
+template <size_t N> __attribute__((target("avx2"))) inline size_t pack_ngrams_avx2(std::string_view input, uint64_t * output) noexcept {
+	static constexpr auto masks = pack_ngrams_shuffle_mask<N>();
+
+	const __m256i shuffle = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(masks[0].data()));
+	const __m256i order = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(masks[1].data()));
+
+	size_t i = 0z;
+
+	// four positions at once, each iteration reads 16 characters
+	for (; i + 16z <= input.size(); i += 4z) {
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input.data() + i));
+		const __m256i both = _mm256_broadcastsi128_si256(chunk);
+		const __m256i keys = _mm256_xor_si256(_mm256_shuffle_epi8(both, shuffle), order);
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(output + i), keys);
+	}
+
+	return pack_ngrams_scalar<N>(input, output, i);
+}
+
+inline bool cpu_has_avx2() noexcept {
+	static const bool result = __builtin_cpu_supports("avx2");
+	return result;
+}
+
+#endif
+
+// chooses best available implementation at runtime
+template <size_t N> inline size_t pack_ngrams(std::string_view input, uint64_t * output) noexcept
+requires(ngram_is_packable<N>)
+{
+#ifdef CTDB_X86_SIMD
+	if (cpu_has_avx2()) {
+		return pack_ngrams_avx2<N>(input, output);
+	}
+#endif
+
+	return pack_ngrams_scalar<N>(input, output);
+}
+
+// lowercase ASCII characters of the input into output until first non-ASCII character
+// returns number of processed characters (SSE2 converts 16 characters at once)
+inline size_t ascii_lowercase_prefix(std::string_view input, char * output) noexcept {
+	size_t i = 0z;
+
+#ifdef CTDB_X86_SIMD
+	const __m128i upper_a = _mm_set1_epi8('A' - 1);
+	const __m128i upper_z = _mm_set1_epi8('Z' + 1);
+	const __m128i bit = _mm_set1_epi8(0x20);
+
+	for (; i + 16z <= input.size(); i += 16z) {
+		const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input.data() + i));
+
+		// non-ASCII characters have highest bit set
+		if (_mm_movemask_epi8(block) != 0) {
+			break;
+		}
+
+		const __m128i is_upper = _mm_and_si128(_mm_cmpgt_epi8(block, upper_a), _mm_cmplt_epi8(block, upper_z));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(output + i), _mm_or_si128(block, _mm_and_si128(is_upper, bit)));
+	}
+#endif
+
+	for (; i != input.size(); ++i) {
+		const char c = input[i];
+
+		if (static_cast<unsigned char>(c) >= 0x80u) {
+			break;
+		}
+
+		output[i] = (c >= 'A' && c <= 'Z') ? static_cast<char>(c | 0x20) : c;
+	}
+
+	return i;
+}
+
+// check if `needle` is in `text` at `position`
+constexpr bool matches_at(std::string_view text, std::string_view needle, size_t position) noexcept {
+	return position <= text.size() && text.size() - position >= needle.size() && text.substr(position, needle.size()) == needle;
+}
+
+// position of first occurrence of `needle` in `text` or std::string_view::npos
+// (SSE2 compares first and last character of the needle for 16 positions at once, only those which match both are compared fully)
+inline size_t find_substring(std::string_view text, std::string_view needle) noexcept {
+#ifdef CTDB_X86_SIMD
+	const size_t k = needle.size();
+
+	if (k < 2z || text.size() < k) {
+		return text.find(needle);
+	}
+
+	const __m128i first = _mm_set1_epi8(needle.front());
+	const __m128i last = _mm_set1_epi8(needle.back());
+
+	size_t i = 0z;
+
+	for (; i + k - 1z + 16z <= text.size(); i += 16z) {
+		const __m128i block_first = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text.data() + i));
+		const __m128i block_last = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text.data() + i + k - 1z));
+
+		auto mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, block_first), _mm_cmpeq_epi8(last, block_last))));
+
+		while (mask != 0u) {
+			const auto bit = static_cast<size_t>(__builtin_ctz(mask));
+
+			if (std::memcmp(text.data() + i + bit + 1z, needle.data() + 1z, k - 2z) == 0) {
+				return i + bit;
+			}
+
+			mask &= mask - 1u;
+		}
+	}
+
+	if (const auto pos = text.substr(i).find(needle); pos != std::string_view::npos) {
+		return i + pos;
+	}
+
+	return std::string_view::npos;
+#else
+	return text.find(needle);
+#endif
+}
+
+// word-wise AND / OR of two bitmaps into `output`, returns number of set bits of the result
+// (SSE2 combines two words at once)
+template <typename Op> inline size_t combine_words(const uint64_t * lhs, const uint64_t * rhs, uint64_t * output, size_t count, Op op) noexcept {
+	size_t i = 0z;
+	size_t result = 0z;
+
+#ifdef CTDB_X86_SIMD
+	for (; i + 2z <= count; i += 2z) {
+		const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(lhs + i));
+		const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rhs + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(output + i), op(a, b));
+
+		result += static_cast<size_t>(std::popcount(output[i]) + std::popcount(output[i + 1z]));
+	}
+#endif
+
+	for (; i < count; ++i) {
+		output[i] = op(lhs[i], rhs[i]);
+		result += static_cast<size_t>(std::popcount(output[i]));
+	}
+
+	return result;
+}
+
+struct and_words {
+	constexpr auto operator()(uint64_t lhs, uint64_t rhs) const noexcept -> uint64_t {
+		return lhs & rhs;
+	}
+
+#ifdef CTDB_X86_SIMD
+	auto operator()(__m128i lhs, __m128i rhs) const noexcept -> __m128i {
+		return _mm_and_si128(lhs, rhs);
+	}
+#endif
+};
+
+struct or_words {
+	constexpr auto operator()(uint64_t lhs, uint64_t rhs) const noexcept -> uint64_t {
+		return lhs | rhs;
+	}
+
+#ifdef CTDB_X86_SIMD
+	auto operator()(__m128i lhs, __m128i rhs) const noexcept -> __m128i {
+		return _mm_or_si128(lhs, rhs);
+	}
+#endif
+};
+
+#ifdef CTDB_X86_SIMD
+
+// lanes of a SSE2 register for 32bit integers and floating point values
+template <typename T> struct sse2_lanes {
+	static constexpr bool supported = false;
+};
+
+template <> struct sse2_lanes<int32_t> {
+	static constexpr bool supported = true;
+	static constexpr size_t width = 4z;
+
+	static auto load(const int32_t * data) noexcept -> __m128i {
+		return _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+	}
+
+	static auto splat(int32_t value) noexcept -> __m128i {
+		return _mm_set1_epi32(value);
+	}
+};
+
+// unsigned values are moved into signed range, so signed comparisons keep their order
+template <> struct sse2_lanes<uint32_t> {
+	static constexpr bool supported = true;
+	static constexpr size_t width = 4z;
+
+	static auto load(const uint32_t * data) noexcept -> __m128i {
+		return _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data)), _mm_set1_epi32(INT32_MIN));
+	}
+
+	static auto splat(uint32_t value) noexcept -> __m128i {
+		return _mm_set1_epi32(static_cast<int32_t>(value ^ 0x8000'0000u));
+	}
+};
+
+template <> struct sse2_lanes<float> {
+	static constexpr bool supported = true;
+	static constexpr size_t width = 4z;
+
+	static auto load(const float * data) noexcept -> __m128 {
+		return _mm_loadu_ps(data);
+	}
+
+	static auto splat(float value) noexcept -> __m128 {
+		return _mm_set1_ps(value);
+	}
+};
+
+template <> struct sse2_lanes<double> {
+	static constexpr bool supported = true;
+	static constexpr size_t width = 2z;
+
+	static auto load(const double * data) noexcept -> __m128d {
+		return _mm_loadu_pd(data);
+	}
+
+	static auto splat(double value) noexcept -> __m128d {
+		return _mm_set1_pd(value);
+	}
+};
+
+// bit for each lane where `lhs op rhs` (integers have only less/equal/greater, other comparisons are their negation)
+template <typename Op> struct sse2_compare {
+	static constexpr bool supported = false;
+};
+
+template <> struct sse2_compare<std::less<>> {
+	static constexpr bool supported = true;
+
+	static int mask(__m128i lhs, __m128i rhs) noexcept {
+		return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(lhs, rhs)));
+	}
+
+	static int mask(__m128 lhs, __m128 rhs) noexcept {
+		return _mm_movemask_ps(_mm_cmplt_ps(lhs, rhs));
+	}
+
+	static int mask(__m128d lhs, __m128d rhs) noexcept {
+		return _mm_movemask_pd(_mm_cmplt_pd(lhs, rhs));
+	}
+};
+
+template <> struct sse2_compare<std::less_equal<>> {
+	static constexpr bool supported = true;
+
+	static int mask(__m128i lhs, __m128i rhs) noexcept {
+		return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(lhs, rhs))) ^ 0xF;
+	}
+
+	static int mask(__m128 lhs, __m128 rhs) noexcept {
+		return _mm_movemask_ps(_mm_cmple_ps(lhs, rhs));
+	}
+
+	static int mask(__m128d lhs, __m128d rhs) noexcept {
+		return _mm_movemask_pd(_mm_cmple_pd(lhs, rhs));
+	}
+};
+
+template <> struct sse2_compare<std::equal_to<>> {
+	static constexpr bool supported = true;
+
+	static int mask(__m128i lhs, __m128i rhs) noexcept {
+		return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(lhs, rhs)));
+	}
+
+	static int mask(__m128 lhs, __m128 rhs) noexcept {
+		return _mm_movemask_ps(_mm_cmpeq_ps(lhs, rhs));
+	}
+
+	static int mask(__m128d lhs, __m128d rhs) noexcept {
+		return _mm_movemask_pd(_mm_cmpeq_pd(lhs, rhs));
+	}
+};
+
+template <> struct sse2_compare<std::not_equal_to<>> {
+	static constexpr bool supported = true;
+
+	static int mask(__m128i lhs, __m128i rhs) noexcept {
+		return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(lhs, rhs))) ^ 0xF;
+	}
+
+	static int mask(__m128 lhs, __m128 rhs) noexcept {
+		return _mm_movemask_ps(_mm_cmpneq_ps(lhs, rhs));
+	}
+
+	static int mask(__m128d lhs, __m128d rhs) noexcept {
+		return _mm_movemask_pd(_mm_cmpneq_pd(lhs, rhs));
+	}
+};
+
+template <> struct sse2_compare<std::greater<>> {
+	static constexpr bool supported = true;
+
+	static int mask(__m128i lhs, __m128i rhs) noexcept {
+		return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(lhs, rhs)));
+	}
+
+	static int mask(__m128 lhs, __m128 rhs) noexcept {
+		return _mm_movemask_ps(_mm_cmpgt_ps(lhs, rhs));
+	}
+
+	static int mask(__m128d lhs, __m128d rhs) noexcept {
+		return _mm_movemask_pd(_mm_cmpgt_pd(lhs, rhs));
+	}
+};
+
+template <> struct sse2_compare<std::greater_equal<>> {
+	static constexpr bool supported = true;
+
+	static int mask(__m128i lhs, __m128i rhs) noexcept {
+		return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(lhs, rhs))) ^ 0xF;
+	}
+
+	static int mask(__m128 lhs, __m128 rhs) noexcept {
+		return _mm_movemask_ps(_mm_cmpge_ps(lhs, rhs));
+	}
+
+	static int mask(__m128d lhs, __m128d rhs) noexcept {
+		return _mm_movemask_pd(_mm_cmpge_pd(lhs, rhs));
+	}
+};
+
+#endif
+
+// bits of `data[i] op value` (bit i % 64 of word i / 64), bits after `count` are zero
+// (SSE2 compares four 32bit or two 64bit values at once for std comparison functors)
+template <typename T, typename V, typename Op> inline void compare_to_bits(const T * data, size_t count, const V & value, Op op, uint64_t * output) noexcept {
+	size_t i = 0z;
+
+#ifdef CTDB_X86_SIMD
+	if constexpr (std::is_same_v<T, V> && sse2_lanes<T>::supported && sse2_compare<Op>::supported) {
+		using lanes = sse2_lanes<T>;
+		const auto rhs = lanes::splat(value);
+
+		for (; i + 64z <= count; i += 64z) {
+			uint64_t word = 0u;
+
+			for (size_t j = 0z; j != 64z; j += lanes::width) {
+				word |= static_cast<uint64_t>(sse2_compare<Op>::mask(lanes::load(data + i + j), rhs)) << j;
+			}
+
+			output[i / 64z] = word;
+		}
+	}
+#endif
+
+	for (; i < count; i += 64z) {
+		const size_t n = std::min(count - i, size_t{64});
+		uint64_t word = 0u;
+
+		for (size_t j = 0z; j != n; ++j) {
+			word |= static_cast<uint64_t>(static_cast<bool>(op(data[i + j], value))) << j;
+		}
+
+		output[i / 64z] = word;
+	}
+}
+
+} // namespace ctdb::support
+
+#endif
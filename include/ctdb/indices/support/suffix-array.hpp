@@ -0,0 +1,188 @@
+#ifndef CTDB_INDICES_SUPPORT_SUFFIX_ARRAY_HPP
+#define CTDB_INDICES_SUPPORT_SUFFIX_ARRAY_HPP
+
+#include <algorithm>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace ctdb::support {
+
+// suffix array construction by induced sorting (SA-IS) in O(n)
+// input is a string of integers in range [0, upper]
+inline auto build_suffix_array(const std::vector<int32_t> & s, int32_t upper) -> std::vector<int32_t> {
+	const auto n = static_cast<int32_t>(s.size());
+
+	if (n == 0) {
+		return {};
+	}
+
+	if (n == 1) {
+		return {0};
+	}
+
+	if (n < 10) {
+		// short inputs are faster with trivial sort
+		std::vector<int32_t> sa(static_cast<size_t>(n));
+
+		for (int32_t i = 0; i != n; ++i) {
+			sa[static_cast<size_t>(i)] = i;
+		}
+
+		std::sort(sa.begin(), sa.end(), [&](int32_t lhs, int32_t rhs) { return std::lexicographical_compare(s.begin() + lhs, s.end(), s.begin() + rhs, s.end()); });
+
+		return sa;
+	}
+
+	const auto at = [&](int32_t i) { return s[static_cast<size_t>(i)]; };
+
+	std::vector<int32_t> sa(static_cast<size_t>(n));
+
+	// S-type (true) and L-type (false) suffixes
+	std::vector<bool> stype(static_cast<size_t>(n));
+
+	for (int32_t i = n - 2; i >= 0; --i) {
+		stype[static_cast<size_t>(i)] = (at(i) == at(i + 1)) ? stype[static_cast<size_t>(i + 1)] : (at(i) < at(i + 1));
+	}
+
+	// beginnings of buckets for L-type and S-type suffixes of each character
+	std::vector<int32_t> sum_l(static_cast<size_t>(upper) + 2u);
+	std::vector<int32_t> sum_s(static_cast<size_t>(upper) + 2u);
+
+	for (int32_t i = 0; i != n; ++i) {
+		if (!stype[static_cast<size_t>(i)]) {
+			++sum_s[static_cast<size_t>(at(i))];
+		} else {
+			++sum_l[static_cast<size_t>(at(i)) + 1u];
+		}
+	}
+
+	for (size_t i = 0u; i <= static_cast<size_t>(upper); ++i) {
+		sum_s[i] += sum_l[i];
+
+		if (i < static_cast<size_t>(upper)) {
+			sum_l[i + 1u] += sum_s[i];
+		}
+	}
+
+	const auto induce = [&](const std::vector<int32_t> & lms) {
+		std::fill(sa.begin(), sa.end(), -1);
+
+		std::vector<int32_t> bucket(sum_s);
+
+		for (const int32_t d: lms) {
+			if (d != n) {
+				sa[static_cast<size_t>(bucket[static_cast<size_t>(at(d))]++)] = d;
+			}
+		}
+
+		bucket = sum_l;
+		sa[static_cast<size_t>(bucket[static_cast<size_t>(at(n - 1))]++)] = n - 1;
+
+		for (int32_t i = 0; i != n; ++i) {
+			const int32_t v = sa[static_cast<size_t>(i)];
+
+			if (v >= 1 && !stype[static_cast<size_t>(v - 1)]) {
+				sa[static_cast<size_t>(bucket[static_cast<size_t>(at(v - 1))]++)] = v - 1;
+			}
+		}
+
+		bucket = sum_l;
+
+		for (int32_t i = n - 1; i >= 0; --i) {
+			const int32_t v = sa[static_cast<size_t>(i)];
+
+			if (v >= 1 && stype[static_cast<size_t>(v - 1)]) {
+				sa[static_cast<size_t>(--bucket[static_cast<size_t>(at(v - 1)) + 1u])] = v - 1;
+			}
+		}
+	};
+
+	// leftmost S-type suffixes
+	std::vector<int32_t> lms_map(static_cast<size_t>(n) + 1u, -1);
+	std::vector<int32_t> lms{};
+
+	for (int32_t i = 1; i != n; ++i) {
+		if (!stype[static_cast<size_t>(i - 1)] && stype[static_cast<size_t>(i)]) {
+			lms_map[static_cast<size_t>(i)] = static_cast<int32_t>(lms.size());
+			lms.push_back(i);
+		}
+	}
+
+	const auto m = static_cast<int32_t>(lms.size());
+
+	induce(lms);
+
+	if (m == 0) {
+		return sa;
+	}
+
+	// name LMS substrings and sort them recursively
+	std::vector<int32_t> sorted_lms{};
+	sorted_lms.reserve(static_cast<size_t>(m));
+
+	for (const int32_t v: sa) {
+		if (lms_map[static_cast<size_t>(v)] != -1) {
+			sorted_lms.push_back(v);
+		}
+	}
+
+	std::vector<int32_t> reduced(static_cast<size_t>(m));
+	int32_t reduced_upper = 0;
+
+	reduced[static_cast<size_t>(lms_map[static_cast<size_t>(sorted_lms[0])])] = 0;
+
+	for (int32_t i = 1; i != m; ++i) {
+		int32_t l = sorted_lms[static_cast<size_t>(i - 1)];
+		int32_t r = sorted_lms[static_cast<size_t>(i)];
+
+		const int32_t end_l = (lms_map[static_cast<size_t>(l)] + 1 < m) ? lms[static_cast<size_t>(lms_map[static_cast<size_t>(l)] + 1)] : n;
+		const int32_t end_r = (lms_map[static_cast<size_t>(r)] + 1 < m) ? lms[static_cast<size_t>(lms_map[static_cast<size_t>(r)] + 1)] : n;
+
+		bool same = true;
+
+		if (end_l - l != end_r - r) {
+			same = false;
+		} else {
+			while (l < end_l && at(l) == at(r)) {
+				++l;
+				++r;
+			}
+
+			if (l == n || r == n || at(l) != at(r)) {
+				same = false;
+			}
+		}
+
+		if (!same) {
+			++reduced_upper;
+		}
+
+		reduced[static_cast<size_t>(lms_map[static_cast<size_t>(sorted_lms[static_cast<size_t>(i)])])] = reduced_upper;
+	}
+
+	const auto reduced_sa = build_suffix_array(reduced, reduced_upper);
+
+	for (int32_t i = 0; i != m; ++i) {
+		sorted_lms[static_cast<size_t>(i)] = lms[static_cast<size_t>(reduced_sa[static_cast<size_t>(i)])];
+	}
+
+	induce(sorted_lms);
+
+	return sa;
+}
+
+inline auto build_suffix_array(std::string_view input) -> std::vector<int32_t> {
+	std::vector<int32_t> s(input.size());
+
+	for (size_t i = 0z; i != input.size(); ++i) {
+		s[i] = static_cast<unsigned char>(input[i]);
+	}
+
+	return build_suffix_array(s, 255);
+}
+
+} // namespace ctdb::support
+
+#endif
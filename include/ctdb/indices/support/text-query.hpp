@@ -0,0 +1,110 @@
+#ifndef CTDB_INDICES_SUPPORT_TEXT_QUERY_HPP
+#define CTDB_INDICES_SUPPORT_TEXT_QUERY_HPP
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace ctdb::support {
+
+// boolean query over substrings of a document
+// `any` means "can't say anything", every document can match
+// `near` matches documents where both children (terms) start at most `distance` characters apart
+struct text_query {
+	enum class kind { any, term, all_of, any_of, none_of, near };
+
+	kind type{kind::any};
+	std::string term{};
+	std::vector<text_query> children{};
+	unsigned distance{0u};
+
+	static constexpr auto everything() -> text_query {
+		return text_query{};
+	}
+
+	static constexpr auto substring(std::string_view in) -> text_query {
+		text_query result{};
+		result.type = kind::term;
+		result.term = std::string(in);
+		return result;
+	}
+
+	static constexpr auto all_of(std::vector<text_query> in) -> text_query {
+		return combine(kind::all_of, std::move(in));
+	}
+
+	static constexpr auto any_of(std::vector<text_query> in) -> text_query {
+		return combine(kind::any_of, std::move(in));
+	}
+
+	static constexpr auto none_of(std::vector<text_query> in) -> text_query {
+		auto alternatives = any_of(std::move(in));
+
+		if (alternatives.is_everything()) {
+			// we don't know what to exclude => anything can match
+			return everything();
+		}
+
+		text_query result{};
+		result.type = kind::none_of;
+		result.children.emplace_back(std::move(alternatives));
+		return result;
+	}
+
+	static constexpr auto near(std::string_view lhs, std::string_view rhs, unsigned max_distance) -> text_query {
+		text_query result{};
+		result.type = kind::near;
+		result.children.emplace_back(substring(lhs));
+		result.children.emplace_back(substring(rhs));
+		result.distance = max_distance;
+		return result;
+	}
+
+	constexpr bool is_everything() const noexcept {
+		return type == kind::any;
+	}
+
+	friend constexpr bool operator==(const text_query &, const text_query &) = default;
+
+private:
+	static constexpr auto combine(kind type, std::vector<text_query> in) -> text_query {
+		text_query result{};
+		result.type = type;
+
+		for (text_query & child: in) {
+			if (child.is_everything()) {
+				if (type == kind::any_of) {
+					// alternative which can be anything => whole alternation can be anything
+					return everything();
+				}
+
+				// and `all_of` doesn't need to check it
+				continue;
+			}
+
+			if (child.type == type) {
+				// flatten nested queries of same kind
+				for (text_query & grandchild: child.children) {
+					result.children.emplace_back(std::move(grandchild));
+				}
+			} else {
+				result.children.emplace_back(std::move(child));
+			}
+		}
+
+		if (result.children.empty()) {
+			return everything();
+		}
+
+		if (result.children.size() == 1z) {
+			return std::move(result.children.front());
+		}
+
+		return result;
+	}
+};
+
+} // namespace ctdb::support
+
+#endif
@@ -0,0 +1,331 @@
+#ifndef CTDB_INSTRUMENTATION_HPP
+#define CTDB_INSTRUMENTATION_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <memory>
+#include <set>
+#include <type_traits>
+#include <unordered_set>
+#include <cstddef>
+#include <cstdint>
+#include <concepts>
+
+namespace ctdb {
+
+enum class operation : unsigned { insert, erase, lookup };
+
+inline constexpr size_t operation_count = 3z;
+
+// log2 histogram of latencies, bucket `i` counts operations which took [2^i, 2^(i+1)) nanoseconds
+struct latency_histogram {
+	static constexpr size_t bucket_count = 40z;
+
+	std::array<uint64_t, bucket_count> buckets{};
+	uint64_t count{0u};
+	uint64_t total_nanoseconds{0u};
+};
+
+// snapshot of counters (all of them are zero when instrumentation is disabled)
+struct instrumentation_stats {
+	uint64_t comparisons{0u};
+	uint64_t probes{0u};
+	uint64_t allocations{0u};
+	uint64_t allocated_bytes{0u};
+	uint64_t intersections{0u};
+	uint64_t intersected_entries{0u};
+	std::array<latency_histogram, operation_count> latency{};
+
+	constexpr auto operator[](operation op) const noexcept -> const latency_histogram & {
+		return latency[static_cast<size_t>(op)];
+	}
+};
+
+// default policy: nothing is counted and everything compiles to nothing
+struct no_instrumentation {
+	static constexpr bool enabled = false;
+
+	struct scope {
+		constexpr scope(const no_instrumentation &, operation) noexcept { }
+	};
+
+	static constexpr void comparison() noexcept { }
+	static constexpr void probe() noexcept { }
+	static constexpr void allocation(size_t) noexcept { }
+	static constexpr void intersection(size_t) noexcept { }
+
+	constexpr auto stats() const noexcept -> instrumentation_stats {
+		return {};
+	}
+
+	constexpr void reset() noexcept { }
+};
+
+// counts events of operations done on the object which owns the policy
+// - events are attributed to the owner of the innermost running `scope` on the current thread
+// - only the outermost scope records latency (a lookup implemented by other lookups is one operation)
+// - work done by other threads (parallel bulk loads) is not attributed to anyone
+class counting_instrumentation {
+	struct counters {
+		std::atomic<uint64_t> comparisons{0u};
+		std::atomic<uint64_t> probes{0u};
+		std::atomic<uint64_t> allocations{0u};
+		std::atomic<uint64_t> allocated_bytes{0u};
+		std::atomic<uint64_t> intersections{0u};
+		std::atomic<uint64_t> intersected_entries{0u};
+
+		struct histogram {
+			std::array<std::atomic<uint64_t>, latency_histogram::bucket_count> buckets{};
+			std::atomic<uint64_t> count{0u};
+			std::atomic<uint64_t> total_nanoseconds{0u};
+		};
+
+		std::array<histogram, operation_count> latency{};
+	};
+
+	// counters live on heap, so they stay in place when the owner is moved
+	std::unique_ptr<counters> data{std::make_unique<counters>()};
+
+	static inline thread_local counters * active = nullptr;
+
+	static void add(std::atomic<uint64_t> & counter, uint64_t value = 1u) noexcept {
+		counter.fetch_add(value, std::memory_order_relaxed);
+	}
+
+public:
+	static constexpr bool enabled = true;
+
+	counting_instrumentation() = default;
+
+	// copy of a table starts with its own empty counters
+	counting_instrumentation(const counting_instrumentation &): counting_instrumentation{} { }
+	counting_instrumentation(counting_instrumentation &&) noexcept = default;
+
+	counting_instrumentation & operator=(const counting_instrumentation &) noexcept {
+		return *this;
+	}
+
+	counting_instrumentation & operator=(counting_instrumentation &&) noexcept = default;
+
+	class scope {
+		counters * previous;
+		counters * target;
+		operation op;
+		std::chrono::steady_clock::time_point start;
+
+	public:
+		scope(const counting_instrumentation & owner, operation o) noexcept: previous{active}, target{owner.data.get()}, op{o}, start{std::chrono::steady_clock::now()} {
+			active = target;
+		}
+
+		scope(const scope &) = delete;
+		scope & operator=(const scope &) = delete;
+
+		~scope() noexcept {
+			active = previous;
+
+			if (previous == target || target == nullptr) {
+				return;
+			}
+
+			const auto elapsed = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+			const auto bucket = std::min(static_cast<size_t>(std::bit_width(elapsed)), latency_histogram::bucket_count) - (elapsed != 0u);
+
+			auto & histogram = target->latency[static_cast<size_t>(op)];
+			add(histogram.buckets[bucket]);
+			add(histogram.count);
+			add(histogram.total_nanoseconds, elapsed);
+		}
+	};
+
+	static void comparison() noexcept {
+		if (active) {
+			add(active->comparisons);
+		}
+	}
+
+	static void probe() noexcept {
+		if (active) {
+			add(active->probes);
+		}
+	}
+
+	static void allocation(size_t bytes) noexcept {
+		if (active) {
+			add(active->allocations);
+			add(active->allocated_bytes, bytes);
+		}
+	}
+
+	static void intersection(size_t entries) noexcept {
+		if (active) {
+			add(active->intersections);
+			add(active->intersected_entries, entries);
+		}
+	}
+
+	auto stats() const noexcept -> instrumentation_stats {
+		instrumentation_stats result{};
+
+		if (!data) {
+			return result;
+		}
+
+		const auto load = [](const std::atomic<uint64_t> & counter) { return counter.load(std::memory_order_relaxed); };
+
+		result.comparisons = load(data->comparisons);
+		result.probes = load(data->probes);
+		result.allocations = load(data->allocations);
+		result.allocated_bytes = load(data->allocated_bytes);
+		result.intersections = load(data->intersections);
+		result.intersected_entries = load(data->intersected_entries);
+
+		for (size_t op = 0z; op != operation_count; ++op) {
+			for (size_t i = 0z; i != latency_histogram::bucket_count; ++i) {
+				result.latency[op].buckets[i] = load(data->latency[op].buckets[i]);
+			}
+
+			result.latency[op].count = load(data->latency[op].count);
+			result.latency[op].total_nanoseconds = load(data->latency[op].total_nanoseconds);
+		}
+
+		return result;
+	}
+
+	void reset() noexcept {
+		if (data) {
+			data = std::make_unique<counters>();
+		}
+	}
+};
+
+// wrappers counting work of standard containers used as index storage
+
+template <typename Compare, typename Instrumentation> struct instrumented_compare: Compare {
+	template <typename Lhs, typename Rhs>
+	requires std::predicate<const Compare &, const Lhs &, const Rhs &>
+	constexpr bool operator()(const Lhs & lhs, const Rhs & rhs) const noexcept(noexcept(std::declval<const Compare &>()(lhs, rhs))) {
+		Instrumentation::comparison();
+		return Compare::operator()(lhs, rhs);
+	}
+};
+
+template <typename Hash, typename Instrumentation> struct instrumented_hash: Hash {
+	template <typename T>
+	requires std::invocable<const Hash &, const T &>
+	constexpr auto operator()(const T & value) const noexcept(noexcept(std::declval<const Hash &>()(value))) {
+		Instrumentation::probe();
+		return Hash::operator()(value);
+	}
+};
+
+// live memory of a container: bytes and blocks it got from its allocator (nodes, bucket arrays, ...)
+// (bookkeeping of `operator new` / malloc itself is not included)
+struct memory_footprint {
+	size_t bytes{0z};
+	size_t blocks{0z};
+
+	constexpr memory_footprint & operator+=(const memory_footprint & other) noexcept {
+		bytes += other.bytes;
+		blocks += other.blocks;
+		return *this;
+	}
+
+	friend constexpr auto operator+(memory_footprint lhs, const memory_footprint & rhs) noexcept -> memory_footprint {
+		return lhs += rhs;
+	}
+
+	friend constexpr bool operator==(const memory_footprint &, const memory_footprint &) noexcept = default;
+};
+
+struct memory_account {
+	std::atomic<size_t> bytes{0z};
+	std::atomic<size_t> blocks{0z};
+
+	auto footprint() const noexcept -> memory_footprint {
+		return {bytes.load(std::memory_order_relaxed), blocks.load(std::memory_order_relaxed)};
+	}
+};
+
+// allocator which tracks live memory of its container (and counts allocations of the current operation)
+// - each default constructed allocator (so each container) has its own account, rebound copies share it
+// - copy of a container gets a new account, moved container takes its account with it
+template <typename T, typename Instrumentation> class instrumented_allocator {
+	template <typename, typename> friend class instrumented_allocator;
+
+	// shared with rebound copies (nodes and buckets of one container), it's never null
+	std::shared_ptr<memory_account> account{std::make_shared<memory_account>()};
+
+public:
+	using value_type = T;
+	using propagate_on_container_move_assignment = std::true_type;
+	using propagate_on_container_swap = std::true_type;
+
+	instrumented_allocator() = default;
+
+	// there is no move constructor, moved-from container must still be able to allocate
+	instrumented_allocator(const instrumented_allocator &) noexcept = default;
+	instrumented_allocator & operator=(const instrumented_allocator &) noexcept = default;
+
+	template <typename U> instrumented_allocator(const instrumented_allocator<U, Instrumentation> & other) noexcept: account{other.account} { }
+
+	auto select_on_container_copy_construction() const -> instrumented_allocator {
+		return {};
+	}
+
+	T * allocate(size_t n) {
+		T * result = std::allocator<T>{}.allocate(n);
+
+		Instrumentation::allocation(n * sizeof(T));
+		account->bytes.fetch_add(n * sizeof(T), std::memory_order_relaxed);
+		account->blocks.fetch_add(1z, std::memory_order_relaxed);
+
+		return result;
+	}
+
+	void deallocate(T * ptr, size_t n) noexcept {
+		account->bytes.fetch_sub(n * sizeof(T), std::memory_order_relaxed);
+		account->blocks.fetch_sub(1z, std::memory_order_relaxed);
+
+		std::allocator<T>{}.deallocate(ptr, n);
+	}
+
+	auto footprint() const noexcept -> memory_footprint {
+		return account->footprint();
+	}
+
+	friend bool operator==(const instrumented_allocator & lhs, const instrumented_allocator & rhs) noexcept {
+		return lhs.account == rhs.account;
+	}
+};
+
+// same container with counting comparator, hash and allocator (unknown containers are kept as they are)
+template <typename Storage, typename Instrumentation> struct instrumented_storage {
+	using type = Storage;
+};
+
+template <typename Key, typename Compare, typename Allocator, typename Instrumentation> struct instrumented_storage<std::set<Key, Compare, Allocator>, Instrumentation> {
+	using type = std::set<Key, instrumented_compare<Compare, Instrumentation>, instrumented_allocator<Key, Instrumentation>>;
+};
+
+template <typename Key, typename Hash, typename Equal, typename Allocator, typename Instrumentation> struct instrumented_storage<std::unordered_set<Key, Hash, Equal, Allocator>, Instrumentation> {
+	using type = std::unordered_set<Key, instrumented_hash<Hash, Instrumentation>, instrumented_compare<Equal, Instrumentation>, instrumented_allocator<Key, Instrumentation>>;
+};
+
+template <typename Storage, typename Instrumentation> using instrumented_storage_t = std::conditional_t<Instrumentation::enabled, typename instrumented_storage<Storage, Instrumentation>::type, Storage>;
+
+// index traits with instrumented storage
+template <typename IndexTraits, typename Instrumentation> struct instrumented_index_traits: IndexTraits {
+	template <typename PKey> using storage_type = instrumented_storage_t<typename IndexTraits::template storage_type<PKey>, Instrumentation>;
+};
+
+template <typename IndexTraits, typename Instrumentation> using instrumented_index_traits_t = std::conditional_t<Instrumentation::enabled, instrumented_index_traits<IndexTraits, Instrumentation>, IndexTraits>;
+
+template <typename T, typename Instrumentation> using instrumented_allocator_t = std::conditional_t<Instrumentation::enabled, instrumented_allocator<T, Instrumentation>, std::allocator<T>>;
+
+} // namespace ctdb
+
+#endif
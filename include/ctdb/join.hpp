@@ -0,0 +1,267 @@
+#ifndef CTDB_JOIN_HPP
+#define CTDB_JOIN_HPP
+
+#include "table.hpp"
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <cstddef>
+
+namespace ctdb {
+
+// join condition: `static_cast<LeftView>(left) == static_cast<RightView>(right)`
+template <typename LeftView, typename RightView = LeftView> struct join_on { };
+
+template <typename LeftView, typename RightView = LeftView> constexpr inline auto on = join_on<LeftView, RightView>{};
+
+enum class join_strategy {
+	// both sides are walked along their sorted indices at once
+	merge,
+	// each record of one side is looked up in a hashed index of the other side
+	hash,
+	// each record of one side is looked up in a sorted index of the other side
+	index_lookup,
+};
+
+template <typename Table, typename View> inline constexpr bool has_index_on = decltype(std::declval<const Table &>().indices)::template has_index_for<View>;
+
+template <typename Table, typename View> using index_storage_on = std::remove_cvref_t<decltype(std::declval<const Table &>().indices.template index_for<View>())>;
+
+template <typename Table, typename View> constexpr bool has_sorted_index_on() noexcept {
+	if constexpr (has_index_on<Table, View>) {
+		return is_sorted_container<index_storage_on<Table, View>>;
+	} else {
+		return false;
+	}
+}
+
+template <typename Table, typename View> constexpr bool has_hashed_index_on() noexcept {
+	if constexpr (has_index_on<Table, View>) {
+		return !is_sorted_container<index_storage_on<Table, View>>;
+	} else {
+		return false;
+	}
+}
+
+// pair of joined records (references into both tables)
+template <typename Left, typename Right> using joined_records = std::pair<const Left &, const Right &>;
+
+// walks two sorted indices, for equal keys it yields all combinations of records (left ones in outer loop)
+template <typename LeftStorage, typename RightStorage, typename LeftView, typename RightView> class merge_join_iterator {
+	using left_iterator = typename LeftStorage::const_iterator;
+	using right_iterator = typename RightStorage::const_iterator;
+
+	left_iterator left{};
+	left_iterator left_end{};
+	right_iterator right{};
+	right_iterator right_end{};
+
+	// first right record with the current key
+	right_iterator run{};
+
+	static constexpr bool less(const auto & l, const auto & r) noexcept {
+		return static_cast<LeftView>(l) < static_cast<RightView>(r);
+	}
+
+	static constexpr bool greater(const auto & l, const auto & r) noexcept {
+		return static_cast<RightView>(r) < static_cast<LeftView>(l);
+	}
+
+	static constexpr bool same(const auto & l, const auto & r) noexcept {
+		return !less(l, r) && !greater(l, r);
+	}
+
+	// first pair of equal keys from current positions
+	constexpr void settle() noexcept {
+		while (left != left_end && right != right_end) {
+			if (less(**left, **right)) {
+				++left;
+			} else if (greater(**left, **right)) {
+				++right;
+			} else {
+				run = right;
+				return;
+			}
+		}
+
+		left = left_end;
+	}
+
+public:
+	using left_record = std::remove_cvref_t<decltype(**std::declval<left_iterator>())>;
+	using right_record = std::remove_cvref_t<decltype(**std::declval<right_iterator>())>;
+
+	using iterator_category = std::forward_iterator_tag;
+	using value_type = joined_records<left_record, right_record>;
+	using difference_type = std::ptrdiff_t;
+	using reference = value_type;
+	using pointer = void;
+
+	constexpr merge_join_iterator() noexcept = default;
+
+	constexpr merge_join_iterator(const LeftStorage & l, const RightStorage & r) noexcept: left{l.begin()}, left_end{l.end()}, right{r.begin()}, right_end{r.end()} {
+		settle();
+	}
+
+	constexpr auto operator*() const noexcept -> value_type {
+		return {**left, **right};
+	}
+
+	constexpr merge_join_iterator & operator++() noexcept {
+		// next right record with same key
+		if (++right != right_end && same(**left, **right)) {
+			return *this;
+		}
+
+		// next left record with same key goes through the same right records again
+		if (++left != left_end && same(**left, **run)) {
+			right = run;
+			return *this;
+		}
+
+		settle();
+		return *this;
+	}
+
+	constexpr merge_join_iterator operator++(int) noexcept {
+		auto copy = *this;
+		++*this;
+		return copy;
+	}
+
+	friend constexpr bool operator==(const merge_join_iterator & lhs, const merge_join_iterator & rhs) noexcept {
+		return lhs.left == rhs.left && (lhs.left == lhs.left_end || lhs.right == rhs.right);
+	}
+
+	friend constexpr bool operator==(const merge_join_iterator & it, std::default_sentinel_t) noexcept {
+		return it.left == it.left_end;
+	}
+};
+
+// walks all records of the outer side and looks each of them up in an index of the inner side
+// (`Swapped` when the inner side is the left one, pairs are always yielded as (left, right))
+template <typename OuterIterator, typename InnerStorage, typename OuterView, bool Swapped> class probe_join_iterator {
+	using inner_iterator = typename InnerStorage::const_iterator;
+
+	OuterIterator outer{};
+	OuterIterator outer_end{};
+	const InnerStorage * inner{nullptr};
+	inner_iterator first{};
+	inner_iterator last{};
+
+	// next outer record which has any match
+	constexpr void settle() noexcept {
+		for (; outer != outer_end; ++outer) {
+			const auto [f, l] = inner->equal_range(static_cast<OuterView>(*outer));
+
+			if (f != l) {
+				first = f;
+				last = l;
+				return;
+			}
+		}
+	}
+
+public:
+	using outer_record = std::remove_cvref_t<decltype(*std::declval<OuterIterator>())>;
+	using inner_record = std::remove_cvref_t<decltype(**std::declval<inner_iterator>())>;
+
+	using iterator_category = std::forward_iterator_tag;
+	using value_type = std::conditional_t<Swapped, joined_records<inner_record, outer_record>, joined_records<outer_record, inner_record>>;
+	using difference_type = std::ptrdiff_t;
+	using reference = value_type;
+	using pointer = void;
+
+	constexpr probe_join_iterator() noexcept = default;
+
+	constexpr probe_join_iterator(OuterIterator o, OuterIterator o_end, const InnerStorage & i) noexcept: outer{o}, outer_end{o_end}, inner{&i} {
+		settle();
+	}
+
+	constexpr auto operator*() const noexcept -> value_type {
+		if constexpr (Swapped) {
+			return {**first, *outer};
+		} else {
+			return {*outer, **first};
+		}
+	}
+
+	constexpr probe_join_iterator & operator++() noexcept {
+		if (++first != last) {
+			return *this;
+		}
+
+		++outer;
+		settle();
+		return *this;
+	}
+
+	constexpr probe_join_iterator operator++(int) noexcept {
+		auto copy = *this;
+		++*this;
+		return copy;
+	}
+
+	friend constexpr bool operator==(const probe_join_iterator & lhs, const probe_join_iterator & rhs) noexcept {
+		return lhs.outer == rhs.outer && (lhs.outer == lhs.outer_end || lhs.first == rhs.first);
+	}
+
+	friend constexpr bool operator==(const probe_join_iterator & it, std::default_sentinel_t) noexcept {
+		return it.outer == it.outer_end;
+	}
+};
+
+// lazy range of pairs of records from both tables with equal join keys, nothing is allocated
+// strategy depends on indices of both tables (first index which serves queries by the view is used):
+// - merge join when both sides have a sorted index on their view
+// - hash join when one side has a hashed index (the other side is walked in order of its records)
+// - lookups into a sorted index when only one side has an index
+// records (and tables) must outlive the range and the tables can't be changed while it's used
+template <typename Left, typename Right, typename LeftView, typename RightView> class join_range {
+	const Left * left;
+	const Right * right;
+
+	static constexpr bool left_sorted = has_sorted_index_on<Left, LeftView>();
+	static constexpr bool right_sorted = has_sorted_index_on<Right, RightView>();
+	static constexpr bool left_hashed = has_hashed_index_on<Left, LeftView>();
+	static constexpr bool right_hashed = has_hashed_index_on<Right, RightView>();
+
+	static_assert(left_sorted || right_sorted || left_hashed || right_hashed, "join needs an index on the view of at least one of the tables");
+
+	// right side is looked up (unless only the left side can be)
+	static constexpr bool probe_right = right_hashed || (!left_hashed && right_sorted);
+
+public:
+	static constexpr join_strategy strategy = (left_sorted && right_sorted) ? join_strategy::merge : ((left_hashed || right_hashed) ? join_strategy::hash : join_strategy::index_lookup);
+
+	constexpr join_range(const Left & l, const Right & r) noexcept: left{&l}, right{&r} { }
+
+	constexpr auto begin() const noexcept {
+		if constexpr (strategy == join_strategy::merge) {
+			using iterator = merge_join_iterator<index_storage_on<Left, LeftView>, index_storage_on<Right, RightView>, LeftView, RightView>;
+			return iterator{left->indices.template index_for<LeftView>(), right->indices.template index_for<RightView>()};
+
+		} else if constexpr (probe_right) {
+			const auto records = left->all();
+			using iterator = probe_join_iterator<decltype(records.begin()), index_storage_on<Right, RightView>, LeftView, false>;
+			return iterator{records.begin(), records.end(), right->indices.template index_for<RightView>()};
+
+		} else {
+			const auto records = right->all();
+			using iterator = probe_join_iterator<decltype(records.begin()), index_storage_on<Left, LeftView>, RightView, true>;
+			return iterator{records.begin(), records.end(), left->indices.template index_for<LeftView>()};
+		}
+	}
+
+	constexpr auto end() const noexcept -> std::default_sentinel_t {
+		return {};
+	}
+};
+
+template <typename Left, typename Right, typename LeftView, typename RightView> constexpr auto join(const Left & left, const Right & right, join_on<LeftView, RightView>) noexcept -> join_range<Left, Right, LeftView, RightView> {
+	return {left, right};
+}
+
+} // namespace ctdb
+
+#endif
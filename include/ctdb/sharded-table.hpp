@@ -0,0 +1,346 @@
+#ifndef CTDB_SHARDED_TABLE_HPP
+#define CTDB_SHARDED_TABLE_HPP
+
+#include "support/hash.hpp"
+#include "support/work-stealing-pool.hpp"
+#include "table.hpp"
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <utility>
+#include <vector>
+#include <concepts>
+#include <cstdint>
+
+namespace ctdb {
+
+// view used to pick a shard for a record (view of the first index, or the record itself)
+template <typename Index> struct shard_view {
+	using type = Index;
+};
+
+template <typename View> struct shard_view<sorted<View>> {
+	using type = View;
+};
+
+template <typename View> struct shard_view<unique<View>> {
+	using type = View;
+};
+
+template <typename View> struct shard_view<unique_sorted<View>> {
+	using type = View;
+};
+
+template <typename Record, typename... Indices> struct shard_key {
+	using type = Record;
+};
+
+template <typename Record, typename Head, typename... Tail> struct shard_key<Record, Head, Tail...>: shard_view<Head> { };
+
+// unique indices after the first one aren't partitioned by shards
+template <typename Index> struct unique_view_of { };
+
+template <typename View> struct unique_view_of<unique<View>> {
+	using type = View;
+};
+
+template <typename View> struct unique_view_of<unique_sorted<View>> {
+	using type = View;
+};
+
+template <typename Index> concept unique_index = requires { typename unique_view_of<Index>::type; };
+
+template <typename... Indices> constexpr bool has_secondary_unique = false;
+template <typename Head, typename... Tail> constexpr bool has_secondary_unique<Head, Tail...> = (unique_index<Tail> || ...);
+
+// records are partitioned into independent tables (each with its own indices) by hash of the first index's view:
+// - insertion locks only one shard, so writers in different shards don't wait for each other
+// - queries are sent to all shards in parallel and results of sorted indices are merged into one order
+// - queries by the first index's view go only to the shard which can contain the record
+// - uniqueness of the first index is checked only in its shard (equal records always go to the same shard)
+// - other unique indices are checked in all shards, so their insertions lock all shards (such writers don't run in parallel)
+// returned records stay valid until they are erased (same as in `table`)
+template <typename Record, size_t Shards, typename... Indices> class sharded_table {
+	static_assert(Shards > 0z);
+
+public:
+	using record_type = Record;
+	using table_type = table<Record, Indices...>;
+	using primary_key = typename table_type::primary_key;
+	using const_primary_key = typename std::list<record_type>::const_iterator;
+	using key_type = typename shard_key<Record, Indices...>::type;
+	using hash_type = typename get_hash_functor<key_type>::type;
+
+	static constexpr size_t shard_count = Shards;
+
+private:
+	struct shard {
+		mutable std::shared_mutex lock{};
+		table_type data{};
+	};
+
+	std::array<shard, Shards> shards{};
+	support::work_stealing_pool * pool;
+
+public:
+	explicit sharded_table(support::work_stealing_pool & p = support::default_pool()) noexcept: pool{&p} { }
+
+	sharded_table(const sharded_table &) = delete;
+	sharded_table & operator=(const sharded_table &) = delete;
+
+	static constexpr size_t shard_of_key(const key_type & key) noexcept {
+		return support::bucket_of(static_cast<uint64_t>(hash_type{}(key)), Shards);
+	}
+
+	static constexpr size_t shard_of(const record_type & record) noexcept {
+		if constexpr (std::same_as<key_type, record_type>) {
+			return shard_of_key(record);
+		} else {
+			return shard_of_key(static_cast<key_type>(record));
+		}
+	}
+
+	template <typename... Args> auto emplace(Args &&... args) -> std::optional<primary_key> {
+		// record must exist before we know its shard
+		record_type record(std::forward<Args>(args)...);
+		const size_t i = shard_of(record);
+
+		if constexpr (has_secondary_unique<Indices...>) {
+			// shards are locked in their order, so two writers can't deadlock
+			std::array<std::shared_lock<std::shared_mutex>, Shards> readers{};
+			std::unique_lock<std::shared_mutex> writer{};
+
+			for (size_t j = 0z; j != Shards; ++j) {
+				if (j == i) {
+					writer = std::unique_lock{shards[j].lock};
+				} else {
+					readers[j] = std::shared_lock{shards[j].lock};
+				}
+			}
+
+			return insert_into(i, std::move(record));
+		} else {
+			std::unique_lock _{shards[i].lock};
+			return shards[i].data.emplace(std::move(record));
+		}
+	}
+
+	// records are distributed to shards first and then each shard is filled by its own task
+	// returns number of inserted records (records refused by an index are skipped)
+	template <typename Range> size_t emplace_batch(const Range & records) {
+		if constexpr (has_secondary_unique<Indices...>) {
+			// records of the batch can collide in other unique indices across shards, so they are inserted one by one
+			std::array<std::unique_lock<std::shared_mutex>, Shards> locks{};
+
+			for (size_t i = 0z; i != Shards; ++i) {
+				locks[i] = std::unique_lock{shards[i].lock};
+			}
+
+			size_t result = 0z;
+
+			for (const auto & in: records) {
+				record_type record(in);
+				const size_t i = shard_of(record);
+				result += insert_into(i, std::move(record)).has_value();
+			}
+
+			return result;
+		}
+
+		std::array<std::vector<record_type>, Shards> buckets{};
+
+		for (const auto & in: records) {
+			record_type record(in);
+			const size_t i = shard_of(record);
+			buckets[i].push_back(std::move(record));
+		}
+
+		std::array<size_t, Shards> inserted{};
+
+		pool->parallel_for(Shards, [&](size_t i) {
+			std::unique_lock _{shards[i].lock};
+
+			for (record_type & record: buckets[i]) {
+				inserted[i] += shards[i].data.emplace(std::move(record)).has_value();
+			}
+		});
+
+		size_t result = 0z;
+
+		for (size_t count: inserted) {
+			result += count;
+		}
+
+		return result;
+	}
+
+	bool erase(primary_key it) {
+		shard & target = shards[shard_of(*it)];
+
+		std::unique_lock _{target.lock};
+		return target.data.erase(it);
+	}
+
+	size_t size() const {
+		size_t result = 0z;
+
+		for (const shard & s: shards) {
+			std::shared_lock _{s.lock};
+			result += s.data.size();
+		}
+
+		return result;
+	}
+
+	template <typename Type> size_t size() const {
+		size_t result = 0z;
+
+		for (const shard & s: shards) {
+			std::shared_lock _{s.lock};
+			result += s.data.template size<Type>();
+		}
+
+		return result;
+	}
+
+	// all records in no particular order
+	auto all() const -> merged_range<const_primary_key> {
+		std::array<std::vector<const_primary_key>, Shards> parts{};
+
+		pool->parallel_for(Shards, [&](size_t i) {
+			std::shared_lock _{shards[i].lock};
+
+			const auto rng = shards[i].data.all();
+			parts[i].reserve(shards[i].data.size());
+
+			for (auto it = rng.first; it != rng.last; ++it) {
+				parts[i].push_back(it);
+			}
+		});
+
+		return concatenate(parts);
+	}
+
+	template <typename Type> auto all() const -> merged_range<primary_key> {
+		return fan_out<Type>([](const table_type & tbl) { return tbl.template all<Type>(); });
+	}
+
+	template <typename Type> auto equal(const Type & value) const -> merged_range<primary_key> {
+		if constexpr (std::same_as<Type, key_type>) {
+			// all equal records are in the same shard
+			const shard & s = shards[shard_of_key(value)];
+
+			std::shared_lock _{s.lock};
+			const auto rng = s.data.template equal<Type>(value);
+			return merged_range<primary_key>{std::vector<primary_key>(rng.first, rng.last)};
+		} else {
+			return fan_out<Type>([&](const table_type & tbl) { return tbl.template equal<Type>(value); });
+		}
+	}
+
+	template <typename Type> auto range(const Type & from, const Type & to) const -> merged_range<primary_key> {
+		return fan_out<Type>([&](const table_type & tbl) { return tbl.template range<Type>(from, to); });
+	}
+
+	template <typename Type> auto operator==(const Type & value) const {
+		return equal<Type>(value);
+	}
+
+private:
+	// all shards must be locked (the target one exclusively)
+	auto insert_into(size_t target, record_type && record) -> std::optional<primary_key> {
+		for (size_t j = 0z; j != Shards; ++j) {
+			if (j != target && has_duplicate<Indices...>(shards[j].data, record)) {
+				return std::nullopt;
+			}
+		}
+
+		return shards[target].data.emplace(std::move(record));
+	}
+
+	template <typename Head, typename... Tail> static bool has_duplicate(const table_type & tbl, const record_type & record) {
+		return (contains_view<Tail>(tbl, record) || ...);
+	}
+
+	template <typename Index> static bool contains_view(const table_type & tbl, const record_type & record) {
+		if constexpr (unique_index<Index>) {
+			using view = typename unique_view_of<Index>::type;
+			const auto rng = tbl.template equal<view>(static_cast<view>(record));
+			return rng.first != rng.last;
+		} else {
+			return false;
+		}
+	}
+
+	// run `query` on every shard in parallel and merge found keys in order of the index
+	template <typename Type, typename Query> auto fan_out(Query && query) const -> merged_range<primary_key> {
+		std::array<std::vector<primary_key>, Shards> parts{};
+
+		pool->parallel_for(Shards, [&](size_t i) {
+			std::shared_lock _{shards[i].lock};
+
+			const auto rng = query(shards[i].data);
+			parts[i].assign(rng.first, rng.last);
+		});
+
+		using storage_type = std::remove_cvref_t<decltype(std::declval<const table_type &>().indices.template index_for<Type>())>;
+
+		if constexpr (is_sorted_container<storage_type>) {
+			return merge(parts, typename storage_type::key_compare{});
+		} else {
+			return concatenate(parts);
+		}
+	}
+
+	template <typename Key> static auto concatenate(std::array<std::vector<Key>, Shards> & parts) -> merged_range<Key> {
+		merged_range<Key> result{};
+		result.keys.reserve(total_size(parts));
+
+		for (auto & part: parts) {
+			result.keys.insert(result.keys.end(), part.begin(), part.end());
+		}
+
+		return result;
+	}
+
+	// each part is already sorted, so neighbouring runs are merged pairwise (log(Shards) passes)
+	template <typename Key, typename Compare> static auto merge(std::array<std::vector<Key>, Shards> & parts, Compare compare) -> merged_range<Key> {
+		std::array<size_t, Shards + 1z> bounds{};
+
+		for (size_t i = 0z; i != Shards; ++i) {
+			bounds[i + 1z] = bounds[i] + parts[i].size();
+		}
+
+		merged_range<Key> result = concatenate(parts);
+
+		const auto at = [&](size_t run) {
+			return result.keys.begin() + static_cast<std::ptrdiff_t>(bounds[std::min(run, Shards)]);
+		};
+
+		for (size_t width = 1z; width < Shards; width *= 2z) {
+			for (size_t i = 0z; i + width < Shards; i += 2z * width) {
+				std::inplace_merge(at(i), at(i + width), at(i + 2z * width), compare);
+			}
+		}
+
+		return result;
+	}
+
+	template <typename Key> static size_t total_size(const std::array<std::vector<Key>, Shards> & parts) noexcept {
+		size_t result = 0z;
+
+		for (const auto & part: parts) {
+			result += part.size();
+		}
+
+		return result;
+	}
+};
+
+} // namespace ctdb
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef CTDB_SUPPORT_AGGREGATE_HPP
+#define CTDB_SUPPORT_AGGREGATE_HPP
+
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <cstddef>
+
+namespace ctdb::support {
+
+// fields of an aggregate without reflection: number of fields is found by brace initialization
+// and fields are accessed with structured bindings (up to `max_fields` fields)
+// members which are aggregates themselves (std::array, nested structs) are not supported (brace elision)
+inline constexpr size_t max_fields = 12z;
+
+// convertible into anything (only in unevaluated context)
+struct any_field {
+	template <typename T> constexpr operator T() const noexcept;
+};
+
+template <typename T, size_t N> constexpr bool brace_constructible_with() noexcept {
+	return []<size_t... I>(std::index_sequence<I...>) { return requires { T{(static_cast<void>(I), any_field{})...}; }; }(std::make_index_sequence<N>{});
+}
+
+template <typename T, size_t N = max_fields> constexpr size_t count_fields() noexcept {
+	if constexpr (N == 0z) {
+		return 0z;
+	} else if constexpr (brace_constructible_with<T, N>()) {
+		return N;
+	} else {
+		return count_fields<T, N - 1z>();
+	}
+}
+
+template <typename T> concept decomposable_aggregate = std::is_aggregate_v<T> && !std::is_array_v<T> && (count_fields<T>() != 0z) && (count_fields<T>() < max_fields);
+
+template <decomposable_aggregate T> inline constexpr size_t field_count = count_fields<T>();
+
+// tuple of references to all fields of the aggregate
+template <decomposable_aggregate T> constexpr auto tie_fields(T & value) noexcept {
+	constexpr size_t n = field_count<T>;
+
+	if constexpr (n == 1z) {
+		auto & [a] = value;
+		return std::tie(a);
+	} else if constexpr (n == 2z) {
+		auto & [a, b] = value;
+		return std::tie(a, b);
+	} else if constexpr (n == 3z) {
+		auto & [a, b, c] = value;
+		return std::tie(a, b, c);
+	} else if constexpr (n == 4z) {
+		auto & [a, b, c, d] = value;
+		return std::tie(a, b, c, d);
+	} else if constexpr (n == 5z) {
+		auto & [a, b, c, d, e] = value;
+		return std::tie(a, b, c, d, e);
+	} else if constexpr (n == 6z) {
+		auto & [a, b, c, d, e, f] = value;
+		return std::tie(a, b, c, d, e, f);
+	} else if constexpr (n == 7z) {
+		auto & [a, b, c, d, e, f, g] = value;
+		return std::tie(a, b, c, d, e, f, g);
+	} else if constexpr (n == 8z) {
+		auto & [a, b, c, d, e, f, g, h] = value;
+		return std::tie(a, b, c, d, e, f, g, h);
+	} else if constexpr (n == 9z) {
+		auto & [a, b, c, d, e, f, g, h, i] = value;
+		return std::tie(a, b, c, d, e, f, g, h, i);
+	} else if constexpr (n == 10z) {
+		auto & [a, b, c, d, e, f, g, h, i, j] = value;
+		return std::tie(a, b, c, d, e, f, g, h, i, j);
+	} else {
+		auto & [a, b, c, d, e, f, g, h, i, j, k] = value;
+		return std::tie(a, b, c, d, e, f, g, h, i, j, k);
+	}
+}
+
+template <typename Tuple> struct remove_references;
+
+template <typename... Ts> struct remove_references<std::tuple<Ts...>> {
+	using type = std::tuple<std::remove_cvref_t<Ts>...>;
+};
+
+// std::tuple of types of all fields
+template <decomposable_aggregate T> using field_types = typename remove_references<decltype(tie_fields(std::declval<T &>()))>::type;
+
+} // namespace ctdb::support
+
+#endif
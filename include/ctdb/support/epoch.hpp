@@ -0,0 +1,85 @@
+#ifndef CTDB_SUPPORT_EPOCH_HPP
+#define CTDB_SUPPORT_EPOCH_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <cstddef>
+#include <cstdint>
+
+namespace ctdb::support {
+
+// epoch based reclamation: readers announce the epoch in which they started reading,
+// memory retired in epoch `e` can be released when no reader announced `e` or an older epoch
+// - each reader announces into its own slot (one cache line for each), so readers don't write any shared memory
+// - writer publishes new data first and then starts a new epoch with `advance()`
+// - a reader which stays too long blocks releasing of everything retired after it started
+class epoch_domain {
+	static constexpr uint64_t idle = (std::numeric_limits<uint64_t>::max)();
+
+	struct alignas(64) slot {
+		std::atomic<uint64_t> epoch{idle};
+	};
+
+	size_t slot_count;
+	std::unique_ptr<slot[]> slots;
+	std::atomic<uint64_t> global{0u};
+
+	// threads start searching for a free slot in different places
+	static size_t thread_hint() noexcept {
+		static std::atomic<size_t> next{0z};
+		static thread_local const size_t hint = next.fetch_add(1z, std::memory_order_relaxed);
+		return hint;
+	}
+
+public:
+	// at most `readers` of them can be inside at once, others wait for a free slot
+	explicit epoch_domain(size_t readers = std::max(size_t{64}, size_t{2} * std::thread::hardware_concurrency())): slot_count{std::max(readers, size_t{1})}, slots{std::make_unique<slot[]>(slot_count)} { }
+
+	epoch_domain(const epoch_domain &) = delete;
+	epoch_domain & operator=(const epoch_domain &) = delete;
+
+	// announce current epoch, returns slot which must be given to `leave`
+	size_t enter() noexcept {
+		const size_t first = thread_hint() % slot_count;
+
+		for (size_t i = first;;) {
+			uint64_t expected = idle;
+
+			// a writer which didn't see this announcement published its data before the epoch was read
+			if (slots[i].epoch.compare_exchange_strong(expected, global.load(std::memory_order_seq_cst), std::memory_order_seq_cst)) {
+				return i;
+			}
+
+			if ((i = (i + 1z) % slot_count) == first) {
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	void leave(size_t i) noexcept {
+		slots[i].epoch.store(idle, std::memory_order_release);
+	}
+
+	// start a new epoch, returns the previous one (memory unlinked before this call is retired in it)
+	uint64_t advance() noexcept {
+		return global.fetch_add(1u, std::memory_order_seq_cst);
+	}
+
+	// oldest epoch announced by any reader (memory retired in older epochs can't be seen by anyone)
+	uint64_t oldest() const noexcept {
+		uint64_t result = idle;
+
+		for (size_t i = 0z; i != slot_count; ++i) {
+			result = std::min(result, slots[i].epoch.load(std::memory_order_seq_cst));
+		}
+
+		return result;
+	}
+};
+
+} // namespace ctdb::support
+
+#endif
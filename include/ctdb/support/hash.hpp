@@ -0,0 +1,16 @@
+#ifndef CTDB_SUPPORT_HASH_HPP
+#define CTDB_SUPPORT_HASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ctdb::support {
+
+// pick one of `count` buckets, multiplication spreads also weak hashes (std::hash of integers is identity)
+constexpr auto bucket_of(uint64_t hash, size_t count) noexcept -> size_t {
+	return static_cast<size_t>(((hash * 0x9E3779B97F4A7C15ull) >> 32u) % count);
+}
+
+} // namespace ctdb::support
+
+#endif
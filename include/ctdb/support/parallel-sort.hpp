@@ -0,0 +1,45 @@
+#ifndef CTDB_SUPPORT_PARALLEL_SORT_HPP
+#define CTDB_SUPPORT_PARALLEL_SORT_HPP
+
+#include "work-stealing-pool.hpp"
+#include <algorithm>
+#include <iterator>
+#include <vector>
+#include <cstddef>
+
+namespace ctdb::support {
+
+// stable sort, big input is split into chunks sorted by separate tasks which are then merged pairwise
+// without a pool (or for small input) it's just std::stable_sort
+template <std::random_access_iterator It, typename Compare> void parallel_stable_sort(It first, It last, Compare compare, work_stealing_pool * pool, size_t min_chunk = 1z << 14u) {
+	const auto size = static_cast<size_t>(std::distance(first, last));
+
+	const size_t chunks = (pool == nullptr) ? 1z : std::min(pool->size() + 1z, size / std::max(min_chunk, size_t{1}));
+
+	if (chunks <= 1z) {
+		std::stable_sort(first, last, compare);
+		return;
+	}
+
+	std::vector<It> bounds(chunks + 1z);
+
+	for (size_t i = 0z; i != bounds.size(); ++i) {
+		bounds[i] = first + static_cast<std::ptrdiff_t>(size * i / chunks);
+	}
+
+	pool->parallel_for(chunks, [&](size_t i) { std::stable_sort(bounds[i], bounds[i + 1z], compare); });
+
+	// each pass merges neighbouring runs, pairs within one pass are independent
+	for (size_t width = 1z; width < chunks; width *= 2z) {
+		const size_t pairs = (chunks - width + 2z * width - 1z) / (2z * width);
+
+		pool->parallel_for(pairs, [&](size_t p) {
+			const size_t i = p * 2z * width;
+			std::inplace_merge(bounds[i], bounds[i + width], bounds[std::min(i + 2z * width, chunks)], compare);
+		});
+	}
+}
+
+} // namespace ctdb::support
+
+#endif
@@ -0,0 +1,349 @@
+#ifndef CTDB_SUPPORT_PERSISTENT_TREE_HPP
+#define CTDB_SUPPORT_PERSISTENT_TREE_HPP
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace ctdb::support {
+
+template <typename Value> struct persistent_node {
+	Value value;
+	persistent_node * left{nullptr};
+	persistent_node * right{nullptr};
+	uint64_t generation{0u};
+	int height{1};
+};
+
+// changes of one writer: nodes of its generation aren't published yet, so they are changed in place,
+// older nodes are copied (path copying) and collected in `replaced`, they are still used by published versions
+// and must be released only when no reader can see them
+template <typename Value> struct persistent_editor {
+	using node = persistent_node<Value>;
+
+	uint64_t generation;
+	std::vector<node *> replaced{};
+
+	constexpr explicit persistent_editor(uint64_t g) noexcept: generation{g} { }
+
+	auto create(const Value & value) -> node * {
+		return new node{value, nullptr, nullptr, generation, 1};
+	}
+
+	// node which can be changed in place
+	auto own(node * n) -> node * {
+		if (n->generation == generation) {
+			return n;
+		}
+
+		replaced.reserve(replaced.size() + 1z);
+
+		node * copy = new node{*n};
+		copy->generation = generation;
+		replaced.push_back(n);
+
+		return copy;
+	}
+
+	// node which isn't part of the tree anymore
+	void drop(node * n) {
+		if (n->generation == generation) {
+			delete n;
+		} else {
+			replaced.push_back(n);
+		}
+	}
+};
+
+// AVL tree with immutable published nodes, each change copies only the path from the root to the changed node
+// (a version of the tree is just its root, all versions share nodes which were not changed)
+// - `less(value, value)` orders values, equal values are refused
+// - nodes are not owned by the tree, they are released by its user (see `release` and `release_generation`)
+template <typename Value> struct persistent_tree {
+	using node = persistent_node<Value>;
+	using editor = persistent_editor<Value>;
+
+	node * root{nullptr};
+	size_t count{0z};
+
+	// in-order walk with stack of nodes which are still to be visited
+	class const_iterator {
+		friend struct persistent_tree;
+
+		std::vector<const node *> stack{};
+
+		void push_left(const node * n) {
+			for (; n != nullptr; n = n->left) {
+				stack.push_back(n);
+			}
+		}
+
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = Value;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const Value *;
+		using reference = const Value &;
+
+		const_iterator() noexcept = default;
+
+		auto operator*() const noexcept -> const Value & {
+			return stack.back()->value;
+		}
+
+		auto operator->() const noexcept -> const Value * {
+			return &stack.back()->value;
+		}
+
+		const_iterator & operator++() {
+			const node * current = stack.back();
+			stack.pop_back();
+			push_left(current->right);
+			return *this;
+		}
+
+		const_iterator operator++(int) {
+			auto copy = *this;
+			++*this;
+			return copy;
+		}
+
+		friend bool operator==(const const_iterator & lhs, const const_iterator & rhs) noexcept {
+			if (lhs.stack.empty() || rhs.stack.empty()) {
+				return lhs.stack.empty() == rhs.stack.empty();
+			}
+
+			return lhs.stack.back() == rhs.stack.back();
+		}
+	};
+
+	auto begin() const -> const_iterator {
+		const_iterator result{};
+		result.stack.reserve(static_cast<size_t>(height(root)));
+		result.push_left(root);
+		return result;
+	}
+
+	auto end() const noexcept -> const_iterator {
+		return {};
+	}
+
+	constexpr size_t size() const noexcept {
+		return count;
+	}
+
+	// first value for which `before(value)` is false (values must be partitioned by it)
+	template <typename Before> auto lower_bound(Before && before) const -> const_iterator {
+		const_iterator result{};
+		result.stack.reserve(static_cast<size_t>(height(root)));
+
+		for (const node * n = root; n != nullptr;) {
+			if (before(n->value)) {
+				n = n->right;
+			} else {
+				result.stack.push_back(n);
+				n = n->left;
+			}
+		}
+
+		return result;
+	}
+
+	template <typename Less> bool contains(const Value & value, Less && less) const {
+		for (const node * n = root; n != nullptr;) {
+			if (less(value, n->value)) {
+				n = n->left;
+			} else if (less(n->value, value)) {
+				n = n->right;
+			} else {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	template <typename Less> bool insert(const Value & value, Less && less, editor & e) {
+		bool inserted = false;
+		root = insert(root, value, less, e, inserted);
+		count += inserted;
+		return inserted;
+	}
+
+	template <typename Less> bool erase(const Value & value, Less && less, editor & e) {
+		bool erased = false;
+		root = erase(root, value, less, e, erased);
+		count -= erased;
+		return erased;
+	}
+
+	// release nodes created by the editor (changes which were never published)
+	static void release_generation(node * n, uint64_t generation) noexcept {
+		if (n == nullptr || n->generation != generation) {
+			return;
+		}
+
+		release_generation(n->left, generation);
+		release_generation(n->right, generation);
+		delete n;
+	}
+
+	// release whole tree (no other version can share its nodes)
+	static void release(node * n) noexcept {
+		if (n == nullptr) {
+			return;
+		}
+
+		release(n->left);
+		release(n->right);
+		delete n;
+	}
+
+private:
+	static constexpr int height(const node * n) noexcept {
+		return (n != nullptr) ? n->height : 0;
+	}
+
+	static constexpr void update(node * n) noexcept {
+		n->height = 1 + std::max(height(n->left), height(n->right));
+	}
+
+	static auto rotate_right(node * n, editor & e) -> node * {
+		node * l = e.own(n->left);
+		n->left = l->right;
+		l->right = n;
+		update(n);
+		update(l);
+		return l;
+	}
+
+	static auto rotate_left(node * n, editor & e) -> node * {
+		node * r = e.own(n->right);
+		n->right = r->left;
+		r->left = n;
+		update(n);
+		update(r);
+		return r;
+	}
+
+	// `n` is owned by the editor
+	static auto balance(node * n, editor & e) -> node * {
+		update(n);
+
+		const int factor = height(n->left) - height(n->right);
+
+		if (factor > 1) {
+			if (height(n->left->left) < height(n->left->right)) {
+				n->left = rotate_left(e.own(n->left), e);
+			}
+
+			return rotate_right(n, e);
+		}
+
+		if (factor < -1) {
+			if (height(n->right->right) < height(n->right->left)) {
+				n->right = rotate_right(e.own(n->right), e);
+			}
+
+			return rotate_left(n, e);
+		}
+
+		return n;
+	}
+
+	template <typename Less> static auto insert(node * n, const Value & value, Less & less, editor & e, bool & inserted) -> node * {
+		if (n == nullptr) {
+			inserted = true;
+			return e.create(value);
+		}
+
+		if (less(value, n->value)) {
+			node * l = insert(n->left, value, less, e, inserted);
+
+			if (!inserted) {
+				return n;
+			}
+
+			n = e.own(n);
+			n->left = l;
+		} else if (less(n->value, value)) {
+			node * r = insert(n->right, value, less, e, inserted);
+
+			if (!inserted) {
+				return n;
+			}
+
+			n = e.own(n);
+			n->right = r;
+		} else {
+			return n;
+		}
+
+		return balance(n, e);
+	}
+
+	// removes the smallest node of the subtree and gives its value
+	static auto erase_min(node * n, editor & e, Value & out) -> node * {
+		if (n->left == nullptr) {
+			node * r = n->right;
+			out = n->value;
+			e.drop(n);
+			return r;
+		}
+
+		node * l = erase_min(n->left, e, out);
+		n = e.own(n);
+		n->left = l;
+		return balance(n, e);
+	}
+
+	template <typename Less> static auto erase(node * n, const Value & value, Less & less, editor & e, bool & erased) -> node * {
+		if (n == nullptr) {
+			return n;
+		}
+
+		if (less(value, n->value)) {
+			node * l = erase(n->left, value, less, e, erased);
+
+			if (!erased) {
+				return n;
+			}
+
+			n = e.own(n);
+			n->left = l;
+			return balance(n, e);
+		}
+
+		if (less(n->value, value)) {
+			node * r = erase(n->right, value, less, e, erased);
+
+			if (!erased) {
+				return n;
+			}
+
+			n = e.own(n);
+			n->right = r;
+			return balance(n, e);
+		}
+
+		erased = true;
+
+		if (n->left == nullptr || n->right == nullptr) {
+			node * child = (n->left != nullptr) ? n->left : n->right;
+			e.drop(n);
+			return child;
+		}
+
+		// the node takes value of its successor
+		n = e.own(n);
+		n->right = erase_min(n->right, e, n->value);
+		return balance(n, e);
+	}
+};
+
+} // namespace ctdb::support
+
+#endif
@@ -0,0 +1,209 @@
+#ifndef CTDB_SUPPORT_SLOT_STORAGE_HPP
+#define CTDB_SUPPORT_SLOT_STORAGE_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace ctdb::support {
+
+// records with stable addresses, each thread takes slots from its own block of them
+// so the shared lock is touched once per `BlockSize` records instead of for each one
+// - erased slots are returned into a shared free list and reused by next refill
+// - each thread keeps blocks for a few storages at once, when it starts using another one
+//   the least recently used block is returned into free list of its storage
+// - slots cached by a thread which stopped using the storage are lost until the storage is destroyed
+// - each slot counts its records (generation), so a pointer to an erased record can be told apart from a record
+//   which reused its slot
+template <typename T, size_t BlockSize = 1024z> class slot_storage {
+	static_assert(BlockSize > 0z);
+
+	struct slot {
+		alignas(T) std::byte data[sizeof(T)];
+		std::atomic<bool> used{false};
+		std::atomic<uint64_t> generation{0u};
+	};
+
+	struct cached_slots {
+		uint64_t owner{0u};
+		uint64_t last_use{0u};
+		std::vector<slot *> slots{};
+	};
+
+	static constexpr size_t cached_storages = 4z;
+
+	// blocks of slots of one thread (for each type), each of them belongs to one storage
+	struct thread_cache {
+		std::array<cached_slots, cached_storages> entries{};
+		uint64_t uses{0u};
+	};
+
+	static inline thread_local thread_cache cache{};
+
+	// ids are never reused, so a cache can't be mistaken for a cache of a destroyed storage
+	static inline std::atomic<uint64_t> next_id{1u};
+
+	// living storages, so slots of an evicted cache can be returned to their owner
+	static inline std::mutex registry_lock{};
+	static inline std::unordered_map<uint64_t, slot_storage *> registry{};
+
+	const uint64_t id{next_id.fetch_add(1u, std::memory_order_relaxed)};
+
+	mutable std::mutex lock{};
+	std::vector<std::unique_ptr<slot[]>> blocks{};
+	std::vector<slot *> free_slots{};
+	std::atomic<size_t> live{0z};
+
+public:
+	slot_storage() {
+		std::lock_guard _{registry_lock};
+		registry.emplace(id, this);
+	}
+
+	slot_storage(const slot_storage &) = delete;
+	slot_storage & operator=(const slot_storage &) = delete;
+
+	~slot_storage() {
+		{
+			// nobody can return slots into this storage after this point
+			std::lock_guard _{registry_lock};
+			registry.erase(id);
+		}
+
+		for (const auto & block: blocks) {
+			for (size_t i = 0z; i != BlockSize; ++i) {
+				if (block[i].used.load(std::memory_order_relaxed)) {
+					std::destroy_at(std::launder(reinterpret_cast<T *>(block[i].data)));
+				}
+			}
+		}
+	}
+
+	template <typename... Args> auto emplace(Args &&... args) -> T * {
+		std::vector<slot *> & slots = cached();
+
+		if (slots.empty()) {
+			refill(slots);
+		}
+
+		slot * const s = slots.back();
+		T * const result = std::construct_at(reinterpret_cast<T *>(s->data), std::forward<Args>(args)...);
+
+		// slot is taken only after the record was constructed (it can throw)
+		slots.pop_back();
+		s->used.store(true, std::memory_order_relaxed);
+		live.fetch_add(1z, std::memory_order_relaxed);
+
+		return result;
+	}
+
+	void erase(T * value) noexcept {
+		// record is always at the beginning of its slot
+		slot * const s = reinterpret_cast<slot *>(value);
+
+		std::destroy_at(value);
+		s->generation.fetch_add(1u, std::memory_order_relaxed);
+		s->used.store(false, std::memory_order_relaxed);
+		live.fetch_sub(1z, std::memory_order_relaxed);
+
+		std::lock_guard _{lock};
+		free_slots.push_back(s);
+	}
+
+	// generation of a living record returned by `emplace` of this storage
+	uint64_t generation(const T * value) const noexcept {
+		return reinterpret_cast<const slot *>(value)->generation.load(std::memory_order_relaxed);
+	}
+
+	// record returned by `emplace` of this storage with `generation` wasn't erased yet (even if its slot was reused)
+	bool contains(const T * value, uint64_t gen) const noexcept {
+		const slot * s = reinterpret_cast<const slot *>(value);
+		return s->used.load(std::memory_order_relaxed) && s->generation.load(std::memory_order_relaxed) == gen;
+	}
+
+	size_t size() const noexcept {
+		return live.load(std::memory_order_relaxed);
+	}
+
+	// number of allocated slots (used or not)
+	size_t capacity() const noexcept {
+		std::lock_guard _{lock};
+		return blocks.size() * BlockSize;
+	}
+
+private:
+	// slots of this thread for this storage
+	auto cached() -> std::vector<slot *> & {
+		const uint64_t now = ++cache.uses;
+
+		cached_slots * victim = &cache.entries.front();
+
+		for (cached_slots & entry: cache.entries) {
+			if (entry.owner == id) {
+				entry.last_use = now;
+				return entry.slots;
+			}
+
+			if (entry.last_use < victim->last_use) {
+				victim = &entry;
+			}
+		}
+
+		give_back(*victim);
+
+		victim->owner = id;
+		victim->last_use = now;
+		return victim->slots;
+	}
+
+	// unused slots go back to their storage (if it still exists)
+	static void give_back(cached_slots & entry) noexcept {
+		if (!entry.slots.empty()) {
+			std::lock_guard _{registry_lock};
+
+			if (const auto it = registry.find(entry.owner); it != registry.end()) {
+				slot_storage & owner = *it->second;
+				std::lock_guard _owner{owner.lock};
+
+				try {
+					owner.free_slots.insert(owner.free_slots.end(), entry.slots.begin(), entry.slots.end());
+				} catch (...) {
+					// slots are lost until the storage is destroyed
+				}
+			}
+		}
+
+		entry.slots.clear();
+	}
+
+	void refill(std::vector<slot *> & output) {
+		std::lock_guard _{lock};
+
+		if (!free_slots.empty()) {
+			const size_t count = std::min(free_slots.size(), BlockSize);
+			output.assign(free_slots.end() - static_cast<std::ptrdiff_t>(count), free_slots.end());
+			free_slots.resize(free_slots.size() - count);
+			return;
+		}
+
+		auto & block = blocks.emplace_back(std::make_unique<slot[]>(BlockSize));
+
+		output.resize(BlockSize);
+
+		// taken from the back, so records of one thread are in ascending addresses
+		for (size_t i = 0z; i != BlockSize; ++i) {
+			output[i] = &block[BlockSize - 1z - i];
+		}
+	}
+};
+
+} // namespace ctdb::support
+
+#endif
@@ -0,0 +1,189 @@
+#ifndef CTDB_SUPPORT_WORK_STEALING_POOL_HPP
+#define CTDB_SUPPORT_WORK_STEALING_POOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <vector>
+#include <cstddef>
+
+namespace ctdb::support {
+
+// fixed set of workers, each with its own queue, idle workers steal from the others
+// thread waiting for its tasks runs them too (so nested `parallel_for` can't deadlock)
+class work_stealing_pool {
+	struct worker_queue {
+		std::mutex lock{};
+		std::deque<std::function<void()>> tasks{};
+	};
+
+	std::vector<std::unique_ptr<worker_queue>> queues;
+	std::atomic<size_t> queued{0z};
+	std::atomic<size_t> next_queue{0z};
+
+	std::mutex sleep_lock{};
+	std::condition_variable_any wake{};
+
+	// must be last, so workers are joined before queues are destroyed
+	std::vector<std::jthread> workers{};
+
+public:
+	explicit work_stealing_pool(size_t threads = std::thread::hardware_concurrency()): queues(std::max(threads, size_t{1})) {
+		for (auto & queue: queues) {
+			queue = std::make_unique<worker_queue>();
+		}
+
+		workers.reserve(queues.size());
+
+		for (size_t i = 0z; i != queues.size(); ++i) {
+			workers.emplace_back([this, i](std::stop_token stop) { work(stop, i); });
+		}
+	}
+
+	work_stealing_pool(const work_stealing_pool &) = delete;
+	work_stealing_pool & operator=(const work_stealing_pool &) = delete;
+
+	size_t size() const noexcept {
+		return workers.size();
+	}
+
+	// call `fn(i)` for each `i` in [0, count) and wait for all of them
+	// first exception thrown by any of the calls is rethrown (after all of them finished)
+	template <typename Fn> void parallel_for(size_t count, Fn && fn) {
+		if (count == 0z) {
+			return;
+		}
+
+		if (count == 1z) {
+			fn(0z);
+			return;
+		}
+
+		struct shared_state {
+			std::atomic<size_t> remaining;
+			std::mutex error_lock{};
+			std::exception_ptr error{};
+
+			explicit shared_state(size_t n) noexcept: remaining{n} { }
+		};
+
+		// tasks keep the state alive, they still touch it after the waiting thread was released
+		const auto state = std::make_shared<shared_state>(count);
+
+		const auto run = [&fn](shared_state & st, size_t i) noexcept {
+			try {
+				fn(i);
+			} catch (...) {
+				std::lock_guard _{st.error_lock};
+
+				if (!st.error) {
+					st.error = std::current_exception();
+				}
+			}
+
+			if (st.remaining.fetch_sub(1z, std::memory_order_acq_rel) == 1z) {
+				st.remaining.notify_all();
+			}
+		};
+
+		for (size_t i = 1z; i != count; ++i) {
+			push([state, run, i] { run(*state, i); });
+		}
+
+		wake_workers();
+
+		// first one is done by the caller
+		run(*state, 0z);
+
+		const size_t start = next_queue.load(std::memory_order_relaxed);
+
+		for (size_t left = state->remaining.load(std::memory_order_acquire); left != 0z; left = state->remaining.load(std::memory_order_acquire)) {
+			if (!try_run(start)) {
+				state->remaining.wait(left, std::memory_order_acquire);
+			}
+		}
+
+		if (state->error) {
+			std::rethrow_exception(state->error);
+		}
+	}
+
+private:
+	void push(std::function<void()> task) {
+		worker_queue & queue = *queues[next_queue.fetch_add(1z, std::memory_order_relaxed) % queues.size()];
+
+		{
+			std::lock_guard _{queue.lock};
+			queue.tasks.push_back(std::move(task));
+		}
+
+		queued.fetch_add(1z, std::memory_order_release);
+	}
+
+	void wake_workers() {
+		// workers check `queued` under this lock, so the notification can't be lost
+		{
+			std::lock_guard _{sleep_lock};
+		}
+
+		wake.notify_all();
+	}
+
+	// own queue is used as a stack (LIFO), other queues are stolen from the front
+	bool try_run(size_t own) {
+		for (size_t k = 0z; k != queues.size(); ++k) {
+			worker_queue & queue = *queues[(own + k) % queues.size()];
+			std::function<void()> task{};
+
+			{
+				std::lock_guard _{queue.lock};
+
+				if (queue.tasks.empty()) {
+					continue;
+				}
+
+				if (k == 0z) {
+					task = std::move(queue.tasks.back());
+					queue.tasks.pop_back();
+				} else {
+					task = std::move(queue.tasks.front());
+					queue.tasks.pop_front();
+				}
+			}
+
+			queued.fetch_sub(1z, std::memory_order_relaxed);
+			task();
+			return true;
+		}
+
+		return false;
+	}
+
+	void work(std::stop_token stop, size_t own) {
+		while (!stop.stop_requested()) {
+			if (try_run(own)) {
+				continue;
+			}
+
+			std::unique_lock guard{sleep_lock};
+			wake.wait(guard, stop, [&] { return queued.load(std::memory_order_acquire) != 0z; });
+		}
+	}
+};
+
+// pool shared by all tables which were not given their own
+inline auto default_pool() -> work_stealing_pool & {
+	static work_stealing_pool pool{};
+	return pool;
+}
+
+} // namespace ctdb::support
+
+#endif
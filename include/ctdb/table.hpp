@@ -2,8 +2,13 @@
 #define CTDB_TABLE_HPP
 
 #include "indices/indices.hpp"
+#include "instrumentation.hpp"
+#include <algorithm>
+#include <array>
 #include <list>
+#include <optional>
 #include <utility>
+#include <vector>
 #include <cassert>
 #include <compare>
 
@@ -36,24 +41,108 @@ template <typename T> struct table_range {
 	}
 };
 
+// result collected from more places (shards, stripes), it owns keys and dereferences them into records
+template <typename Key> struct merged_range {
+	std::vector<Key> keys{};
+
+	constexpr auto begin() const noexcept {
+		return index_iterator{keys.begin()};
+	}
+
+	constexpr auto end() const noexcept {
+		return index_iterator{keys.end()};
+	}
+
+	constexpr auto ascending() const & noexcept {
+		return index_range{keys.begin(), keys.end()};
+	}
+
+	constexpr auto descending() const & noexcept {
+		return index_range{keys.rbegin(), keys.rend()};
+	}
+
+	// temporary result (`tbl.all<T>().descending()`) must keep owning its keys
+	constexpr auto ascending() && noexcept -> merged_range {
+		return std::move(*this);
+	}
+
+	constexpr auto descending() && noexcept -> merged_range {
+		std::ranges::reverse(keys);
+		return std::move(*this);
+	}
+
+	constexpr size_t size() const noexcept {
+		return keys.size();
+	}
+
+	constexpr bool empty() const noexcept {
+		return keys.empty();
+	}
+};
+
+// live memory of a table, `indices` are in same order as in the table's type
+template <size_t IndexCount> struct table_memory_usage {
+	memory_footprint records{};
+	std::array<memory_footprint, IndexCount> indices{};
+
+	constexpr auto total() const noexcept -> memory_footprint {
+		memory_footprint result = records;
+
+		for (const memory_footprint & index: indices) {
+			result += index;
+		}
+
+		return result;
+	}
+};
+
 struct always_same {
 	constexpr bool operator()(const auto &, const auto &) const noexcept {
 		return false;
 	}
 };
 
-template <typename Record, typename... Indices> struct table {
+// `Instrumentation` policy (see instrumentation.hpp) counts work done by the table and its indices
+// - lookups measure only the search, iteration over returned range is not part of it
+template <typename Instrumentation, typename Record, typename... Indices> struct basic_table {
 	using record_type = Record;
+	using instrumentation_type = Instrumentation;
 
 	// TODO: use hive, to avoid many allocations
-	std::list<record_type> content;
+	std::list<record_type, instrumented_allocator_t<record_type, instrumentation_type>> content;
 	using primary_key = typename decltype(content)::iterator;
+	using const_primary_key = typename decltype(content)::const_iterator;
 
 	static_assert(sizeof(primary_key) == sizeof(void *));
 
-	indices_tuple<primary_key, Indices...> indices;
+	basic_indices_tuple<instrumentation_type, primary_key, Indices...> indices;
+
+	[[no_unique_address]] instrumentation_type instrumentation{};
+
+	constexpr basic_table() = default;
+
+	// indices refer to records of the original, so they are built again for the copy
+	constexpr basic_table(const basic_table & other): content{other.content} {
+		rebuild_indices();
+	}
+
+	// moved list keeps its nodes, so indices are still valid
+	constexpr basic_table(basic_table &&) noexcept = default;
+
+	constexpr basic_table & operator=(const basic_table & other) {
+		if (this != &other) {
+			basic_table tmp{other};
+			*this = std::move(tmp);
+		}
+
+		return *this;
+	}
+
+	constexpr basic_table & operator=(basic_table &&) noexcept = default;
 
 	template <typename... Args> constexpr auto emplace(Args &&... args) -> std::optional<primary_key> {
+		const typename instrumentation_type::scope _{instrumentation, operation::insert};
+
 		// this will always insert new record at the end O(1)
 		const auto & item = content.emplace_front(std::forward<Args>(args)...);
 		const auto it = content.begin();
@@ -71,6 +160,8 @@ template <typename Record, typename... Indices> struct table {
 	}
 
 	constexpr bool erase(primary_key it) noexcept {
+		const typename instrumentation_type::scope _{instrumentation, operation::erase};
+
 		if (indices.remove(it)) {
 			content.erase(it);
 			return true;
@@ -83,6 +174,186 @@ template <typename Record, typename... Indices> struct table {
 		return content.size();
 	}
 
+	// many records at once, indices are built in parallel (one task per index and parallel sort)
+	// result is same as calling `emplace` for each of them in order (nullopt for refused records)
+	template <typename Range> auto emplace_batch(const Range & records, support::work_stealing_pool * pool = nullptr) -> std::vector<std::optional<primary_key>> {
+		const typename instrumentation_type::scope _{instrumentation, operation::insert};
+
+		decltype(content) added{content.get_allocator()};
+		std::vector<primary_key> keys{};
+
+		for (const auto & record: records) {
+			added.emplace_front(record);
+			keys.push_back(added.begin());
+		}
+
+		// splicing keeps iterators valid (and same order as `emplace` would create)
+		content.splice(content.begin(), added);
+
+		std::vector<std::optional<primary_key>> result{};
+		result.reserve(keys.size());
+
+		if (indices.bulk_insert(keys, pool_for(keys.size(), pool))) {
+			result.assign(keys.begin(), keys.end());
+			return result;
+		}
+
+		// some record was refused, only one by one insertion knows which one would be first
+		for (const primary_key it: keys) {
+			if (indices.insert(it)) {
+				result.emplace_back(it);
+			} else {
+				content.erase(it);
+				result.emplace_back(std::nullopt);
+			}
+		}
+
+		return result;
+	}
+
+	// build all indices from records again (in parallel for big tables)
+	// keys go in same order as if the records were inserted one by one (from the end of the list)
+	constexpr void rebuild_indices(support::work_stealing_pool * pool = nullptr) {
+		indices = {};
+
+		std::vector<primary_key> keys{};
+		keys.reserve(content.size());
+
+		for (auto it = content.rbegin(); it != content.rend(); ++it) {
+			keys.push_back(std::prev(it.base()));
+		}
+
+		[[maybe_unused]] const bool inserted = indices.bulk_insert(keys, pool_for(keys.size(), pool));
+		assert(inserted);
+	}
+
+	// small inputs are not worth of waking up other threads
+	static constexpr size_t parallel_threshold = 4096z;
+
+	static auto pool_for(size_t count, support::work_stealing_pool * pool) -> support::work_stealing_pool * {
+		if (count < parallel_threshold) {
+			return nullptr;
+		}
+
+		return (pool != nullptr) ? pool : &support::default_pool();
+	}
+
+	// records for which `pred(record)` is true (in order of `all()`), chunks of the `scan_chunks` index are scanned in parallel for big tables
+	// (predicate is called from more threads at once)
+	template <typename Pred> auto scan(Pred pred, support::work_stealing_pool * pool = nullptr) const -> merged_range<const_primary_key> {
+		const typename instrumentation_type::scope _{instrumentation, operation::lookup};
+
+		const auto bounds = chunk_bounds();
+		std::vector<std::vector<const_primary_key>> parts(bounds.size() - 1z);
+
+		run_chunks(bounds, pool, [&](size_t chunk, const_primary_key first, const_primary_key last) {
+			for (; first != last; ++first) {
+				if (pred(*first)) {
+					parts[chunk].push_back(first);
+				}
+			}
+		});
+
+		size_t total = 0z;
+
+		for (const auto & part: parts) {
+			total += part.size();
+		}
+
+		// chunks are merged in their order, so the result is deterministic
+		merged_range<const_primary_key> result{};
+		result.keys.reserve(total);
+
+		for (const auto & part: parts) {
+			result.keys.insert(result.keys.end(), part.begin(), part.end());
+		}
+
+		return result;
+	}
+
+	template <typename Pred> auto count_if(Pred pred, support::work_stealing_pool * pool = nullptr) const -> size_t {
+		const typename instrumentation_type::scope _{instrumentation, operation::lookup};
+
+		const auto bounds = chunk_bounds();
+		std::vector<size_t> counts(bounds.size() - 1z);
+
+		run_chunks(bounds, pool, [&](size_t chunk, const_primary_key first, const_primary_key last) {
+			size_t count = 0z;
+
+			for (; first != last; ++first) {
+				count += static_cast<bool>(pred(*first));
+			}
+
+			counts[chunk] = count;
+		});
+
+		size_t result = 0z;
+
+		for (const size_t count: counts) {
+			result += count;
+		}
+
+		return result;
+	}
+
+	// `combine` of `transform(record)` of all records, each chunk is reduced on its own
+	// and partial results are combined into `init` in order of chunks
+	// (chunks don't depend on number of threads, so non-associative reductions give same result with any pool)
+	template <typename T, typename Combine, typename Transform> auto reduce(T init, Combine combine, Transform transform, support::work_stealing_pool * pool = nullptr) const -> T {
+		const typename instrumentation_type::scope _{instrumentation, operation::lookup};
+
+		const auto bounds = chunk_bounds();
+		std::vector<std::optional<T>> partials(bounds.size() - 1z);
+
+		run_chunks(bounds, pool, [&](size_t chunk, const_primary_key first, const_primary_key last) {
+			if (first == last) {
+				return;
+			}
+
+			T value = transform(*first);
+
+			while (++first != last) {
+				value = combine(std::move(value), transform(*first));
+			}
+
+			partials[chunk] = std::move(value);
+		});
+
+		for (auto & partial: partials) {
+			if (partial) {
+				init = combine(std::move(init), std::move(*partial));
+			}
+		}
+
+		return init;
+	}
+
+private:
+	// begin, marks of the `scan_chunks` index in order of the list and end (one chunk without the index)
+	auto chunk_bounds() const -> std::vector<const_primary_key> {
+		if constexpr (decltype(indices)::template has_index_for<scan_chunks>) {
+			return indices.template index_for<scan_chunks>().bounds(content.begin(), content.end());
+		} else {
+			return {content.begin(), content.end()};
+		}
+	}
+
+	template <typename Fn> void run_chunks(const std::vector<const_primary_key> & bounds, support::work_stealing_pool * pool, Fn && fn) const {
+		const size_t chunks = bounds.size() - 1z;
+		const auto run = [&](size_t chunk) { fn(chunk, bounds[chunk], bounds[chunk + 1z]); };
+
+		// single chunk is not worth of waking up other threads
+		if (support::work_stealing_pool * p = pool_for(content.size(), pool); p != nullptr && chunks != 1z) {
+			p->parallel_for(chunks, run);
+			return;
+		}
+
+		for (size_t chunk = 0z; chunk != chunks; ++chunk) {
+			run(chunk);
+		}
+	}
+
+public:
 	template <typename Type> constexpr auto size() const noexcept {
 		// be aware of old GCC ABI!
 		return indices.template size<Type>();
@@ -93,18 +364,69 @@ template <typename Record, typename... Indices> struct table {
 	}
 
 	template <typename Type> constexpr auto all() const noexcept {
+		const typename instrumentation_type::scope _{instrumentation, operation::lookup};
 		return indices.template all<Type>();
 	}
 
 	template <typename Type> constexpr auto equal(const Type & value) const noexcept {
+		const typename instrumentation_type::scope _{instrumentation, operation::lookup};
 		return indices.template equal<Type>(value);
 	}
 
+	template <typename Type> constexpr auto range(const Type & from, const Type & to) const noexcept {
+		const typename instrumentation_type::scope _{instrumentation, operation::lookup};
+		return indices.template range<Type>(from, to);
+	}
+
+	// records matching all the values at once, each of them must be served by a bitmap index
+	template <typename... Types> auto equal_all(const Types &... values) const -> bitmap_range<record_type> {
+		static_assert(sizeof...(Types) != 0z);
+		const typename instrumentation_type::scope _{instrumentation, operation::lookup};
+		return {(indices.template index_for<Types>().bitmap_of(values) & ...)};
+	}
+
+	// records matching any of the values, each of them must be served by a bitmap index
+	template <typename... Types> auto equal_any(const Types &... values) const -> bitmap_range<record_type> {
+		static_assert(sizeof...(Types) != 0z);
+		const typename instrumentation_type::scope _{instrumentation, operation::lookup};
+		return {(indices.template index_for<Types>().bitmap_of(values) | ...)};
+	}
+
+	// aggregates maintained by the `aggregate<GroupView, Aggregators...>` index (`Aggregate` is the index's type)
+	template <typename Aggregate> constexpr auto aggregates() const noexcept -> const auto & {
+		return indices.template index_for<Aggregate>();
+	}
+
 	template <typename Type> constexpr auto operator==(const Type & value) const noexcept {
+		const typename instrumentation_type::scope _{instrumentation, operation::lookup};
 		return indices.template equal<Type>(value);
 	}
+
+	// snapshot of counters (always empty without instrumentation)
+	constexpr auto stats() const noexcept -> instrumentation_stats {
+		return instrumentation.stats();
+	}
+
+	// memory is tracked by allocator of each container, so it's available only with instrumentation
+	auto memory_usage() const noexcept -> table_memory_usage<decltype(indices)::index_count>
+	requires(instrumentation_type::enabled)
+	{
+		table_memory_usage<decltype(indices)::index_count> result{};
+		result.records = content.get_allocator().footprint();
+		indices.memory_usage(result.indices.data());
+		return result;
+	}
+
+	template <typename Type> auto memory_usage() const noexcept -> memory_footprint
+	requires(instrumentation_type::enabled)
+	{
+		return indices.template index_for<Type>().get_allocator().footprint();
+	}
 };
 
+template <typename Record, typename... Indices> using table = basic_table<no_instrumentation, Record, Indices...>;
+template <typename Record, typename... Indices> using instrumented_table = basic_table<counting_instrumentation, Record, Indices...>;
+
 } // namespace ctdb
 
 #endif
@@ -0,0 +1,303 @@
+#ifndef CTDB_TRAITS_STORAGE_AGGREGATE_HPP
+#define CTDB_TRAITS_STORAGE_AGGREGATE_HPP
+
+#include "../../instrumentation.hpp"
+#include "../traits.hpp"
+#include <functional>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <concepts>
+#include <cstddef>
+
+namespace ctdb {
+
+// mark with aggregate to keep aggregates of records for each distinct value of the group view
+// (materialized view updated with each insertion and removal, queries don't touch any record)
+// - group view is stored as a key of its group, so it must own its value (not a view into the record)
+// - the index doesn't refer to records, so it can't be used for lookups of records
+template <typename GroupView, typename... Aggregators> struct aggregate { };
+
+// forward declaration
+template <typename IndexType> struct index_storage_traits;
+
+namespace aggregators {
+
+// aggregators keep a state for each group, which is updated when a record is added into the group or removed from it
+
+// number of records
+struct count {
+	struct state {
+		size_t value{0z};
+
+		template <typename Record> constexpr void add(const Record &) noexcept {
+			++value;
+		}
+
+		template <typename Record> constexpr void remove(const Record &) noexcept {
+			--value;
+		}
+
+		constexpr auto result() const noexcept -> size_t {
+			return value;
+		}
+
+		constexpr size_t memory_bytes() const noexcept {
+			return 0z;
+		}
+	};
+};
+
+// sum of views of records, the view needs `+` and `-` (usually it's an arithmetic type)
+// (floating point sum is updated by subtraction, so it can differ from a sum computed again by rounding)
+template <typename View> struct sum {
+	struct state {
+		View value{};
+
+		template <typename Record> constexpr void add(const Record & record) {
+			value = value + static_cast<View>(record);
+		}
+
+		template <typename Record> constexpr void remove(const Record & record) noexcept {
+			value = value - static_cast<View>(record);
+		}
+
+		constexpr auto result() const noexcept -> View {
+			return value;
+		}
+
+		constexpr size_t memory_bytes() const noexcept {
+			return 0z;
+		}
+	};
+};
+
+// views of records with number of their occurrences, so the smallest and the biggest are known after removals too
+template <typename View> struct ordered_views {
+	using map_type = std::map<View, size_t, std::less<>>;
+
+	map_type values{};
+
+	template <typename Record> void add(const Record & record) {
+		++values[static_cast<View>(record)];
+	}
+
+	template <typename Record> void remove(const Record & record) noexcept {
+		const auto it = values.find(static_cast<View>(record));
+
+		if (--it->second == 0z) {
+			values.erase(it);
+		}
+	}
+
+	// node of the map is counted as its value with color and three pointers
+	constexpr size_t memory_bytes() const noexcept {
+		return values.size() * (sizeof(typename map_type::value_type) + 4z * sizeof(void *));
+	}
+};
+
+// smallest view of records (nothing for an empty group)
+template <typename View> struct min {
+	struct state: ordered_views<View> {
+		constexpr auto result() const -> std::optional<View> {
+			if (this->values.empty()) {
+				return std::nullopt;
+			}
+
+			return this->values.begin()->first;
+		}
+	};
+};
+
+// biggest view of records (nothing for an empty group)
+template <typename View> struct max {
+	struct state: ordered_views<View> {
+		constexpr auto result() const -> std::optional<View> {
+			if (this->values.empty()) {
+				return std::nullopt;
+			}
+
+			return this->values.rbegin()->first;
+		}
+	};
+};
+
+} // namespace aggregators
+
+template <typename T, typename... Ts> constexpr size_t index_of_type() noexcept {
+	constexpr bool matches[] = {std::is_same_v<T, Ts>...};
+
+	for (size_t i = 0z; i != sizeof...(Ts); ++i) {
+		if (matches[i]) {
+			return i;
+		}
+	}
+
+	return sizeof...(Ts);
+}
+
+// states of all aggregators of one group
+template <typename... Aggregators> class aggregate_values {
+	std::tuple<typename Aggregators::state...> states{};
+	size_t records{0z};
+
+	using indices = std::index_sequence_for<Aggregators...>;
+
+public:
+	// result of the aggregator (first one of the type)
+	template <typename Aggregator> constexpr auto get() const {
+		constexpr size_t index = index_of_type<Aggregator, Aggregators...>();
+		static_assert(index != sizeof...(Aggregators), "aggregator is not part of the index");
+
+		return std::get<index>(states).result();
+	}
+
+	// number of records in the group
+	constexpr size_t size() const noexcept {
+		return records;
+	}
+
+	constexpr bool empty() const noexcept {
+		return records == 0z;
+	}
+
+	template <typename Record> constexpr void add(const Record & record) {
+		[&]<size_t... I>(std::index_sequence<I...>) { (std::get<I>(states).add(record), ...); }(indices{});
+		++records;
+	}
+
+	template <typename Record> constexpr void remove(const Record & record) noexcept {
+		[&]<size_t... I>(std::index_sequence<I...>) { (std::get<I>(states).remove(record), ...); }(indices{});
+		--records;
+	}
+
+	constexpr size_t memory_bytes() const noexcept {
+		return [&]<size_t... I>(std::index_sequence<I...>) { return (0z + ... + std::get<I>(states).memory_bytes()); }(indices{});
+	}
+};
+
+// container-like storage used by `index_helper`: aggregates of each group and of all records
+template <typename GroupView, typename PKey, typename... Aggregators> class aggregate_storage {
+public:
+	using record_type = std::remove_cvref_t<decltype(*std::declval<PKey>())>;
+	using values_type = aggregate_values<Aggregators...>;
+	using group_map = std::map<GroupView, values_type, std::less<>>;
+
+private:
+	group_map data{};
+	values_type everything{};
+
+public:
+	// position of a record (its group and the record), it's not possible to iterate records
+	class const_iterator {
+		friend class aggregate_storage;
+
+		typename group_map::const_iterator group{};
+		PKey key{};
+
+		constexpr const_iterator(typename group_map::const_iterator g, PKey k) noexcept: group{g}, key{k} { }
+
+	public:
+		constexpr const_iterator() noexcept = default;
+
+		friend constexpr bool operator==(const const_iterator & lhs, const const_iterator & rhs) noexcept {
+			return lhs.group == rhs.group;
+		}
+	};
+
+	using iterator = const_iterator;
+
+	constexpr auto begin() const noexcept -> const_iterator {
+		return {data.begin(), PKey{}};
+	}
+
+	constexpr auto end() const noexcept -> const_iterator {
+		return {data.end(), PKey{}};
+	}
+
+	// number of aggregated records
+	constexpr size_t size() const noexcept {
+		return everything.size();
+	}
+
+	// there is nothing to reserve (interface of hashed storage)
+	constexpr void reserve(size_t) const noexcept { }
+
+	// records are never refused
+	auto emplace(const PKey & pkey) -> std::pair<const_iterator, bool> {
+		const auto group = data.try_emplace(static_cast<GroupView>(*pkey)).first;
+
+		group->second.add(*pkey);
+		everything.add(*pkey);
+
+		return {const_iterator{group, pkey}, true};
+	}
+
+	// record must be still alive (indices are updated before it's destroyed)
+	void erase(const_iterator it) noexcept {
+		const auto group = data.erase(it.group, it.group);
+
+		group->second.remove(*it.key);
+		everything.remove(*it.key);
+
+		if (group->second.empty()) {
+			data.erase(group);
+		}
+	}
+
+	auto find(const PKey & pkey) const noexcept -> const_iterator {
+		return {data.find(static_cast<GroupView>(*pkey)), pkey};
+	}
+
+	// aggregates of records in the group (empty when there is no such record)
+	template <typename T>
+	requires(std::totally_ordered_with<T, GroupView>)
+	auto group(const T & value) const noexcept -> const values_type & {
+		static const values_type nothing{};
+
+		const auto it = data.find(value);
+		return (it != data.end()) ? it->second : nothing;
+	}
+
+	// aggregates of all records
+	constexpr auto total() const noexcept -> const values_type & {
+		return everything;
+	}
+
+	// all non-empty groups in order of their view
+	constexpr auto groups() const noexcept -> const group_map & {
+		return data;
+	}
+
+	constexpr size_t group_count() const noexcept {
+		return data.size();
+	}
+
+	// estimate from states of aggregators (node of the group map is counted as its value with color and three pointers)
+	auto footprint() const noexcept -> memory_footprint {
+		memory_footprint result{.bytes = everything.memory_bytes(), .blocks = 0z};
+
+		for (const auto & [value, values]: data) {
+			result.bytes += sizeof(typename group_map::value_type) + 4z * sizeof(void *) + values.memory_bytes();
+			result.blocks += 1z;
+		}
+
+		return result;
+	}
+};
+
+template <typename GroupView, typename... Aggregators> struct index_storage_traits<aggregate<GroupView, Aggregators...>> {
+	template <typename PKey> using entry = PKey;
+	template <typename PKey> using storage_type = aggregate_storage<GroupView, PKey, Aggregators...>;
+
+	// it's found only by its own type (`tbl.aggregates<aggregate<...>>()`)
+	template <typename Other> static constexpr bool compatible_type = std::same_as<Other, aggregate<GroupView, Aggregators...>>;
+};
+
+} // namespace ctdb
+
+#endif
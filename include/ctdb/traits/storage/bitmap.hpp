@@ -0,0 +1,271 @@
+#ifndef CTDB_TRAITS_STORAGE_BITMAP_HPP
+#define CTDB_TRAITS_STORAGE_BITMAP_HPP
+
+#include "../../indices/support/roaring.hpp"
+#include "../../instrumentation.hpp"
+#include "../traits.hpp"
+#include <bit>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <utility>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+
+namespace ctdb {
+
+// mark with bitmap to keep a compressed bitmap of records for each distinct value of the view
+// (for low-cardinality views like flags or states, it needs a few bytes per record instead of a tree node)
+// - view is stored as a key of its group, so it must own its value (not a view into the record)
+// - lookups yield records (pointers to them), not primary keys
+template <typename> struct bitmap { };
+
+// forward declaration
+template <typename IndexType> struct index_storage_traits;
+
+// records are identified by their address (divided by alignment), so no extra slot table is needed
+template <typename Record> struct record_slots {
+	static constexpr unsigned shift = static_cast<unsigned>(std::countr_zero(alignof(Record)));
+
+	static auto slot_of(const Record & record) noexcept -> uint64_t {
+		return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(std::addressof(record))) >> shift;
+	}
+
+	static auto record_at(uint64_t slot) noexcept -> const Record * {
+		return reinterpret_cast<const Record *>(static_cast<uintptr_t>(slot << shift));
+	}
+};
+
+// records of a bitmap (usually a combination of more bitmap indices), it owns the bitmap
+template <typename Record> struct bitmap_range {
+	support::roaring_bitmap bits{};
+
+	struct iterator {
+		support::roaring_bitmap::const_iterator it{};
+
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = Record;
+		using difference_type = std::ptrdiff_t;
+		using reference = const Record &;
+		using pointer = const Record *;
+
+		constexpr reference operator*() const noexcept {
+			return *record_slots<Record>::record_at(*it);
+		}
+
+		constexpr iterator & operator++() noexcept {
+			++it;
+			return *this;
+		}
+
+		constexpr iterator operator++(int) noexcept {
+			auto copy = *this;
+			++it;
+			return copy;
+		}
+
+		friend constexpr bool operator==(const iterator &, const iterator &) noexcept = default;
+	};
+
+	constexpr auto begin() const noexcept -> iterator {
+		return {bits.begin()};
+	}
+
+	constexpr auto end() const noexcept -> iterator {
+		return {bits.end()};
+	}
+
+	constexpr size_t size() const noexcept {
+		return bits.size();
+	}
+
+	constexpr bool empty() const noexcept {
+		return bits.empty();
+	}
+};
+
+// container-like storage used by `index_helper`: groups of records by value of the view
+template <typename View, typename PKey> class bitmap_storage {
+public:
+	using record_type = std::remove_cvref_t<decltype(*std::declval<PKey>())>;
+	using slots = record_slots<record_type>;
+
+private:
+	using group_map = std::map<View, support::roaring_bitmap, std::less<>>;
+
+	group_map groups{};
+	size_t count{0z};
+
+public:
+	// it yields pointers to records in order of (view, address)
+	class const_iterator {
+		friend class bitmap_storage;
+
+		typename group_map::const_iterator group{};
+		typename group_map::const_iterator last{};
+		support::roaring_bitmap::const_iterator bit{};
+
+		// current record, so the iterator can be erased even after other insertions moved the bit
+		uint64_t slot{0u};
+
+		constexpr const_iterator(typename group_map::const_iterator g, typename group_map::const_iterator l) noexcept: group{g}, last{l} {
+			if (group != last) {
+				bit = group->second.begin();
+				slot = *bit;
+			}
+		}
+
+		constexpr const_iterator(typename group_map::const_iterator g, typename group_map::const_iterator l, support::roaring_bitmap::const_iterator b) noexcept: group{g}, last{l}, bit{b}, slot{*b} { }
+
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = const record_type *;
+		using difference_type = std::ptrdiff_t;
+		using reference = const record_type *;
+		using pointer = void;
+
+		constexpr const_iterator() noexcept = default;
+
+		constexpr auto operator*() const noexcept -> const record_type * {
+			return slots::record_at(slot);
+		}
+
+		constexpr const_iterator & operator++() noexcept {
+			if (++bit == group->second.end()) {
+				// groups are never empty
+				if (++group == last) {
+					return *this;
+				}
+
+				bit = group->second.begin();
+			}
+
+			slot = *bit;
+			return *this;
+		}
+
+		constexpr const_iterator operator++(int) noexcept {
+			auto copy = *this;
+			++*this;
+			return copy;
+		}
+
+		friend constexpr bool operator==(const const_iterator & lhs, const const_iterator & rhs) noexcept {
+			return lhs.group == rhs.group && (lhs.group == lhs.last || lhs.bit == rhs.bit);
+		}
+	};
+
+	using iterator = const_iterator;
+
+	constexpr auto begin() const noexcept -> const_iterator {
+		return {groups.begin(), groups.end()};
+	}
+
+	constexpr auto end() const noexcept -> const_iterator {
+		return {groups.end(), groups.end()};
+	}
+
+	constexpr size_t size() const noexcept {
+		return count;
+	}
+
+	// there is nothing to reserve (interface of hashed storage)
+	constexpr void reserve(size_t) const noexcept { }
+
+	auto emplace(const PKey & pkey) -> std::pair<const_iterator, bool> {
+		const auto slot = slots::slot_of(*pkey);
+		const auto group = groups.try_emplace(static_cast<View>(*pkey)).first;
+
+		const bool inserted = group->second.add(slot);
+		count += inserted;
+
+		return {const_iterator{group, groups.end(), group->second.find(slot)}, inserted};
+	}
+
+	// iterator can be erased until its record is removed (it remembers the record, not only a position)
+	void erase(const_iterator it) noexcept {
+		const auto group = groups.erase(it.group, it.group);
+
+		if (group->second.remove(it.slot)) {
+			--count;
+		}
+
+		if (group->second.empty()) {
+			groups.erase(group);
+		}
+	}
+
+	auto find(const PKey & pkey) const noexcept -> const_iterator {
+		const auto group = groups.find(static_cast<View>(*pkey));
+
+		if (group == groups.end()) {
+			return end();
+		}
+
+		const auto bit = group->second.find(slots::slot_of(*pkey));
+
+		if (bit == group->second.end()) {
+			return end();
+		}
+
+		return {group, groups.end(), bit};
+	}
+
+	template <typename T>
+	requires(std::totally_ordered_with<T, View>)
+	auto find(const T & value) const noexcept -> const_iterator {
+		return {groups.find(value), groups.end()};
+	}
+
+	template <typename T>
+	requires(std::totally_ordered_with<T, View>)
+	auto equal_range(const T & value) const noexcept -> std::pair<const_iterator, const_iterator> {
+		const auto group = groups.find(value);
+
+		if (group == groups.end()) {
+			return {end(), end()};
+		}
+
+		return {const_iterator{group, groups.end()}, const_iterator{std::next(group), groups.end()}};
+	}
+
+	// bitmap of records with the value (to combine it with other bitmap indices)
+	template <typename T>
+	requires(std::totally_ordered_with<T, View>)
+	auto bitmap_of(const T & value) const noexcept -> const support::roaring_bitmap & {
+		static const support::roaring_bitmap nothing{};
+
+		const auto group = groups.find(value);
+		return (group != groups.end()) ? group->second : nothing;
+	}
+
+	// number of distinct values
+	constexpr size_t group_count() const noexcept {
+		return groups.size();
+	}
+
+	// estimate from capacities of bitmaps (node of the group map is counted as its value with color and three pointers)
+	auto footprint() const noexcept -> memory_footprint {
+		memory_footprint result{};
+
+		for (const auto & [value, bits]: groups) {
+			result.bytes += sizeof(typename group_map::value_type) + 4z * sizeof(void *) + bits.memory_bytes();
+			result.blocks += 1z;
+		}
+
+		return result;
+	}
+};
+
+template <typename Index> struct index_storage_traits<bitmap<Index>> {
+	template <typename PKey> using entry = PKey;
+	template <typename PKey> using storage_type = bitmap_storage<Index, PKey>;
+
+	template <typename Other> static constexpr bool compatible_type = std::totally_ordered_with<Other, Index>;
+};
+
+} // namespace ctdb
+
+#endif
@@ -0,0 +1,148 @@
+#ifndef CTDB_TRAITS_STORAGE_SCAN_CHUNKS_HPP
+#define CTDB_TRAITS_STORAGE_SCAN_CHUNKS_HPP
+
+#include "../../instrumentation.hpp"
+#include "../traits.hpp"
+#include <map>
+#include <memory>
+#include <new>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+
+namespace ctdb {
+
+// mark with scan_chunks to split unindexed scans of the table (`scan`, `count_if`, `reduce`) into chunks
+// which run in parallel, without it records are scanned by one thread
+// - the index doesn't refer to records, so it can't be used for lookups of records
+struct scan_chunks { };
+
+// forward declaration
+template <typename IndexType> struct index_storage_traits;
+
+// container-like storage used by `index_helper`: marks of first records of chunks (list can't be split without walking it)
+// a new mark is made after every `scan_chunk` inserted records, chunk of an erased mark is merged with the chunk in front of it
+// (new records are inserted at front of the table, so later marks are nearer to the front)
+template <typename PKey> class scan_chunk_storage {
+public:
+	static constexpr size_t scan_chunk = 4096z;
+
+private:
+	std::map<uint64_t, PKey> marks{};
+	std::unordered_map<const void *, uint64_t> marked{};
+	uint64_t next_mark{0u};
+	size_t records{0z};
+	size_t unmarked{0z};
+
+public:
+	// position of a record, it's not possible to iterate records
+	class const_iterator {
+		friend class scan_chunk_storage;
+
+		PKey key{};
+		bool present{false};
+
+		constexpr const_iterator(PKey k, bool p) noexcept: key{k}, present{p} { }
+
+	public:
+		constexpr const_iterator() noexcept = default;
+
+		friend constexpr bool operator==(const const_iterator & lhs, const const_iterator & rhs) noexcept {
+			return lhs.present == rhs.present && (!lhs.present || lhs.key == rhs.key);
+		}
+	};
+
+	using iterator = const_iterator;
+
+	constexpr auto begin() const noexcept -> const_iterator {
+		return {};
+	}
+
+	constexpr auto end() const noexcept -> const_iterator {
+		return {};
+	}
+
+	// number of records
+	constexpr size_t size() const noexcept {
+		return records;
+	}
+
+	// there is nothing to reserve (interface of hashed storage)
+	constexpr void reserve(size_t) const noexcept { }
+
+	// records are never refused (marks only split scans, so when there is no memory for one, current chunk just grows)
+	auto emplace(const PKey & pkey) noexcept -> std::pair<const_iterator, bool> {
+		++records;
+
+		if (++unmarked >= scan_chunk) {
+			try {
+				const auto pos = marks.emplace(next_mark, pkey).first;
+
+				try {
+					marked.emplace(std::addressof(*pkey), next_mark);
+				} catch (...) {
+					marks.erase(pos);
+					throw;
+				}
+
+				++next_mark;
+				unmarked = 0z;
+			} catch (const std::bad_alloc &) { }
+		}
+
+		return {const_iterator{pkey, true}, true};
+	}
+
+	// record must be still alive (indices are updated before it's destroyed)
+	void erase(const_iterator it) noexcept {
+		--records;
+
+		if (const auto pos = marked.find(std::addressof(*it.key)); pos != marked.end()) {
+			marks.erase(pos->second);
+			marked.erase(pos);
+		}
+	}
+
+	auto find(const PKey & pkey) const noexcept -> const_iterator {
+		return {pkey, true};
+	}
+
+	// first, marks in order of the table and last (chunks are between neighbouring bounds)
+	template <typename Key> auto bounds(Key first, Key last) const -> std::vector<Key> {
+		std::vector<Key> result{};
+		result.reserve(marks.size() + 2z);
+
+		result.push_back(first);
+
+		for (auto it = marks.rbegin(); it != marks.rend(); ++it) {
+			result.push_back(it->second);
+		}
+
+		result.push_back(last);
+
+		return result;
+	}
+
+	// estimate: node of the map is counted as its value with color and three pointers, node of the hash map as its value with a pointer and a bucket
+	auto footprint() const noexcept -> memory_footprint {
+		const size_t map_node = sizeof(typename decltype(marks)::value_type) + 4z * sizeof(void *);
+		const size_t hash_node = sizeof(typename decltype(marked)::value_type) + 2z * sizeof(void *);
+
+		return {.bytes = marks.size() * map_node + marked.size() * hash_node, .blocks = marks.size() + marked.size()};
+	}
+};
+
+template <> struct index_storage_traits<scan_chunks> {
+	template <typename PKey> using entry = PKey;
+	template <typename PKey> using storage_type = scan_chunk_storage<PKey>;
+
+	// it's found only by its own type
+	template <typename Other> static constexpr bool compatible_type = std::same_as<Other, scan_chunks>;
+};
+
+} // namespace ctdb
+
+#endif
@@ -29,11 +29,11 @@ template <typename IndexView, typename Entry> struct unique_comparator {
 	}
 
 	// comparison against other types is always against the view only
-	constexpr bool operator()(const_reference lhs, const std::totally_ordered_with<value_type> auto & rhs) const noexcept {
+	constexpr bool operator()(const_reference lhs, const std::totally_ordered_with<index_view> auto & rhs) const noexcept {
 		return static_cast<index_view>(*lhs) < rhs;
 	}
 
-	constexpr bool operator()(const std::totally_ordered_with<value_type> auto & lhs, const_reference rhs) const noexcept {
+	constexpr bool operator()(const std::totally_ordered_with<index_view> auto & lhs, const_reference rhs) const noexcept {
 		return lhs < static_cast<index_view>(*rhs);
 	}
 };
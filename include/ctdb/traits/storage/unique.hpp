@@ -4,6 +4,7 @@
 #include "../traits.hpp"
 #include <unordered_set>
 #include <concepts>
+#include <cstddef>
 
 namespace ctdb {
 
@@ -33,7 +34,7 @@ template <typename IndexView, typename Entry, typename Hash> struct unique_equal
 	}
 
 	template <typename T>
-	requires(std::equality_comparable_with<T, value_type> && hashable_by<T, hash_type>)
+	requires(std::equality_comparable_with<T, index_view> && hashable_by<T, hash_type>)
 	constexpr auto operator()(const T & value) const noexcept {
 		return hash_type{}(value);
 	}
@@ -52,11 +53,11 @@ template <typename IndexView, typename Entry> struct unique_equality {
 	}
 
 	// comparison against other types is always against the view only
-	constexpr bool operator()(const_reference lhs, const std::equality_comparable_with<value_type> auto & rhs) const noexcept {
+	constexpr bool operator()(const_reference lhs, const std::equality_comparable_with<index_view> auto & rhs) const noexcept {
 		return static_cast<index_view>(*lhs) == rhs;
 	}
 
-	constexpr bool operator()(const std::equality_comparable_with<value_type> auto & lhs, const_reference rhs) const noexcept {
+	constexpr bool operator()(const std::equality_comparable_with<index_view> auto & lhs, const_reference rhs) const noexcept {
 		return lhs == static_cast<index_view>(*rhs);
 	}
 };
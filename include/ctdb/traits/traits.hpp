@@ -1,12 +1,16 @@
 #ifndef CTDB_TRAITS_TRAITS_HPP
 #define CTDB_TRAITS_TRAITS_HPP
 
+#include "storage/aggregate.hpp"
+#include "storage/bitmap.hpp"
+#include "storage/scan-chunks.hpp"
 #include "storage/sorted.hpp"
 #include "storage/unique-sorted.hpp"
 #include "storage/unique.hpp"
 #include <optional>
 #include <set>
 #include <unordered_set>
+#include <utility>
 
 namespace ctdb {
 
@@ -24,12 +28,21 @@ template <typename... Ts> inline constexpr bool is_sorted_container<std::set<Ts.
 
 template <typename... Ts> inline constexpr bool is_container<std::unordered_set<Ts...>> = true;
 
+template <typename View, typename PKey> class bitmap_storage;
+template <typename View, typename PKey> inline constexpr bool is_container<bitmap_storage<View, PKey>> = true;
+
+template <typename GroupView, typename PKey, typename... Aggregators> class aggregate_storage;
+template <typename GroupView, typename PKey, typename... Aggregators> inline constexpr bool is_container<aggregate_storage<GroupView, PKey, Aggregators...>> = true;
+
+template <typename PKey> class scan_chunk_storage;
+template <typename PKey> inline constexpr bool is_container<scan_chunk_storage<PKey>> = true;
+
 // provide default implementations of addition/find/removal
 template <typename IndexTraits, typename PKey> struct index_helper {
 	using primary_key = PKey;
 	using entry = typename IndexTraits::template entry<primary_key>;
 	using storage_type = typename IndexTraits::template storage_type<primary_key>;
-	using iterator_type = typename storage_type::iterator;
+	using iterator_type = typename storage_type::const_iterator;
 
 	static_assert(is_container<storage_type>);
 
@@ -62,6 +75,13 @@ template <typename IndexTraits, typename PKey> struct index_helper {
 		return storage.upper_bound(value);
 	}
 
+	// works also for unsorted (hashed) storage
+	template <typename T> [[nodiscard]] static constexpr auto equal_range(const storage_type & storage, const T & value) noexcept -> std::pair<iterator_type, iterator_type>
+	requires(compatible_type<T>)
+	{
+		return storage.equal_range(value);
+	}
+
 	[[nodiscard]] static constexpr auto begin(const storage_type & storage) noexcept -> iterator_type {
 		return storage.begin();
 	}
@@ -0,0 +1,466 @@
+#ifndef CTDB_VERSIONED_TABLE_HPP
+#define CTDB_VERSIONED_TABLE_HPP
+
+#include "support/epoch.hpp"
+#include "support/persistent-tree.hpp"
+#include "table.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <concepts>
+
+namespace ctdb {
+
+// record of a versioned table, it never changes and it's shared by all versions which contain it
+template <typename Record> struct versioned_record {
+	uint64_t id;
+	uint64_t generation;
+	Record value;
+
+	template <typename... Args> constexpr versioned_record(uint64_t i, uint64_t g, Args &&... args): id{i}, generation{g}, value(std::forward<Args>(args)...) { }
+};
+
+// key of a record in a versioned table (it's valid while some snapshot or the writer can see the record)
+template <typename Record> struct versioned_key {
+	const versioned_record<Record> * node{nullptr};
+
+	constexpr auto operator*() const noexcept -> const Record & {
+		return node->value;
+	}
+
+	constexpr auto operator->() const noexcept -> const Record * {
+		return &node->value;
+	}
+
+	friend constexpr bool operator==(versioned_key, versioned_key) noexcept = default;
+};
+
+// indices of a versioned table are persistent trees ordered by their view (`unique` is ordered too)
+template <typename Index> struct versioned_index_traits {
+	using view = Index;
+	static constexpr bool unique = false;
+};
+
+template <typename View> struct versioned_index_traits<sorted<View>> {
+	using view = View;
+	static constexpr bool unique = false;
+};
+
+template <typename View> struct versioned_index_traits<unique<View>> {
+	using view = View;
+	static constexpr bool unique = true;
+};
+
+template <typename View> struct versioned_index_traits<unique_sorted<View>> {
+	using view = View;
+	static constexpr bool unique = true;
+};
+
+template <typename Record, typename Index> concept versioned_index = requires(const Record & record) {
+	{ static_cast<typename versioned_index_traits<Index>::view>(record) };
+} && std::totally_ordered<typename versioned_index_traits<Index>::view>;
+
+// records in order of their insertion
+struct versioned_insertion_order {
+	template <typename Record> constexpr bool operator()(versioned_key<Record> lhs, versioned_key<Record> rhs) const noexcept {
+		return lhs.node->id < rhs.node->id;
+	}
+};
+
+// same order as `sorted` (records with same view in order of insertion), unique index compares only the view
+template <typename Index> struct versioned_index_order {
+	using traits = versioned_index_traits<Index>;
+	using view = typename traits::view;
+
+	template <typename Record> constexpr bool operator()(versioned_key<Record> lhs, versioned_key<Record> rhs) const noexcept {
+		const auto & lhs_view = static_cast<view>(*lhs);
+		const auto & rhs_view = static_cast<view>(*rhs);
+
+		if constexpr (traits::unique) {
+			return lhs_view < rhs_view;
+		} else {
+			return std::tie(lhs_view, lhs.node->id) < std::tie(rhs_view, rhs.node->id);
+		}
+	}
+};
+
+// table with snapshot isolation (MVCC)
+// - records and all indices are persistent trees: a writer copies only the paths to changed nodes,
+//   all other nodes are shared with older versions, so each insertion or removal is O(log n) for each index
+// - readers take a snapshot of the current version without any lock (they only announce their epoch in their own slot)
+//   and they see it until the snapshot is dropped, even when writers publish newer versions
+// - all changes done by one `update` are published at once, nothing is published when nothing was changed
+// - nodes and records of old versions are released by later writers (epoch based reclamation),
+//   so snapshots should be short-lived (a long-lived one keeps everything what was retired after it was taken)
+// indices can be `sorted<View>`, `unique<View>` or `unique_sorted<View>` (all of them are ordered by the view)
+template <typename Record, typename... Indices> class versioned_table {
+	static_assert((versioned_index<Record, Indices> && ...), "versioned table supports only sorted and unique indices with totally ordered views");
+
+public:
+	using record_type = Record;
+	using key_type = versioned_key<Record>;
+	using tree_type = support::persistent_tree<key_type>;
+	using editor_type = support::persistent_editor<key_type>;
+
+	static constexpr size_t index_count = sizeof...(Indices);
+
+	// roots of trees of one version: records (in order of insertion) and each index (in order of `Indices`)
+	using trees_type = std::array<tree_type, index_count + 1z>;
+
+	struct version_data {
+		uint64_t number;
+		trees_type trees;
+	};
+
+private:
+	template <size_t I> using index_type = std::tuple_element_t<I, std::tuple<Indices...>>;
+	template <size_t I> using view_type = typename versioned_index_traits<index_type<I>>::view;
+
+	// first index which serves queries by `Type` (same as for `table`)
+	template <typename Type> static constexpr size_t index_for() noexcept {
+		constexpr bool compatible[] = {std::totally_ordered_with<Type, typename versioned_index_traits<Indices>::view>..., true};
+		constexpr size_t result = static_cast<size_t>(std::ranges::find(compatible, true) - std::begin(compatible));
+		static_assert(result != index_count, "type is not compatible with any index");
+
+		return result;
+	}
+
+public:
+	// queries over one version (shared by snapshots and the writer)
+	class view {
+	protected:
+		const trees_type * trees;
+
+		constexpr explicit view(const trees_type & t) noexcept: trees{&t} { }
+
+	public:
+		size_t size() const noexcept {
+			return (*trees)[0].size();
+		}
+
+		// every index contains all records
+		template <typename Type> size_t size() const noexcept {
+			return (*trees)[index_for<Type>() + 1z].size();
+		}
+
+		auto all() const {
+			const tree_type & tree = (*trees)[0];
+			return index_range{tree.begin(), tree.end()};
+		}
+
+		template <typename Type> auto all() const {
+			const tree_type & tree = (*trees)[index_for<Type>() + 1z];
+			return index_range{tree.begin(), tree.end()};
+		}
+
+		template <typename Type> auto equal(const Type & value) const {
+			using index_view = view_type<index_for<Type>()>;
+			const tree_type & tree = (*trees)[index_for<Type>() + 1z];
+
+			auto first = tree.lower_bound([&](key_type key) { return static_cast<index_view>(*key) < value; });
+			auto last = tree.lower_bound([&](key_type key) { return !(value < static_cast<index_view>(*key)); });
+
+			return index_range{std::move(first), std::move(last)};
+		}
+
+		// half-open range [from, to)
+		template <typename Type> auto range(const Type & from, const Type & to) const {
+			using index_view = view_type<index_for<Type>()>;
+			const tree_type & tree = (*trees)[index_for<Type>() + 1z];
+
+			auto first = tree.lower_bound([&](key_type key) { return static_cast<index_view>(*key) < from; });
+			auto last = tree.lower_bound([&](key_type key) { return static_cast<index_view>(*key) < to; });
+
+			return index_range{std::move(first), std::move(last)};
+		}
+	};
+
+	// consistent view of one version, it never changes (readers must not keep it for long, see above)
+	class snapshot_type: public view {
+		friend class versioned_table;
+
+		const versioned_table * owner;
+		size_t slot;
+		const version_data * data;
+
+		snapshot_type(const versioned_table & o, size_t s, const version_data * d) noexcept: view{d->trees}, owner{&o}, slot{s}, data{d} { }
+
+	public:
+		snapshot_type(snapshot_type && other) noexcept: view{*other.trees}, owner{std::exchange(other.owner, nullptr)}, slot{other.slot}, data{other.data} { }
+
+		snapshot_type & operator=(snapshot_type && other) noexcept {
+			if (this != &other) {
+				release();
+				this->trees = other.trees;
+				owner = std::exchange(other.owner, nullptr);
+				slot = other.slot;
+				data = other.data;
+			}
+
+			return *this;
+		}
+
+		snapshot_type(const snapshot_type &) = delete;
+		snapshot_type & operator=(const snapshot_type &) = delete;
+
+		~snapshot_type() noexcept {
+			release();
+		}
+
+		uint64_t version() const noexcept {
+			return data->number;
+		}
+
+		constexpr auto operator->() const noexcept -> const snapshot_type * {
+			return this;
+		}
+
+	private:
+		void release() noexcept {
+			if (owner != nullptr) {
+				owner->epochs.leave(slot);
+				owner = nullptr;
+			}
+		}
+	};
+
+	// private version of the writer, changed nodes are copied (or changed in place when they were created by the writer)
+	class writer: public view {
+		friend class versioned_table;
+
+		versioned_table & owner;
+		trees_type working;
+		editor_type editor;
+
+		std::vector<versioned_record<Record> *> created{};
+		// removed records which were created by the writer (nobody else has seen them)
+		std::vector<versioned_record<Record> *> dropped{};
+		// removed records of published versions
+		std::vector<const versioned_record<Record> *> removed{};
+
+		bool changed{false};
+
+		writer(versioned_table & o, const version_data & base, uint64_t generation): view{working}, owner{o}, working{base.trees}, editor{generation} { }
+
+		template <size_t... I> bool insert_into_indices(key_type key, std::index_sequence<I...>) {
+			return (working[I + 1z].insert(key, versioned_index_order<index_type<I>>{}, editor) && ...);
+		}
+
+		template <size_t... I> bool erase_from_indices(key_type key, std::index_sequence<I...>) {
+			return (working[I + 1z].erase(key, versioned_index_order<index_type<I>>{}, editor) && ...);
+		}
+
+		// unique indices refuse a record with a view which is already there
+		template <size_t... I> bool acceptable(key_type key, std::index_sequence<I...>) const {
+			return ((!versioned_index_traits<index_type<I>>::unique || !working[I + 1z].contains(key, versioned_index_order<index_type<I>>{})) && ...);
+		}
+
+		// release everything what was created and never published
+		void discard() noexcept {
+			for (tree_type & tree: working) {
+				tree_type::release_generation(tree.root, editor.generation);
+			}
+
+			for (const auto * record: created) {
+				delete record;
+			}
+		}
+
+	public:
+		writer(const writer &) = delete;
+		writer & operator=(const writer &) = delete;
+
+		// returns nullopt (and changes nothing) if any of the unique indices refused the record
+		template <typename... Args> auto emplace(Args &&... args) -> std::optional<key_type> {
+			created.reserve(created.size() + 1z);
+
+			auto record = std::make_unique<versioned_record<Record>>(owner.next_id, editor.generation, std::forward<Args>(args)...);
+			const key_type key{record.get()};
+
+			if (!acceptable(key, std::index_sequence_for<Indices...>{})) {
+				return std::nullopt;
+			}
+
+			// nothing can refuse the record now (if an allocation fails, whole update is discarded)
+			created.push_back(record.release());
+			++owner.next_id;
+
+			working[0].insert(key, versioned_insertion_order{}, editor);
+			[[maybe_unused]] const bool inserted = insert_into_indices(key, std::index_sequence_for<Indices...>{});
+			assert(inserted);
+
+			changed = true;
+			return key;
+		}
+
+		// returns false if the record isn't in the table (key must be valid, see `versioned_key`)
+		bool erase(key_type key) {
+			if (!working[0].erase(key, versioned_insertion_order{}, editor)) {
+				return false;
+			}
+
+			[[maybe_unused]] const bool erased = erase_from_indices(key, std::index_sequence_for<Indices...>{});
+			assert(erased);
+
+			if (key.node->generation == editor.generation) {
+				dropped.push_back(const_cast<versioned_record<Record> *>(key.node));
+			} else {
+				removed.push_back(key.node);
+			}
+
+			changed = true;
+			return true;
+		}
+	};
+
+private:
+	// nodes, records and version which can be released when no reader is in epoch `epoch` or older
+	struct retired {
+		uint64_t epoch;
+		const version_data * version;
+		std::vector<typename tree_type::node *> nodes;
+		std::vector<const versioned_record<Record> *> records;
+	};
+
+	mutable support::epoch_domain epochs{};
+	std::atomic<const version_data *> current{new version_data{0u, {}}};
+	std::atomic<uint64_t> published_version{0u};
+
+	// only one writer at a time, readers don't care
+	std::mutex writer_lock{};
+	uint64_t next_id{0u};
+	uint64_t next_generation{1u};
+	std::vector<retired> garbage{};
+
+	void publish(writer & w) {
+		const version_data * base = current.load(std::memory_order_relaxed);
+
+		garbage.reserve(garbage.size() + 1z);
+		const auto * next = new version_data{base->number + 1u, w.working};
+
+		current.store(next, std::memory_order_seq_cst);
+		garbage.push_back(retired{epochs.advance(), base, std::move(w.editor.replaced), std::move(w.removed)});
+		published_version.store(next->number, std::memory_order_release);
+
+		for (const auto * record: w.dropped) {
+			delete record;
+		}
+
+		collect();
+	}
+
+	// release everything what readers can't see anymore
+	void collect() noexcept {
+		const uint64_t oldest = epochs.oldest();
+
+		std::erase_if(garbage, [&](retired & r) {
+			if (r.epoch >= oldest) {
+				return false;
+			}
+
+			release(r);
+			return true;
+		});
+	}
+
+	static void release(retired & r) noexcept {
+		for (auto * n: r.nodes) {
+			delete n;
+		}
+
+		for (const auto * record: r.records) {
+			delete record;
+		}
+
+		delete r.version;
+	}
+
+public:
+	versioned_table() = default;
+
+	versioned_table(const versioned_table &) = delete;
+	versioned_table & operator=(const versioned_table &) = delete;
+
+	// no snapshot can outlive the table
+	~versioned_table() noexcept {
+		for (retired & r: garbage) {
+			release(r);
+		}
+
+		const version_data * last = current.load(std::memory_order_relaxed);
+
+		for (const key_type key: last->trees[0]) {
+			delete key.node;
+		}
+
+		for (const tree_type & tree: last->trees) {
+			tree_type::release(tree.root);
+		}
+
+		delete last;
+	}
+
+	// consistent view of the current version, taking it doesn't block anyone
+	auto snapshot() const noexcept -> snapshot_type {
+		const size_t slot = epochs.enter();
+		return snapshot_type{*this, slot, current.load(std::memory_order_seq_cst)};
+	}
+
+	// number of published versions
+	uint64_t version() const noexcept {
+		return published_version.load(std::memory_order_acquire);
+	}
+
+	size_t size() const noexcept {
+		return snapshot().size();
+	}
+
+	// all changes done by `fn(writer &)` are published together as a new version
+	// (if `fn` throws or changes nothing, nothing is published)
+	template <typename Fn> auto update(Fn && fn) -> std::invoke_result_t<Fn, writer &> {
+		std::lock_guard _{writer_lock};
+
+		writer w{*this, *current.load(std::memory_order_relaxed), next_generation++};
+
+		const auto finish = [&] {
+			if (w.changed) {
+				publish(w);
+			} else {
+				w.discard();
+			}
+		};
+
+		try {
+			if constexpr (std::is_void_v<std::invoke_result_t<Fn, writer &>>) {
+				std::forward<Fn>(fn)(w);
+				finish();
+			} else {
+				auto result = std::forward<Fn>(fn)(w);
+				finish();
+				return result;
+			}
+		} catch (...) {
+			w.discard();
+			throw;
+		}
+	}
+
+	// single record insertion, returns false if any of the indices refused it
+	template <typename... Args> bool emplace(Args &&... args) {
+		return update([&](writer & w) { return w.emplace(std::forward<Args>(args)...).has_value(); });
+	}
+};
+
+} // namespace ctdb
+
+#endif
@@ -0,0 +1,182 @@
+#include <ctdb/table.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+enum class region { north, south, east, west };
+
+struct sale {
+	std::string id;
+	region area;
+	long amount;
+
+	friend bool operator==(const sale &, const sale &) = default;
+
+	explicit operator std::string_view() const noexcept {
+		return id;
+	}
+
+	explicit operator region() const noexcept {
+		return area;
+	}
+
+	explicit operator long() const noexcept {
+		return amount;
+	}
+};
+
+using by_region = ctdb::aggregate<region, ctdb::aggregators::count, ctdb::aggregators::sum<long>, ctdb::aggregators::min<long>, ctdb::aggregators::max<long>>;
+
+// aggregators don't clash with algorithms of std
+constexpr bool unqualified_algorithms() {
+	using namespace std;
+	using namespace ctdb;
+	return max(1, 2) == 2 && min(1, 2) == 1;
+}
+
+static_assert(unqualified_algorithms());
+
+// aggregate index is first, so it has to be rolled back when the unique index refuses a record
+using sales = ctdb::table<sale, by_region, ctdb::unique<std::string_view>>;
+
+struct expected_values {
+	size_t count{0z};
+	long sum{0};
+	std::optional<long> min{};
+	std::optional<long> max{};
+};
+
+template <typename Range> auto compute(const Range & records, std::optional<region> area) {
+	expected_values result{};
+
+	for (const sale & s: records) {
+		if (area && s.area != *area) {
+			continue;
+		}
+
+		++result.count;
+		result.sum += s.amount;
+		result.min = std::min(result.min.value_or(s.amount), s.amount);
+		result.max = std::max(result.max.value_or(s.amount), s.amount);
+	}
+
+	return result;
+}
+
+void check(const sales & tbl) {
+	const auto & aggregates = tbl.aggregates<by_region>();
+
+	const auto same = [](const auto & values, const expected_values & expected) {
+		REQUIRE(values.size() == expected.count);
+		REQUIRE(values.template get<ctdb::aggregators::count>() == expected.count);
+		REQUIRE(values.template get<ctdb::aggregators::sum<long>>() == expected.sum);
+		REQUIRE(values.template get<ctdb::aggregators::min<long>>() == expected.min);
+		REQUIRE(values.template get<ctdb::aggregators::max<long>>() == expected.max);
+	};
+
+	for (const region area: {region::north, region::south, region::east, region::west}) {
+		same(aggregates.group(area), compute(tbl.all(), area));
+	}
+
+	same(aggregates.total(), compute(tbl.all(), std::nullopt));
+
+	REQUIRE(aggregates.size() == tbl.size());
+	REQUIRE(tbl.size<by_region>() == tbl.size());
+}
+
+} // namespace
+
+TEST_CASE("aggregate index") {
+	sales tbl;
+
+	static_assert(std::is_same_v<ctdb::index_storage_of<by_region, sales::primary_key>, ctdb::aggregate_storage<region, sales::primary_key, ctdb::aggregators::count, ctdb::aggregators::sum<long>, ctdb::aggregators::min<long>, ctdb::aggregators::max<long>>>);
+
+	// empty groups
+	const auto & aggregates = tbl.aggregates<by_region>();
+	REQUIRE(aggregates.group(region::north).empty());
+	REQUIRE(aggregates.total().get<ctdb::aggregators::max<long>>() == std::nullopt);
+	REQUIRE(aggregates.group_count() == 0z);
+
+	std::mt19937 rng{5u};
+	std::vector<sales::primary_key> inserted{};
+
+	for (int i = 0; i != 500; ++i) {
+		const auto key = tbl.emplace("sale " + std::to_string(i), static_cast<region>(rng() % 3u), static_cast<long>(rng() % 1000u) - 200);
+		REQUIRE(key);
+		inserted.push_back(*key);
+	}
+
+	check(tbl);
+	REQUIRE(aggregates.group_count() == 3z);
+	REQUIRE(aggregates.group(region::west).empty());
+
+	// refused record doesn't change anything
+	REQUIRE_FALSE(tbl.emplace("sale 1", region::west, 100'000));
+	REQUIRE(aggregates.group(region::west).empty());
+	REQUIRE(aggregates.group_count() == 3z);
+	check(tbl);
+
+	// removal of extremes
+	std::ranges::shuffle(inserted, rng);
+
+	for (size_t i = 0z; i != 300z; ++i) {
+		REQUIRE(tbl.erase(inserted[i]));
+	}
+
+	check(tbl);
+
+	// groups in order of their view
+	std::vector<region> areas{};
+
+	for (const auto & [area, values]: aggregates.groups()) {
+		REQUIRE(!values.empty());
+		areas.push_back(area);
+	}
+
+	REQUIRE(std::ranges::is_sorted(areas));
+
+	// bulk load and copy (indices are built again)
+	std::vector<sale> batch{};
+
+	for (int i = 500; i != 6000; ++i) {
+		batch.push_back(sale{"sale " + std::to_string(i), region::west, i});
+	}
+
+	tbl.emplace_batch(batch);
+	check(tbl);
+	REQUIRE(aggregates.group(region::west).get<ctdb::aggregators::max<long>>() == 5999);
+
+	const auto copy = tbl;
+	check(copy);
+
+	// last record of a group removes the group
+	while (!aggregates.group(region::north).empty()) {
+		const auto it = std::ranges::find(tbl.content, region::north, &sale::area);
+		REQUIRE(tbl.erase(it));
+	}
+
+	REQUIRE(aggregates.group_count() == 3z);
+	check(tbl);
+}
+
+TEST_CASE("memory usage of aggregate index") {
+	ctdb::instrumented_table<sale, ctdb::aggregate<region, ctdb::aggregators::count>, ctdb::aggregate<region, ctdb::aggregators::min<long>>> tbl;
+
+	for (int i = 0; i != 1000; ++i) {
+		tbl.emplace("sale " + std::to_string(i), static_cast<region>(i % 4), static_cast<long>(i % 10));
+	}
+
+	const auto usage = tbl.memory_usage();
+
+	// count is a number per group, min keeps distinct amounts of each group
+	REQUIRE(usage.indices[0].blocks == 4z);
+	REQUIRE(usage.indices[0].bytes < usage.indices[1].bytes);
+	REQUIRE(usage.indices[1].bytes < 1000z * sizeof(void *));
+}
@@ -0,0 +1,167 @@
+#include <ctdb/table.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <set>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+TEST_CASE("roaring bitmap") {
+	ctdb::support::roaring_bitmap bits;
+	std::set<uint64_t> expected;
+
+	std::mt19937_64 rng{7u};
+
+	// sparse values in many chunks and one dense chunk
+	for (int i = 0; i != 3000; ++i) {
+		const uint64_t value = rng() % (1u << 24u);
+		REQUIRE(bits.add(value) == expected.insert(value).second);
+	}
+
+	for (uint64_t i = 0u; i < 20000u; i += 3u) {
+		const uint64_t value = (uint64_t{1} << 40u) + i;
+		REQUIRE(bits.add(value) == expected.insert(value).second);
+	}
+
+	REQUIRE(bits.size() == expected.size());
+	REQUIRE(std::vector<uint64_t>(bits.begin(), bits.end()) == std::vector<uint64_t>(expected.begin(), expected.end()));
+	REQUIRE(bits.contains(uint64_t{1} << 40u));
+	REQUIRE_FALSE(bits.contains((uint64_t{1} << 40u) + 1u));
+	REQUIRE(*bits.find((uint64_t{1} << 40u) + 300u) == (uint64_t{1} << 40u) + 300u);
+	REQUIRE(bits.find(1u << 25u) == bits.end());
+
+	// dense chunk goes back to an array when most values are removed
+	for (uint64_t i = 0u; i < 18000u; i += 3u) {
+		REQUIRE(bits.remove((uint64_t{1} << 40u) + i));
+		expected.erase((uint64_t{1} << 40u) + i);
+	}
+
+	REQUIRE_FALSE(bits.remove(uint64_t{1} << 40u));
+	REQUIRE(std::vector<uint64_t>(bits.begin(), bits.end()) == std::vector<uint64_t>(expected.begin(), expected.end()));
+
+	// set operations against std::set
+	ctdb::support::roaring_bitmap other;
+	std::set<uint64_t> other_expected;
+
+	for (uint64_t i = 0u; i < 40000u; i += 2u) {
+		other.add((uint64_t{1} << 40u) + i);
+		other_expected.insert((uint64_t{1} << 40u) + i);
+	}
+
+	for (const uint64_t value: std::vector<uint64_t>(expected.begin(), expected.end())) {
+		if (value % 5u == 0u) {
+			other.add(value);
+			other_expected.insert(value);
+		}
+	}
+
+	std::vector<uint64_t> both{};
+	std::set_intersection(expected.begin(), expected.end(), other_expected.begin(), other_expected.end(), std::back_inserter(both));
+
+	std::vector<uint64_t> any{};
+	std::set_union(expected.begin(), expected.end(), other_expected.begin(), other_expected.end(), std::back_inserter(any));
+
+	const auto intersection = bits & other;
+	REQUIRE(intersection.size() == both.size());
+	REQUIRE(std::vector<uint64_t>(intersection.begin(), intersection.end()) == both);
+
+	const auto union_ = bits | other;
+	REQUIRE(union_.size() == any.size());
+	REQUIRE(std::vector<uint64_t>(union_.begin(), union_.end()) == any);
+
+	REQUIRE((other & other) == other);
+	REQUIRE((bits | ctdb::support::roaring_bitmap{}) == bits);
+	REQUIRE((bits & ctdb::support::roaring_bitmap{}).empty());
+}
+
+namespace {
+
+enum class state { active, suspended, closed };
+
+struct ticket {
+	std::string name;
+	state status;
+	bool urgent;
+
+	constexpr friend bool operator==(const ticket &, const ticket &) noexcept = default;
+
+	explicit constexpr operator std::string_view() const noexcept {
+		return name;
+	}
+
+	explicit constexpr operator state() const noexcept {
+		return status;
+	}
+
+	explicit constexpr operator bool() const noexcept {
+		return urgent;
+	}
+};
+
+} // namespace
+
+TEST_CASE("bitmap index") {
+	using tickets = ctdb::table<ticket, ctdb::unique<std::string_view>, ctdb::bitmap<state>, ctdb::bitmap<bool>>;
+
+	static_assert(std::is_same_v<ctdb::index_storage_of<ctdb::bitmap<state>, tickets::primary_key>, ctdb::bitmap_storage<state, tickets::primary_key>>);
+
+	tickets tbl;
+
+	for (int i = 0; i != 300; ++i) {
+		const auto status = static_cast<state>(i % 3);
+		REQUIRE(tbl.emplace("ticket " + std::to_string(i), status, i % 10 == 0));
+	}
+
+	REQUIRE(tbl.size<state>() == 300z);
+	REQUIRE(tbl.equal(state::active).size() == 100z);
+	REQUIRE(tbl.equal(state::closed).size() == 100z);
+	REQUIRE(tbl.equal(true).size() == 30z);
+
+	for (const ticket & t: tbl.equal(state::suspended)) {
+		REQUIRE(t.status == state::suspended);
+	}
+
+	// combination of bitmaps
+	const auto urgent_active = tbl.equal_all(state::active, true);
+	REQUIRE(urgent_active.size() == 10z);
+
+	for (const ticket & t: urgent_active) {
+		REQUIRE(t.status == state::active);
+		REQUIRE(t.urgent);
+	}
+
+	REQUIRE(tbl.equal_any(state::closed, true).size() == 100z + 20z);
+
+	// removal keeps all bitmaps in sync
+	const auto rng = tbl.equal(std::string_view{"ticket 0"});
+	REQUIRE(tbl.erase(*rng.first));
+
+	REQUIRE(tbl.equal(state::active).size() == 99z);
+	REQUIRE(tbl.equal_all(state::active, true).size() == 9z);
+	REQUIRE(tbl.size<bool>() == 299z);
+
+	// refused record is removed from bitmaps too
+	REQUIRE_FALSE(tbl.emplace("ticket 1", state::closed, true));
+	REQUIRE(tbl.equal(state::closed).size() == 100z);
+
+	// bulk load and rebuild
+	std::vector<ticket> batch{};
+
+	for (int i = 300; i != 5300; ++i) {
+		batch.push_back(ticket{"ticket " + std::to_string(i), state::closed, false});
+	}
+
+	tbl.emplace_batch(batch);
+	REQUIRE(tbl.equal(state::closed).size() == 5100z);
+
+	auto copy = tbl;
+	REQUIRE(copy.equal(state::closed).size() == 5100z);
+	REQUIRE(copy.equal_all(state::closed, false).size() == 5090z);
+
+	const auto & storage = tbl.indices.index_for<state>();
+	REQUIRE(storage.group_count() == 3z);
+	REQUIRE(storage.footprint().bytes < 5399z * 16z);
+}
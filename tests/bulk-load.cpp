@@ -0,0 +1,162 @@
+#include <ctdb/table.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+struct item {
+	std::string name;
+	unsigned group;
+	unsigned serial;
+
+	friend bool operator==(const item &, const item &) = default;
+
+	explicit operator std::string_view() const noexcept {
+		return name;
+	}
+
+	explicit operator unsigned() const noexcept {
+		return group;
+	}
+};
+
+struct by_serial {
+	unsigned value;
+
+	explicit constexpr by_serial(const item & in) noexcept: value{in.serial} { }
+	explicit constexpr by_serial(unsigned in) noexcept: value{in} { }
+
+	friend constexpr auto operator<=>(by_serial, by_serial) noexcept = default;
+};
+
+struct by_length {
+	size_t value;
+
+	explicit constexpr by_length(const item & in) noexcept: value{in.name.size()} { }
+	explicit constexpr by_length(size_t in) noexcept: value{in} { }
+
+	friend constexpr auto operator<=>(by_length, by_length) noexcept = default;
+};
+
+using items = ctdb::table<item, ctdb::unique<std::string_view>, ctdb::sorted<unsigned>, ctdb::unique_sorted<by_serial>, ctdb::sorted<by_length>>;
+
+auto generate(size_t count, unsigned seed) {
+	std::mt19937 rng{seed};
+	std::vector<item> result{};
+
+	for (size_t i = 0z; i != count; ++i) {
+		result.push_back(item{"item" + std::to_string(i), static_cast<unsigned>(rng() % 64u), static_cast<unsigned>(i)});
+	}
+
+	std::ranges::shuffle(result, rng);
+
+	return result;
+}
+
+template <typename Table> auto names_by_serial(const Table & tbl) {
+	std::vector<std::string> result{};
+
+	for (const item & i: tbl.template all<by_serial>()) {
+		result.push_back(i.name);
+	}
+
+	return result;
+}
+
+} // namespace
+
+TEST_CASE("bulk load (all records accepted)") {
+	const auto input = generate(20000z, 1u);
+
+	items bulk;
+	items one_by_one;
+
+	const auto result = bulk.emplace_batch(input);
+
+	for (const item & i: input) {
+		one_by_one.emplace(i);
+	}
+
+	REQUIRE(result.size() == input.size());
+	REQUIRE(std::ranges::all_of(result, [](const auto & opt) { return opt.has_value(); }));
+
+	REQUIRE(bulk.size() == one_by_one.size());
+	REQUIRE(bulk.size<std::string_view>() == input.size());
+	REQUIRE(bulk.size<unsigned>() == input.size());
+	REQUIRE(bulk.size<by_serial>() == input.size());
+	REQUIRE(bulk.size<by_length>() == input.size());
+
+	REQUIRE(names_by_serial(bulk) == names_by_serial(one_by_one));
+	REQUIRE(bulk.equal(7u).size() == one_by_one.equal(7u).size());
+	REQUIRE(bulk.equal(std::string_view{"item42"}).size() == 1z);
+
+	// second batch goes into already filled indices
+	std::vector<item> more{};
+
+	for (unsigned i = 0u; i != 5000u; ++i) {
+		more.push_back(item{"more" + std::to_string(i), i % 64u, 100000u + i});
+	}
+
+	REQUIRE(std::ranges::all_of(bulk.emplace_batch(more), [](const auto & opt) { return opt.has_value(); }));
+	REQUIRE(bulk.size<by_serial>() == 25000z);
+}
+
+TEST_CASE("bulk load (refused records)") {
+	auto input = generate(10000z, 2u);
+
+	// duplicate name (refused by first index) and duplicate serial (refused by third one)
+	input.insert(input.begin() + 5000, item{"item10", 1u, 900000u});
+	input.insert(input.begin() + 7000, item{"unique name", 1u, 77u});
+	input.push_back(item{"item10", 2u, 900001u});
+
+	items bulk;
+	items one_by_one;
+
+	const auto result = bulk.emplace_batch(input);
+
+	std::vector<bool> expected{};
+
+	for (const item & i: input) {
+		expected.push_back(one_by_one.emplace(i).has_value());
+	}
+
+	REQUIRE(result.size() == expected.size());
+
+	for (size_t i = 0z; i != result.size(); ++i) {
+		REQUIRE(result[i].has_value() == expected[i]);
+	}
+
+	REQUIRE(bulk.size() == one_by_one.size());
+	REQUIRE(bulk.size() == 10000z);
+
+	// all indices contain only accepted records
+	REQUIRE(bulk.size<std::string_view>() == 10000z);
+	REQUIRE(bulk.size<unsigned>() == 10000z);
+	REQUIRE(bulk.size<by_serial>() == 10000z);
+	REQUIRE(bulk.size<by_length>() == 10000z);
+	REQUIRE(bulk.equal(std::string_view{"unique name"}).size() == 0z);
+	REQUIRE(names_by_serial(bulk) == names_by_serial(one_by_one));
+}
+
+TEST_CASE("parallel rebuild of indices") {
+	const auto input = generate(30000z, 3u);
+
+	items tbl;
+	tbl.emplace_batch(input);
+
+	const auto before = names_by_serial(tbl);
+
+	ctdb::support::work_stealing_pool pool{2z};
+	tbl.rebuild_indices(&pool);
+
+	REQUIRE(tbl.size<by_length>() == input.size());
+	REQUIRE(names_by_serial(tbl) == before);
+
+	// copy is rebuilt the same way
+	const items copy = tbl;
+	REQUIRE(names_by_serial(copy) == before);
+	REQUIRE(copy.equal(by_serial{123u}).size() == 1z);
+}
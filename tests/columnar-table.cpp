@@ -0,0 +1,149 @@
+#include <ctdb/columnar-table.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <functional>
+#include <optional>
+#include <random>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+struct order {
+	uint32_t id;
+	int32_t quantity;
+	float weight;
+	double price;
+	std::string customer;
+	int64_t created;
+
+	constexpr friend bool operator==(const order &, const order &) noexcept = default;
+};
+
+struct point {
+	int x;
+	int y;
+};
+
+// every slot (erased or not) where the predicate is true for the record
+template <typename Pred> auto expected_slots(const std::vector<std::optional<order>> & model, Pred pred) {
+	std::vector<size_t> result{};
+
+	for (size_t slot = 0z; slot != model.size(); ++slot) {
+		if (model[slot] && pred(*model[slot])) {
+			result.push_back(slot);
+		}
+	}
+
+	return result;
+}
+
+auto slots_of(const ctdb::slot_selection & selection) {
+	return std::vector<size_t>(selection.begin(), selection.end());
+}
+
+} // namespace
+
+TEST_CASE("fields of aggregates") {
+	static_assert(ctdb::support::field_count<point> == 2z);
+	static_assert(ctdb::support::field_count<order> == 6z);
+	static_assert(std::is_same_v<ctdb::support::field_types<order>, std::tuple<uint32_t, int32_t, float, double, std::string, int64_t>>);
+	static_assert(!ctdb::support::decomposable_aggregate<std::string>);
+
+	point p{1, 2};
+	std::get<1>(ctdb::support::tie_fields(p)) = 42;
+	REQUIRE(p.y == 42);
+}
+
+TEST_CASE("columnar table") {
+	ctdb::columnar_table<order> tbl;
+	std::vector<std::optional<order>> model{};
+
+	std::mt19937 rng{11u};
+
+	for (uint32_t i = 0u; i != 1000u; ++i) {
+		const auto quantity = static_cast<int32_t>(rng() % 200u) - 100;
+		const auto weight = static_cast<float>(rng() % 1000u) / 10.0f;
+		const auto price = static_cast<double>(rng() % 10000u) / 100.0;
+
+		const auto slot = tbl.emplace(i, quantity, weight, price, "customer " + std::to_string(i % 17u), static_cast<int64_t>(i) * 1000);
+		REQUIRE(slot == model.size());
+		model.push_back(tbl.get(slot));
+	}
+
+	REQUIRE(tbl.size() == 1000z);
+	REQUIRE(tbl.get(10z) == *model[10z]);
+	REQUIRE(tbl.column<4>()[3z] == "customer 3");
+
+	// erased slots are not part of any scan and they are reused
+	for (size_t slot = 0z; slot < model.size(); slot += 7z) {
+		REQUIRE(tbl.erase(slot));
+		model[slot].reset();
+	}
+
+	REQUIRE_FALSE(tbl.erase(0z));
+	REQUIRE_FALSE(tbl.contains(7z));
+	REQUIRE(tbl.size() == 857z);
+	REQUIRE(tbl.column<4>()[7z].empty());
+
+	const auto reused = tbl.insert(order{5000u, 50, 1.5f, 2.5, "late", 0});
+	REQUIRE(reused % 7z == 0z);
+	model[reused] = tbl.get(reused);
+	REQUIRE(tbl.slot_count() == 1000z);
+
+	REQUIRE(slots_of(tbl.all()) == expected_slots(model, [](const order &) { return true; }));
+
+	// vectorized comparisons
+	REQUIRE(slots_of(tbl.where<1>(std::less<>{}, int32_t{0})) == expected_slots(model, [](const order & o) { return o.quantity < 0; }));
+	REQUIRE(slots_of(tbl.where<1>(std::less_equal<>{}, int32_t{0})) == expected_slots(model, [](const order & o) { return o.quantity <= 0; }));
+	REQUIRE(slots_of(tbl.where<1>(std::equal_to<>{}, int32_t{50})) == expected_slots(model, [](const order & o) { return o.quantity == 50; }));
+	REQUIRE(slots_of(tbl.where<1>(std::not_equal_to<>{}, int32_t{50})) == expected_slots(model, [](const order & o) { return o.quantity != 50; }));
+	REQUIRE(slots_of(tbl.where<1>(std::greater<>{}, int32_t{-50})) == expected_slots(model, [](const order & o) { return o.quantity > -50; }));
+	REQUIRE(slots_of(tbl.where<1>(std::greater_equal<>{}, int32_t{-50})) == expected_slots(model, [](const order & o) { return o.quantity >= -50; }));
+	REQUIRE(slots_of(tbl.where<0>(std::greater_equal<>{}, uint32_t{900u})) == expected_slots(model, [](const order & o) { return o.id >= 900u; }));
+	REQUIRE(slots_of(tbl.where<2>(std::less<>{}, 10.0f)) == expected_slots(model, [](const order & o) { return o.weight < 10.0f; }));
+	REQUIRE(slots_of(tbl.where<3>(std::greater<>{}, 90.0)) == expected_slots(model, [](const order & o) { return o.price > 90.0; }));
+
+	// scalar fallback (different type of the value, other fields and predicates)
+	REQUIRE(slots_of(tbl.where<1>(std::less<>{}, 0.5)) == expected_slots(model, [](const order & o) { return o.quantity < 0.5; }));
+	REQUIRE(slots_of(tbl.where<5>(std::less<>{}, int64_t{100'000})) == expected_slots(model, [](const order & o) { return o.created < 100'000; }));
+	REQUIRE(slots_of(tbl.where<4>([](const std::string & c) { return c == "customer 3"; })) == expected_slots(model, [](const order & o) { return o.customer == "customer 3"; }));
+
+	// combination of scans
+	const auto cheap = tbl.where<3>(std::less<>{}, 20.0);
+	const auto many = tbl.where<1>(std::greater<>{}, int32_t{50});
+
+	REQUIRE(slots_of(cheap & many) == expected_slots(model, [](const order & o) { return o.price < 20.0 && o.quantity > 50; }));
+	REQUIRE(slots_of(cheap | many) == expected_slots(model, [](const order & o) { return o.price < 20.0 || o.quantity > 50; }));
+	REQUIRE((cheap & many).size() == slots_of(cheap & many).size());
+	REQUIRE((cheap | many).size() == slots_of(cheap | many).size());
+
+	// projection and aggregation
+	const auto projected = tbl.project<0, 3>(cheap & many);
+	REQUIRE(projected.size() == (cheap & many).size());
+
+	for (const auto & [id, price]: projected) {
+		REQUIRE(price < 20.0);
+	}
+
+	int64_t quantity = 0;
+	double price = 0.0;
+
+	for (const auto & o: model) {
+		if (o) {
+			quantity += o->quantity;
+			price += o->price;
+		}
+	}
+
+	REQUIRE(tbl.sum<1>(tbl.all()) == quantity);
+	REQUIRE(tbl.sum<3>(tbl.all()) == price);
+	REQUIRE(tbl.sum<1>(ctdb::slot_selection{}) == 0);
+
+	// copy is independent
+	auto copy = tbl;
+	copy.erase(reused);
+	REQUIRE(tbl.contains(reused));
+	REQUIRE(copy.size() + 1z == tbl.size());
+}
@@ -0,0 +1,208 @@
+#include <ctdb/concurrent-table.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <memory>
+#include <ranges>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct account {
+	std::string name;
+	std::string email;
+	unsigned balance;
+
+	explicit operator std::string_view() const noexcept {
+		return name;
+	}
+
+	explicit operator unsigned() const noexcept {
+		return balance;
+	}
+};
+
+struct by_email {
+	std::string_view value;
+
+	explicit constexpr by_email(const account & in) noexcept: value{in.email} { }
+	explicit constexpr by_email(std::string_view in) noexcept: value{in} { }
+
+	friend constexpr bool operator==(by_email, by_email) noexcept = default;
+
+	struct hash_type {
+		size_t operator()(by_email in) const noexcept {
+			return std::hash<std::string_view>{}(in.value);
+		}
+	};
+};
+
+using accounts = ctdb::concurrent_table<account, ctdb::unique<std::string_view>, ctdb::unique<by_email>, ctdb::sorted<unsigned>>;
+
+} // namespace
+
+TEST_CASE("concurrent table") {
+	accounts tbl;
+
+	const auto hana = tbl.emplace("hana", "hana@example.com", 10u);
+	REQUIRE(hana);
+	REQUIRE(tbl.emplace("jan", "jan@example.com", 10u));
+
+	// refused by first and second unique index
+	REQUIRE_FALSE(tbl.emplace("hana", "other@example.com", 1u));
+	REQUIRE_FALSE(tbl.emplace("eva", "jan@example.com", 1u));
+
+	REQUIRE(tbl.size() == 2z);
+	REQUIRE(tbl.size<std::string_view>() == 2z);
+	REQUIRE(tbl.size<by_email>() == 2z);
+	REQUIRE(tbl.size<unsigned>() == 2z);
+
+	// nothing is left from refused records
+	REQUIRE(tbl.equal(by_email{"other@example.com"}).empty());
+	REQUIRE(tbl.equal(std::string_view{"eva"}).empty());
+	REQUIRE(tbl.equal(10u).size() == 2z);
+
+	const auto found = tbl.equal(std::string_view{"hana"});
+	REQUIRE(found.size() == 1z);
+	REQUIRE((*found.begin()).email == "hana@example.com");
+
+	REQUIRE(tbl.erase(*hana));
+	REQUIRE(tbl.size() == 1z);
+
+	// already erased record is not erased twice
+	REQUIRE_FALSE(tbl.erase(*hana));
+	REQUIRE(tbl.size() == 1z);
+	REQUIRE(tbl.size<std::string_view>() == 1z);
+	REQUIRE(tbl.equal(std::string_view{"hana"}).empty());
+	REQUIRE(tbl.emplace("hana", "hana@example.com", 11u));
+}
+
+TEST_CASE("concurrent table (reused slot)") {
+	accounts tbl;
+
+	std::vector<accounts::primary_key> keys{};
+
+	// whole block of slots of this thread is used
+	for (unsigned i = 0u; i != 1024u; ++i) {
+		const auto key = tbl.emplace("k" + std::to_string(i), "k" + std::to_string(i) + "@example.com", i);
+		REQUIRE(key);
+		keys.push_back(*key);
+	}
+
+	REQUIRE(tbl.erase(keys.front()));
+
+	// next record takes the erased slot
+	const auto reused = tbl.emplace("new", "new@example.com", 0u);
+	REQUIRE(reused);
+	REQUIRE(reused->record == keys.front().record);
+
+	// stale key doesn't erase the new record
+	REQUIRE_FALSE(tbl.erase(keys.front()));
+	REQUIRE(tbl.size() == 1024z);
+	REQUIRE(tbl.equal(std::string_view{"new"}).size() == 1z);
+
+	REQUIRE(tbl.erase(*reused));
+	REQUIRE(tbl.equal(std::string_view{"new"}).empty());
+}
+
+TEST_CASE("concurrent table (many writers)") {
+	accounts tbl;
+
+	constexpr unsigned threads = 8u;
+	constexpr unsigned count = 5000u;
+
+	std::atomic<unsigned> inserted{0u};
+
+	{
+		std::vector<std::jthread> writers{};
+
+		for (unsigned t = 0u; t != threads; ++t) {
+			writers.emplace_back([&, t] {
+				for (unsigned i = 0u; i != count; ++i) {
+					// every name is tried by two threads, every email by two other ones
+					const auto name = "user" + std::to_string((t / 2u) * count + i);
+					const auto email = "mail" + std::to_string((((t + 1u) % threads) / 2u) * count + i);
+
+					if (tbl.emplace(name, email, i)) {
+						++inserted;
+					}
+
+					// some records are removed again
+					if (i % 7u == 0u) {
+						const auto own = tbl.equal(std::string_view{name});
+
+						if (!own.empty() && (*own.begin()).email == email) {
+							tbl.erase(own.keys.front());
+							--inserted;
+						}
+					}
+				}
+			});
+		}
+	}
+
+	REQUIRE(tbl.size() == inserted.load());
+	REQUIRE(tbl.size<std::string_view>() == tbl.size());
+	REQUIRE(tbl.size<by_email>() == tbl.size());
+	REQUIRE(tbl.size<unsigned>() == tbl.size());
+
+	// each record is findable through all of its indices
+	for (unsigned i = 0u; i < count; i += 13u) {
+		for (const account & a: tbl.equal(i)) {
+			REQUIRE(tbl.equal(std::string_view{a.name}).size() == 1z);
+			REQUIRE(tbl.equal(by_email{a.email}).size() == 1z);
+		}
+	}
+}
+
+TEST_CASE("slot storages used alternately by one thread") {
+	ctdb::support::slot_storage<int> first;
+	ctdb::support::slot_storage<int> second;
+
+	std::vector<int *> records{};
+
+	for (int i = 0; i != 10'000; ++i) {
+		records.push_back(first.emplace(i));
+		records.push_back(second.emplace(i));
+	}
+
+	REQUIRE(first.size() == 10'000z);
+	REQUIRE(second.size() == 10'000z);
+
+	// each storage has only blocks it needs (cached slots are not dropped when the thread switches)
+	REQUIRE(first.capacity() <= 10z * 1024z);
+	REQUIRE(second.capacity() <= 10z * 1024z);
+
+	for (size_t i = 0z; i != records.size(); i += 2z) {
+		REQUIRE(*records[i] == *records[i + 1z]);
+	}
+
+	// more storages than the thread can cache at once return their slots when they are evicted
+	std::vector<std::unique_ptr<ctdb::support::slot_storage<int>>> many{};
+
+	for (int i = 0; i != 8; ++i) {
+		many.push_back(std::make_unique<ctdb::support::slot_storage<int>>());
+	}
+
+	for (int round = 0; round != 100; ++round) {
+		for (auto & storage: many) {
+			storage->emplace(round);
+		}
+	}
+
+	for (auto & storage: many) {
+		REQUIRE(storage->size() == 100z);
+		REQUIRE(storage->capacity() <= 1024z);
+	}
+
+	// storage destroyed while its slots are cached by the thread
+	many.front().reset();
+
+	for (auto & storage: many | std::views::drop(1)) {
+		storage->emplace(0);
+	}
+
+	REQUIRE(first.emplace(1) != nullptr);
+}
@@ -0,0 +1,57 @@
+#include <ctdb/indices/full-text.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std::string_view_literals;
+
+TEST_CASE("pack_ngram keeps ordering") {
+	using namespace ctdb::support;
+
+	const auto a = ngram<4>{"char"};
+	const auto b = ngram<4>{"chas"};
+	const auto c = ngram<4>{"\xC5\xA1" "ar"}; // non-ascii
+
+	REQUIRE(unpack_ngram<4>(pack_ngram(a)) == a);
+	REQUIRE(unpack_ngram<4>(pack_ngram(c)) == c);
+
+	REQUIRE((pack_ngram(a) < pack_ngram(b)) == (a < b));
+	REQUIRE((pack_ngram(a) < pack_ngram(c)) == (a < c));
+	REQUIRE((pack_ngram(c) < pack_ngram(b)) == (c < b));
+}
+
+template <size_t N> void compare_batch_with_emplace() {
+	const auto input = std::vector<std::string>{"xxcharlotte", "pokus", "hana is owner of charlotte the dog", "some charlatan", "charchar", "-charchar", "šarlota is charlotte", "abc"};
+
+	std::vector<std::string> strings{input};
+
+	using index_type = ctdb::simple_fulltext_reverse_index<std::vector<std::string>::iterator, N>;
+
+	index_type one_by_one;
+	index_type batched;
+
+	std::vector<std::pair<std::string_view, std::vector<std::string>::iterator>> documents;
+
+	for (auto it = strings.begin(); it != strings.end(); ++it) {
+		one_by_one.emplace(std::string_view{*it}, it);
+		documents.emplace_back(*it, it);
+	}
+
+	batched.emplace_batch(documents);
+
+	REQUIRE(batched.ngram_known() == one_by_one.ngram_known());
+	REQUIRE(batched.ngram_count() == one_by_one.ngram_count());
+	REQUIRE(batched.data == one_by_one.data);
+
+	REQUIRE(batched.find_all("char"sv) == one_by_one.find_all("char"sv));
+	REQUIRE(batched.find_all("charlotte"sv).size() == 3z);
+}
+
+TEST_CASE("simple fulltext (batch insert)") {
+	compare_batch_with_emplace<2>();
+	compare_batch_with_emplace<3>();
+	compare_batch_with_emplace<4>();
+	compare_batch_with_emplace<8>();
+	compare_batch_with_emplace<9>();
+}
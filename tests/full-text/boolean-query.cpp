@@ -0,0 +1,87 @@
+#include <ctdb/indices/full-text.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std::string_view_literals;
+using ctdb::support::text_query;
+
+TEST_CASE("simple fulltext (boolean queries)") {
+	std::vector<std::string> strings{"xxcharlotte", "pokus", "hana is owner of charlotte the dog", "some charlatan", "charchar", "charcoal", "charlotte is the best dog", "šarlota is charlotte", "data and lore are androids"};
+
+	using iterator = std::vector<std::string>::iterator;
+	ctdb::simple_fulltext_reverse_index<iterator, 3> index;
+
+	for (auto it = strings.begin(); it != strings.end(); ++it) {
+		index.emplace(std::string_view{*it}, it);
+	}
+
+	auto search = [&](const text_query & query) {
+		std::vector<std::string> result;
+
+		for (auto it: index.find_documents(query)) {
+			result.emplace_back(*it);
+		}
+
+		std::sort(result.begin(), result.end());
+		return result;
+	};
+
+	using list = std::vector<std::string>;
+
+	REQUIRE(search(text_query::substring("dog")) == list{"charlotte is the best dog", "hana is owner of charlotte the dog"});
+
+	REQUIRE(search(text_query::all_of({text_query::substring("charlotte"), text_query::substring("dog"), text_query::substring("hana")})) == list{"hana is owner of charlotte the dog"});
+
+	REQUIRE(search(text_query::any_of({text_query::substring("pokus"), text_query::substring("charcoal")})) == list{"charcoal", "pokus"});
+
+	REQUIRE(search(text_query::all_of({text_query::substring("charlotte"), text_query::none_of({text_query::substring("dog")})})) == list{"xxcharlotte", "šarlota is charlotte"});
+
+	REQUIRE(search(text_query::none_of({text_query::substring("char"), text_query::substring("dog")})) == list{"data and lore are androids", "pokus"});
+
+	// "dog" starts 14 characters after "charlotte" in first record and 22 in second
+	REQUIRE(search(text_query::near("charlotte", "dog", 14)) == list{"hana is owner of charlotte the dog"});
+	REQUIRE(search(text_query::near("charlotte", "dog", 22)) == list{"charlotte is the best dog", "hana is owner of charlotte the dog"});
+	REQUIRE(search(text_query::near("charlotte", "dog", 13)) == list{});
+	REQUIRE(search(text_query::near("hana", "charlotte", 17)) == list{"hana is owner of charlotte the dog"});
+	REQUIRE(search(text_query::near("charlotte", "hana", 16)) == list{});
+
+	// terms shorter than N can't be searched
+	REQUIRE(!index.find_candidates(text_query::substring("is")).has_value());
+	REQUIRE(index.find_candidates(text_query::all_of({text_query::substring("is"), text_query::substring("best")})) == std::vector<iterator>{strings.begin() + 6});
+
+	// negation of a superset must not remove real matches
+	const auto candidates = [&](const text_query & query) {
+		const auto result = index.find_candidate_documents(query);
+		REQUIRE(result);
+		return std::make_pair(std::vector<iterator>(result->documents.begin(), result->documents.end()), result->exact);
+	};
+
+	REQUIRE(candidates(text_query::substring("best")) == std::make_pair(std::vector<iterator>{strings.begin() + 6}, true));
+	REQUIRE(candidates(text_query::all_of({text_query::substring("is"), text_query::substring("best")})).second == false);
+	REQUIRE(candidates(text_query::all_of({text_query::substring("charlotte"), text_query::none_of({text_query::all_of({text_query::substring("charlotte"), text_query::substring("is")})})})).second == false);
+	REQUIRE(search(text_query::all_of({text_query::substring("charlotte"), text_query::none_of({text_query::all_of({text_query::substring("charlotte"), text_query::substring("is")})})})) == list{"charlotte is the best dog", "hana is owner of charlotte the dog", "xxcharlotte", "šarlota is charlotte"});
+	REQUIRE(search(text_query::all_of({text_query::substring("charlotte"), text_query::none_of({text_query::near("charlotte", "is", 3)})})) == list{"charlotte is the best dog", "hana is owner of charlotte the dog", "xxcharlotte", "šarlota is charlotte"});
+	REQUIRE(!index.find_candidate_documents(text_query::none_of({text_query::all_of({text_query::substring("char"), text_query::substring("is")})})));
+}
+
+TEST_CASE("simple fulltext (negation of short documents)") {
+	std::vector<std::string> strings{"abcd zz", "abcd xy", "hi"};
+
+	using iterator = std::vector<std::string>::iterator;
+	ctdb::simple_fulltext_reverse_index<iterator, 4> index;
+
+	for (auto it = strings.begin(); it != strings.end(); ++it) {
+		index.emplace(std::string_view{*it}, it);
+	}
+
+	// "xy" is too short, so the subtracted part is only a superset
+	const auto kept = index.find_documents(text_query::all_of({text_query::substring("abcd"), text_query::none_of({text_query::all_of({text_query::substring("abcd"), text_query::substring("xy")})})}));
+	REQUIRE(std::ranges::find(kept, strings.begin()) != kept.end());
+
+	// documents without any ngram are still documents
+	REQUIRE(index.find_documents(text_query::none_of({text_query::substring("abcd")})) == std::vector<iterator>{strings.begin() + 2});
+	REQUIRE(index.find_documents(text_query::everything()).size() == 3z);
+}
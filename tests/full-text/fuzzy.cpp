@@ -0,0 +1,59 @@
+#include <ctdb/indices/full-text.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+#include <vector>
+
+using namespace std::string_view_literals;
+
+TEST_CASE("bounded substring distance") {
+	using ctdb::support::bounded_substring_distance;
+
+	REQUIRE(bounded_substring_distance("charlotte", "charlotte", 0) == 0u);
+	REQUIRE(bounded_substring_distance("charlotte", "hana is owner of charlotte the dog", 0) == 0u);
+	REQUIRE(bounded_substring_distance("charlote", "hana is owner of charlotte the dog", 0) == std::nullopt);
+	REQUIRE(bounded_substring_distance("charlote", "hana is owner of charlotte the dog", 1) == 1u);
+	REQUIRE(bounded_substring_distance("sharlotte", "charlotte", 2) == 1u);
+	REQUIRE(bounded_substring_distance("chralotte", "charlotte", 1) == std::nullopt);
+	REQUIRE(bounded_substring_distance("chralotte", "charlotte", 2) == 2u);
+	REQUIRE(bounded_substring_distance("abc", "", 2) == std::nullopt);
+	REQUIRE(bounded_substring_distance("abc", "", 3) == 3u);
+	REQUIRE(bounded_substring_distance("", "whatever", 0) == 0u);
+	REQUIRE(bounded_substring_distance("kitten", "sitting", 3) == 2u);
+}
+
+TEST_CASE("simple fulltext (fuzzy search)") {
+	std::vector<std::string> strings{"xxcharlotte", "pokus", "hana is owner of charlotte the dog", "some charlatan", "charchar", "charcoal", "charlotte is the best dog", "šarlota is charlotte", "data and lore are androids"};
+
+	using iterator = std::vector<std::string>::iterator;
+	ctdb::simple_fulltext_reverse_index<iterator, 3> index;
+
+	for (auto it = strings.begin(); it != strings.end(); ++it) {
+		index.emplace(std::string_view{*it}, it);
+	}
+
+	auto search = [&](std::string_view query, unsigned edits) {
+		std::vector<std::pair<std::string, unsigned>> result;
+
+		for (const auto & m: index.find_fuzzy(query, edits)) {
+			result.emplace_back(*m.pkey, m.distance);
+		}
+
+		std::sort(result.begin(), result.end());
+		return result;
+	};
+
+	REQUIRE(search("charlotte", 0) == std::vector<std::pair<std::string, unsigned>>{{"charlotte is the best dog", 0}, {"hana is owner of charlotte the dog", 0}, {"xxcharlotte", 0}, {"šarlota is charlotte", 0}});
+	REQUIRE(search("charlote", 1) == std::vector<std::pair<std::string, unsigned>>{{"charlotte is the best dog", 1}, {"hana is owner of charlotte the dog", 1}, {"xxcharlotte", 1}, {"šarlota is charlotte", 1}});
+	REQUIRE(search("androdis are", 2) == std::vector<std::pair<std::string, unsigned>>{});
+	REQUIRE(search("are androdis", 2) == std::vector<std::pair<std::string, unsigned>>{{"data and lore are androids", 2}});
+
+	// threshold is too low for filtering => each document is verified
+	REQUIRE(search("pkus", 1) == std::vector<std::pair<std::string, unsigned>>{{"pokus", 1}});
+
+	// best matches are first
+	const auto result = index.find_fuzzy("charlatte", 2);
+	REQUIRE(!result.empty());
+	REQUIRE(result.front().distance == 1u);
+	REQUIRE(*result.back().pkey == "some charlatan");
+	REQUIRE(result.back().distance == 2u);
+}
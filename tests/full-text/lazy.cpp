@@ -0,0 +1,52 @@
+#include <ctdb/indices/full-text.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+#include <vector>
+
+using namespace std::string_view_literals;
+
+TEST_CASE("simple fulltext (lazy search)") {
+	std::set<std::string, std::less<void>> strings;
+
+	ctdb::simple_fulltext_reverse_index<decltype(strings)::iterator, 4> index;
+
+	for (std::string_view in: {"xxcharlotte"sv, "pokus"sv, "hana is owner of charlotte the dog"sv, "some charlatan"sv, "charchar"sv, "-charchar"sv, "charcoal"sv, "charlotte is the best dog"sv, "šarlota is charlotte"sv, "charlotte is the charlotte"sv}) {
+		auto [it, success] = strings.emplace(std::string{in});
+		REQUIRE(success);
+		index.emplace(in, it);
+	}
+
+	auto to_set = [](const auto & query) {
+		std::set<typename decltype(index)::entry> result;
+
+		for (auto it = query.begin(); it != query.end(); ++it) {
+			result.insert(*it);
+		}
+
+		return result;
+	};
+
+	for (auto query: {"char"sv, "charlotte"sv, "charchar"sv, "lotte is"sv, "is the"sv, "dog"sv, "nothing here"sv, "ar"sv}) {
+		const auto lazy = index.search(query);
+		const auto all = index.find_all(query);
+
+		REQUIRE(to_set(lazy) == all);
+		REQUIRE(lazy.count() == all.size());
+		REQUIRE(lazy.exists() == !all.empty());
+	}
+
+	REQUIRE(index.search("char"sv).count() == 12z);
+	REQUIRE(index.search("char"sv).limit(5).count() == 5z);
+	REQUIRE(index.search("char"sv).limit(20).count() == 12z);
+	REQUIRE(index.search("char"sv).limit(0).count() == 0z);
+	REQUIRE(!index.search("char"sv).limit(0).exists());
+
+	REQUIRE(index.search("charlotte"sv).count() == 6z);
+	REQUIRE(index.search("charlotte"sv).exists());
+	REQUIRE(!index.search("charlottes"sv).exists());
+
+	// match must be at the right place
+	for (const auto & e: index.search("the charlotte"sv)) {
+		REQUIRE(std::string_view{*e.pkey}.substr(e.position, 13z) == "the charlotte");
+	}
+}
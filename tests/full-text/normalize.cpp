@@ -0,0 +1,93 @@
+#include <ctdb/indices/full-text.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <list>
+#include <string>
+
+using namespace std::string_view_literals;
+
+TEST_CASE("ascii lowercase") {
+	const std::string input = "Hello WORLD, this Is A Long ASCII text @[`{ with SOME more LETTERS AZaz";
+	std::string output(input.size(), '\0');
+
+	REQUIRE(ctdb::support::ascii_lowercase_prefix(input, output.data()) == input.size());
+	REQUIRE(output == "hello world, this is a long ascii text @[`{ with some more letters azaz");
+
+	// stops at first non-ASCII character
+	const std::string mixed = "ABCDEFGHIJKLMNOPQRSTUVWXYZ Šarlota";
+	REQUIRE(ctdb::support::ascii_lowercase_prefix(mixed, output.data()) == 27z);
+	REQUIRE(output.substr(0, 27z) == "abcdefghijklmnopqrstuvwxyz ");
+}
+
+TEST_CASE("unicode folding") {
+	// same length of characters => no position map
+	const auto lower = ctdb::support::fold_case{}("ŠARLOTA Ÿ Ω Ж Ё"sv);
+	REQUIRE(lower.text == "šarlota ÿ ω ж ё");
+	REQUIRE(lower.identity());
+
+	const auto folded = ctdb::support::fold_case_and_diacritics{}("Šarlota ČEŠTINA"sv);
+	REQUIRE(folded.text == "sarlota cestina");
+	REQUIRE_FALSE(folded.identity());
+	REQUIRE(folded.origin.size() == folded.text.size() + 1z);
+
+	REQUIRE(folded.original_position(0u) == 0u);
+	REQUIRE(folded.original_position(1u) == 2u);
+	REQUIRE(folded.original_position(7u) == 8u);
+	REQUIRE(folded.original_position(8u) == 9u);
+	REQUIRE(folded.original_position(9u) == 11u);
+	REQUIRE(folded.original_position(10u) == 12u);
+	REQUIRE(folded.original_position(11u) == 14u);
+	REQUIRE(folded.original_position(static_cast<unsigned>(folded.text.size())) == 18u);
+
+	// letters without base letter are only lowercased, invalid UTF-8 is kept
+	REQUIRE(ctdb::support::fold_case_and_diacritics{}("ÆSS ß Œ"sv).text == "æss ß œ");
+	REQUIRE(ctdb::support::fold_case_and_diacritics{}("A\xFF\xC5Z"sv).text == "a\xFF\xC5z");
+
+	// chain maps positions through all stages
+	const auto chained = ctdb::support::normalizer_chain<ctdb::support::fold_case, ctdb::support::fold_case_and_diacritics>{}("xŠŠx"sv);
+	REQUIRE(chained.text == "xssx");
+	REQUIRE(chained.original_position(2u) == 3u);
+	REQUIRE(chained.original_position(3u) == 5u);
+}
+
+TEST_CASE("fulltext index with normalized records") {
+	std::list<std::string> strings;
+
+	using iterator = decltype(strings)::iterator;
+	using extractor = ctdb::normalizing_extractor<ctdb::support::fold_case_and_diacritics>;
+
+	ctdb::fulltext_index<iterator, extractor, 4> index;
+
+	const auto add = [&](std::string_view in) {
+		const auto it = strings.emplace(strings.end(), in);
+		index.emplace(it);
+		return it;
+	};
+
+	const auto a = add("Charlotte the dog");
+	const auto b = add("šarlota is charlotte");
+	const auto c = add("ŠARLOTA");
+	add("pokus");
+
+	// one normalized lookup instead of every case variant
+	REQUIRE(index.find_all("sarlota"sv).size() == 2z);
+	REQUIRE(index.find_all("ŠarLota"sv) == index.find_all("sarlota"sv));
+	REQUIRE(index.find_documents("CHARLOTTE"sv).size() == 2z);
+
+	// positions are in the original text
+	const auto found = index.find_all("charlotte"sv);
+	REQUIRE(found.contains(ctdb::fulltext_entry<iterator>{a, 0u}));
+	REQUIRE(found.contains(ctdb::fulltext_entry<iterator>{b, 12u}));
+	REQUIRE(std::string_view{*b}.substr(12u) == "charlotte");
+
+	REQUIRE(index.find_all("arlota"sv).contains(ctdb::fulltext_entry<iterator>{c, 2u}));
+
+	index.remove(b);
+	REQUIRE(index.find_all("sarlota"sv).size() == 1z);
+	REQUIRE(index.origins.size() == 1z);
+
+	// record's ngrams without index
+	const ctdb::basic_fulltext<extractor, 4> document{"Šárka"sv};
+	REQUIRE(document.text() == "sarka");
+	REQUIRE(document.ngrams().size() == 2z);
+	REQUIRE(document.original_position(2u) == 4u);
+}
@@ -0,0 +1,138 @@
+#include <ctdb/indices/full-text.hpp>
+#include <ctdb/indices/support/regex-query.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <regex>
+#include <string>
+#include <vector>
+
+using namespace ctdb::support;
+using namespace std::string_view_literals;
+
+TEST_CASE("regex to query") {
+	REQUIRE(regex_to_query<3>("charlotte") == text_query::substring("charlotte"));
+	REQUIRE(regex_to_query<3>("char.otte") == text_query::all_of({text_query::substring("char"), text_query::substring("otte")}));
+	REQUIRE(regex_to_query<3>("ch.r") == text_query::everything());
+	REQUIRE(regex_to_query<3>("hana|charlotte") == text_query::any_of({text_query::substring("hana"), text_query::substring("charlotte")}));
+	REQUIRE(regex_to_query<3>("hana|c") == text_query::everything());
+	REQUIRE(regex_to_query<3>("abc(def|ghi)+x*jkl") == text_query::all_of({text_query::substring("abc"), text_query::any_of({text_query::substring("def"), text_query::substring("ghi")}), text_query::substring("jkl")}));
+	REQUIRE(regex_to_query<3>("abc(def)?jkl") == text_query::all_of({text_query::substring("abc"), text_query::substring("jkl")}));
+	REQUIRE(regex_to_query<3>("ab+cd") == text_query::all_of({text_query::substring("bcd")}));
+	REQUIRE(regex_to_query<3>("hello\\.world\\d+") == text_query::substring("hello.world"));
+	REQUIRE(regex_to_query<3>("[abc]+def[^x]") == text_query::substring("def"));
+	REQUIRE(regex_to_query<3>("(abc") == text_query::everything());
+
+	// only {1} and {1,1} are exactly once
+	REQUIRE(regex_to_query<3>("ab{1,3}cd") == text_query::all_of({text_query::substring("bcd")}));
+	REQUIRE(regex_to_query<3>("ab{1,}cd") == text_query::all_of({text_query::substring("bcd")}));
+	REQUIRE(regex_to_query<3>("ab{1}cd") == text_query::substring("abcd"));
+	REQUIRE(regex_to_query<3>("ab{1,1}cd") == text_query::substring("abcd"));
+	REQUIRE(regex_to_query<3>("ab{0,2}cd") == text_query::everything());
+	REQUIRE(regex_to_query<3>("ab{x}cd") == text_query::substring("ab{x}cd"));
+
+	// control escapes are their characters
+	REQUIRE(regex_to_query<3>("foo\\nbar") == text_query::substring("foo\nbar"));
+	REQUIRE(regex_to_query<3>("a\\tb\\rc\\fd\\ve\\0f") == text_query::substring(std::string{"a\tb\rc\fd\ve\0f", 11z}));
+
+	// arguments of escapes are not literals
+	REQUIRE(regex_to_query<3>("abc\\x41def") == text_query::substring("abcAdef"));
+	REQUIRE(regex_to_query<3>("abc\\u0041def") == text_query::substring("abcAdef"));
+	REQUIRE(regex_to_query<3>("abc\\u{41}def") == text_query::substring("abcAdef"));
+	REQUIRE(regex_to_query<3>("abc\\u00e1def") == text_query::all_of({text_query::substring("abc"), text_query::substring("def")}));
+	REQUIRE(regex_to_query<3>("abc\\cJdef") == text_query::substring("abc\ndef"));
+	REQUIRE(regex_to_query<3>("(?<x>abc)\\k<x>def") == text_query::all_of({text_query::substring("def")}));
+	REQUIRE(regex_to_query<3>("(abc)\\12def") == text_query::all_of({text_query::substring("abc"), text_query::substring("def")}));
+
+	REQUIRE(glob_to_query<3>("*.cpp") == text_query::substring(".cpp"));
+	REQUIRE(glob_to_query<3>("src/*/test?.[ch]pp") == text_query::all_of({text_query::substring("src/"), text_query::substring("/test")}));
+
+	// query can be computed at compile-time
+	static_assert([] { return regex_to_query<4>("charlotte|hana is").children.size(); }() == 2z);
+}
+
+TEST_CASE("regex prefilter keeps all matches") {
+	std::vector<std::string> strings{"abbcd", "abcAdef", "foo\nbar", "abcd", "abcdef"};
+
+	using iterator = std::vector<std::string>::iterator;
+	ctdb::simple_fulltext_reverse_index<iterator, 3> index;
+
+	for (auto it = strings.begin(); it != strings.end(); ++it) {
+		index.emplace(std::string_view{*it}, it);
+	}
+
+	for (const std::string_view pattern: {"ab{1,3}cd"sv, "ab{1,}cd"sv, "abc\\x41def"sv, "abc\\u0041def"sv, "foo\\nbar"sv, "foo\\cJbar"sv}) {
+		const auto re = std::regex(std::string(pattern));
+		const auto candidates = index.find_candidates(regex_to_query<3>(pattern));
+		REQUIRE(candidates);
+
+		for (auto it = strings.begin(); it != strings.end(); ++it) {
+			if (std::regex_search(*it, re)) {
+				REQUIRE(std::ranges::find(*candidates, it) != candidates->end());
+			}
+		}
+	}
+}
+
+TEST_CASE("simple fulltext (regex prefilter)") {
+	std::vector<std::string> strings{"xxcharlotte", "pokus", "hana is owner of charlotte the dog", "some charlatan", "charchar", "charcoal", "charlotte is the best dog", "šarlota is charlotte", "data and lore are androids"};
+
+	using iterator = std::vector<std::string>::iterator;
+	ctdb::simple_fulltext_reverse_index<iterator, 3> index;
+
+	for (auto it = strings.begin(); it != strings.end(); ++it) {
+		index.emplace(std::string_view{*it}, it);
+	}
+
+	auto search = [&](std::string_view pattern) {
+		const auto candidates = index.find_candidates(regex_to_query<3>(pattern));
+		const auto re = std::regex(std::string(pattern));
+
+		std::vector<std::string> result;
+		size_t checked = 0z;
+
+		auto check = [&](iterator it) {
+			++checked;
+			if (std::regex_search(*it, re)) {
+				result.emplace_back(*it);
+			}
+		};
+
+		if (candidates) {
+			for (auto it: *candidates) {
+				check(it);
+			}
+		} else {
+			for (auto it = strings.begin(); it != strings.end(); ++it) {
+				check(it);
+			}
+		}
+
+		std::sort(result.begin(), result.end());
+		return std::make_pair(result, checked);
+	};
+
+	{
+		const auto [result, checked] = search("char(lotte|coal)");
+		REQUIRE(result == std::vector<std::string>{"charcoal", "charlotte is the best dog", "hana is owner of charlotte the dog", "xxcharlotte", "šarlota is charlotte"});
+		REQUIRE(checked == 5z);
+	}
+
+	{
+		const auto [result, checked] = search("dog$");
+		REQUIRE(result == std::vector<std::string>{"charlotte is the best dog", "hana is owner of charlotte the dog"});
+		REQUIRE(checked == 2z);
+	}
+
+	{
+		const auto [result, checked] = search("cha.*dog");
+		REQUIRE(result == std::vector<std::string>{"charlotte is the best dog", "hana is owner of charlotte the dog"});
+		REQUIRE(checked == 2z);
+	}
+
+	{
+		// index can't help
+		const auto [result, checked] = search("^.o");
+		REQUIRE(result == std::vector<std::string>{"pokus", "some charlatan"});
+		REQUIRE(checked == strings.size());
+	}
+}
@@ -0,0 +1,86 @@
+#include <ctdb/indices/full-text-segment.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std::string_view_literals;
+
+TEST_CASE("fulltext segment file") {
+	std::vector<std::string> strings{"xxcharlotte", "pokus", "hana is owner of charlotte the dog", "some charlatan", "charchar", "-charchar", "charcoal", "charlotte is the best dog", "šarlota is charlotte", "charlotte is the charlotte"};
+
+	using iterator = std::vector<std::string>::iterator;
+
+	ctdb::simple_fulltext_reverse_index<iterator, 4> index;
+
+	for (auto it = strings.begin(); it != strings.end(); ++it) {
+		index.emplace(std::string_view{*it}, it);
+	}
+
+	// removed documents are not persisted
+	index.remove(strings.begin() + 1);
+
+	const auto id_of = [&](iterator it) { return static_cast<uint32_t>(it - strings.begin()); };
+
+	// unique name, so parallel runs of tests don't collide
+	const auto path = std::filesystem::temp_directory_path() / ("ctdb-fulltext-segment-test-" + std::to_string(std::random_device{}()) + ".seg");
+	const auto temporary = std::filesystem::path{path.string() + ".tmp"};
+
+	REQUIRE(ctdb::write_fulltext_segment(path, index, id_of));
+	REQUIRE_FALSE(std::filesystem::exists(temporary));
+
+	auto segment = ctdb::fulltext_segment<4>::open(path);
+	REQUIRE(segment.has_value());
+
+	REQUIRE(segment->document_count() == strings.size() - 1z);
+	REQUIRE(segment->find_all("pokus"sv).empty());
+
+	// same answers as the index it was written from
+	for (auto query: {"char"sv, "charlotte"sv, "lotte is"sv, "is the"sv, "lorem ipsum"sv, "best dog"sv, "šarlota"sv, "harc"sv}) {
+		std::vector<ctdb::fulltext_posting> expected{};
+
+		for (const auto & e: index.find_all(query)) {
+			expected.push_back(ctdb::fulltext_posting{id_of(e.pkey), e.position});
+		}
+
+		std::sort(expected.begin(), expected.end());
+
+		REQUIRE(segment->find_all(query) == expected);
+	}
+
+	REQUIRE(segment->find_all("charlotte is the"sv) == std::vector<ctdb::fulltext_posting>{{7u, 0u}, {9u, 0u}});
+
+	// segment can be opened more than once (and by more processes)
+	auto second = ctdb::fulltext_segment<4>::open(path);
+	REQUIRE(second.has_value());
+	REQUIRE(second->find_all("char"sv) == segment->find_all("char"sv));
+
+	// different ngram size is rejected
+	REQUIRE_FALSE(ctdb::fulltext_segment<3>::open(path).has_value());
+
+	// truncated file is rejected
+	const auto broken = std::filesystem::path{path.string() + ".broken"};
+	std::filesystem::copy_file(path, broken, std::filesystem::copy_options::overwrite_existing);
+	std::filesystem::resize_file(broken, std::filesystem::file_size(broken) - 1u);
+	REQUIRE_FALSE(ctdb::fulltext_segment<4>::open(broken).has_value());
+
+	REQUIRE_FALSE(ctdb::fulltext_segment<4>::open(path.string() + ".missing").has_value());
+
+	// failed rename (destination is a directory) doesn't leave the temporary file behind
+	const auto blocked = std::filesystem::path{path.string() + ".blocked"};
+	std::filesystem::create_directory(blocked);
+	std::filesystem::create_directory(blocked / "content");
+
+	REQUIRE_FALSE(ctdb::write_fulltext_segment(blocked, index, id_of));
+	REQUIRE_FALSE(std::filesystem::exists(blocked.string() + ".tmp"));
+
+	// and neither does failed write
+	REQUIRE_FALSE(ctdb::write_fulltext_segment(blocked / "missing" / "segment.seg", index, id_of));
+	REQUIRE_FALSE(std::filesystem::exists(blocked / "missing"));
+
+	std::filesystem::remove_all(blocked);
+	std::filesystem::remove(broken);
+	std::filesystem::remove(path);
+}
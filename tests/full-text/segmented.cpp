@@ -0,0 +1,94 @@
+#include <ctdb/indices/segmented-full-text.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std::string_view_literals;
+
+TEST_CASE("segmented fulltext") {
+	std::vector<std::string> strings{};
+
+	for (int i = 0; i != 400; ++i) {
+		strings.emplace_back("record number " + std::to_string(i) + ((i % 3) == 0 ? " charlotte" : " hana"));
+	}
+
+	using iterator = std::vector<std::string>::iterator;
+
+	ctdb::simple_fulltext_reverse_index<iterator, 4> reference;
+	ctdb::segmented_fulltext_reverse_index<iterator, 4> index{2z};
+
+	std::vector<std::pair<std::string_view, iterator>> documents;
+
+	for (auto it = strings.begin(); it != strings.end(); ++it) {
+		documents.emplace_back(*it, it);
+	}
+
+	reference.emplace_batch(documents);
+
+	// split into a few batches, each of them is split between threads
+	const auto step = documents.size() / 4z;
+
+	for (size_t i = 0z; i != 4z; ++i) {
+		index.emplace_batch(std::ranges::subrange(documents.begin() + static_cast<std::ptrdiff_t>(i * step), documents.begin() + static_cast<std::ptrdiff_t>((i + 1z) * step)), 3z);
+
+		// readers always see consistent results
+		REQUIRE(index.find_all("charlotte"sv).size() == (i + 1z) * step / 3z + ((i + 1z) * step % 3z != 0z));
+	}
+
+	index.wait_for_merges();
+
+	// 12 segments with merge factor 2 => all are merged into less segments
+	REQUIRE(index.segment_count() < 12z);
+	REQUIRE(index.ngram_count() == reference.ngram_count());
+
+	REQUIRE(index.find_all("charlotte"sv) == reference.find_all("charlotte"sv));
+	REQUIRE(index.find_all("number 12"sv) == reference.find_all("number 12"sv));
+	REQUIRE(index.find_all("number 12"sv).size() == 11z);
+	REQUIRE(index.find_all("nothing"sv).empty());
+}
+
+TEST_CASE("segmented fulltext (single documents)") {
+	std::vector<std::string> strings{};
+
+	for (int i = 0; i != 100; ++i) {
+		strings.emplace_back("record number " + std::to_string(i) + ((i % 3) == 0 ? " charlotte" : " hana"));
+	}
+
+	using iterator = std::vector<std::string>::iterator;
+
+	ctdb::simple_fulltext_reverse_index<iterator, 4> reference;
+	ctdb::segmented_fulltext_reverse_index<iterator, 4> index{2z, 16z};
+	ctdb::support::work_stealing_pool pool{2z};
+
+	for (auto it = strings.begin(); it != strings.end(); ++it) {
+		reference.emplace(std::string_view{*it}, it);
+		index.emplace(*it, it);
+
+		// pending documents are found at once
+		REQUIRE(index.find_all("charlotte"sv) == reference.find_all("charlotte"sv));
+	}
+
+	// only full pending segments were published
+	index.wait_for_merges();
+	REQUIRE(index.segment_count() < 100z / 16z);
+
+	index.flush();
+	index.wait_for_merges();
+
+	REQUIRE(index.ngram_count() == reference.ngram_count());
+	REQUIRE(index.find_all("number 12"sv) == reference.find_all("number 12"sv));
+
+	// batch is built by tasks of the given pool
+	std::vector<std::pair<std::string_view, iterator>> documents;
+
+	for (auto it = strings.begin(); it != strings.end(); ++it) {
+		documents.emplace_back(*it, it);
+	}
+
+	ctdb::segmented_fulltext_reverse_index<iterator, 4> batched{};
+	batched.emplace_batch(documents, 0z, &pool);
+
+	REQUIRE(batched.segment_count() == 2z);
+	REQUIRE(batched.find_all("charlotte"sv) == reference.find_all("charlotte"sv));
+}
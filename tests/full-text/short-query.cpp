@@ -0,0 +1,109 @@
+#include <ctdb/indices/full-text.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+#include <vector>
+
+using namespace std::string_view_literals;
+
+namespace {
+
+using iterator = std::vector<std::string>::iterator;
+
+auto brute_force(std::vector<std::string> & strings, std::string_view query) {
+	std::set<ctdb::fulltext_entry<iterator>> result{};
+
+	for (auto it = strings.begin(); it != strings.end(); ++it) {
+		for (auto pos = it->find(query); pos != std::string::npos; pos = it->find(query, pos + 1z)) {
+			result.emplace(it, static_cast<unsigned>(pos));
+		}
+	}
+
+	return result;
+}
+
+} // namespace
+
+TEST_CASE("simple fulltext (short queries)") {
+	std::vector<std::string> strings{"xxcharlotte", "pokus", "hana is owner of charlotte the dog", "ab", "c", "some charlatan", "charchar", "charlotte is the best dog", "šarlota"};
+
+	ctdb::simple_fulltext_reverse_index<iterator, 4, 2> index;
+	ctdb::simple_fulltext_reverse_index<iterator, 4> without_short;
+
+	std::vector<std::pair<std::string_view, iterator>> documents;
+
+	for (auto it = strings.begin(); it != strings.end(); ++it) {
+		documents.emplace_back(*it, it);
+	}
+
+	index.emplace_batch(documents);
+	without_short.emplace_batch(documents);
+
+	// overhead of tails is reported and limited to N - MinQuery postings per document ("c" has none)
+	REQUIRE(index.ngram_count() > without_short.ngram_count());
+	REQUIRE(index.ngram_count() - without_short.ngram_count() <= 2z * strings.size());
+	REQUIRE(index.ngram_known() > without_short.ngram_known());
+
+	REQUIRE(without_short.find_all("og"sv).empty());
+	REQUIRE(index.find_all("og"sv).size() == 2z);
+
+	// queries shorter than MinQuery are not answered
+	REQUIRE(index.find_all("c"sv).empty());
+
+	for (const auto & str: strings) {
+		for (size_t length = 2z; length != 5z; ++length) {
+			for (size_t pos = 0z; pos + length <= str.size(); ++pos) {
+				const auto query = std::string_view{str}.substr(pos, length);
+				const auto expected = brute_force(strings, query);
+				REQUIRE(index.find_all(query) == expected);
+
+				// lazy search gives same matches
+				REQUIRE(index.search(query).count() == expected.size());
+				REQUIRE(index.search(query).exists() == !expected.empty());
+			}
+		}
+	}
+
+	REQUIRE(index.find_documents("ab"sv).size() == 1z);
+	REQUIRE(index.find_documents(ctdb::support::text_query::all_of({ctdb::support::text_query::substring("og"), ctdb::support::text_query::substring("best")})).size() == 1z);
+
+	// removal of a document removes its tails too
+	index.remove(strings.begin() + 3);
+	REQUIRE(index.find_all("ab"sv).empty());
+
+	const auto before = index.ngram_count();
+	index.compact();
+	REQUIRE(index.ngram_count() == before - 1z);
+
+	index.remove(std::string_view{strings[2]}, strings.begin() + 2);
+	REQUIRE(index.find_all("og"sv).size() == 1z);
+	REQUIRE(index.search("og"sv).count() == 1z);
+}
+
+TEST_CASE("simple fulltext (lazy short queries)") {
+	std::vector<std::string> strings{"hana", "charlotte", "ha"};
+
+	ctdb::simple_fulltext_reverse_index<iterator, 3, 1> index;
+
+	for (auto it = strings.begin(); it != strings.end(); ++it) {
+		index.emplace(std::string_view{*it}, it);
+	}
+
+	REQUIRE(index.find_all("ha"sv).size() == 3z);
+	REQUIRE(index.search("ha"sv).count() == 3z);
+	REQUIRE(index.search("ha"sv).exists());
+	REQUIRE(index.search("ha"sv).limit(2z).count() == 2z);
+	REQUIRE(index.search("h"sv).count() == 3z);
+	REQUIRE_FALSE(index.search("x"sv).exists());
+
+	std::set<ctdb::fulltext_entry<iterator>> found{};
+
+	for (const auto & e: index.search("a"sv)) {
+		found.insert(e);
+	}
+
+	REQUIRE(found == index.find_all("a"sv));
+
+	// removed documents are skipped
+	index.remove(strings.begin());
+	REQUIRE(index.search("ha"sv).count() == 2z);
+}
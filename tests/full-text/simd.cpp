@@ -0,0 +1,100 @@
+#include <ctdb/indices/full-text.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace ctdb::support;
+using namespace std::string_view_literals;
+
+template <size_t N> void check_packing(std::string_view input) {
+	const size_t count = ngram_generate_count<N>(input.size());
+
+	std::vector<uint64_t> expected{};
+
+	for (auto ng: view_as_ngrams<N>(input)) {
+		expected.emplace_back(pack_ngram(ng.value));
+	}
+
+	std::vector<uint64_t> scalar(count);
+	REQUIRE(pack_ngrams_scalar<N>(input, scalar.data()) == count);
+	REQUIRE(scalar == expected);
+
+	std::vector<uint64_t> dispatched(count);
+	REQUIRE(pack_ngrams<N>(input, dispatched.data()) == count);
+	REQUIRE(dispatched == expected);
+}
+
+TEST_CASE("pack all ngrams of a document") {
+	std::mt19937 rng{42};
+
+	for (size_t length = 0z; length != 80z; ++length) {
+		std::string input{};
+
+		for (size_t i = 0z; i != length; ++i) {
+			// including non-ascii characters
+			input += static_cast<char>(rng() % 256u);
+		}
+
+		check_packing<1>(input);
+		check_packing<2>(input);
+		check_packing<3>(input);
+		check_packing<4>(input);
+		check_packing<5>(input);
+		check_packing<6>(input);
+		check_packing<7>(input);
+		check_packing<8>(input);
+	}
+}
+
+TEST_CASE("find substring") {
+	const auto text = "this is really long text, this is really long text, this is really long text, lorem ipsum, whatever, hana"sv;
+
+	for (auto needle: {"hana"sv, "this"sv, "lorem ipsum"sv, "text, lorem"sv, "nothing"sv, "t"sv, ""sv, "a"sv, "ha"sv, "whatever, hana"sv, "hanah"sv}) {
+		REQUIRE(find_substring(text, needle) == text.find(needle));
+	}
+
+	std::mt19937 rng{7};
+
+	for (int i = 0; i != 200; ++i) {
+		std::string haystack{};
+		std::string needle{};
+
+		for (unsigned j = rng() % 100u; j != 0u; --j) {
+			haystack += "ab"[rng() % 2u];
+		}
+
+		for (unsigned j = rng() % 6u; j != 0u; --j) {
+			needle += "ab"[rng() % 2u];
+		}
+
+		REQUIRE(find_substring(haystack, needle) == std::string_view{haystack}.find(needle));
+	}
+
+	REQUIRE(matches_at("charlotte", "lotte", 4));
+	REQUIRE(!matches_at("charlotte", "lotte", 3));
+	REQUIRE(!matches_at("charlotte", "lotte", 5));
+	REQUIRE(!matches_at("charlotte", "lotte", 20));
+}
+
+TEST_CASE("simple fulltext (verified results)") {
+	std::vector<std::string> strings{"xxcharlotte", "hana is owner of charlotte the dog", "charlotte is the best dog"};
+
+	using iterator = std::vector<std::string>::iterator;
+	ctdb::simple_fulltext_reverse_index<iterator, 4> index;
+
+	for (auto it = strings.begin(); it != strings.end(); ++it) {
+		index.emplace(std::string_view{*it}, it);
+	}
+
+	REQUIRE(index.find_verified("charlotte"sv).size() == 3z);
+
+	// record was modified behind the index's back
+	strings[0] = "xxcharlatan";
+
+	REQUIRE(index.find_all("charlotte"sv).size() == 3z);
+	REQUIRE(index.find_verified("charlotte"sv).size() == 2z);
+
+	const auto candidates = index.find_documents(ctdb::support::text_query::substring("dog"));
+	REQUIRE(index.filter_containing(candidates, "is the").size() == 1z);
+}
@@ -0,0 +1,86 @@
+#include <ctdb/indices/suffix-array.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std::string_view_literals;
+
+TEST_CASE("suffix array construction") {
+	std::mt19937 rng{3};
+
+	for (size_t length = 0z; length < 300z; length += 7z) {
+		for (const unsigned alphabet: {2u, 4u, 26u}) {
+			std::string input{};
+
+			for (size_t i = 0z; i != length; ++i) {
+				input += static_cast<char>('a' + rng() % alphabet);
+			}
+
+			std::vector<int32_t> expected(input.size());
+
+			for (size_t i = 0z; i != input.size(); ++i) {
+				expected[i] = static_cast<int32_t>(i);
+			}
+
+			std::sort(expected.begin(), expected.end(), [&](int32_t lhs, int32_t rhs) { return std::string_view{input}.substr(static_cast<size_t>(lhs)) < std::string_view{input}.substr(static_cast<size_t>(rhs)); });
+
+			REQUIRE(ctdb::support::build_suffix_array(input) == expected);
+		}
+	}
+}
+
+TEST_CASE("suffix array index") {
+	std::vector<std::string> strings{"xxcharlotte", "pokus", "hana is owner of charlotte the dog", "some charlatan", "charchar", "-charchar", "charcoal", "charlotte is the best dog", "šarlota is charlotte", "charlotte is the charlotte", "data and lore are androids"};
+
+	using iterator = std::vector<std::string>::iterator;
+
+	ctdb::simple_fulltext_reverse_index<iterator, 4> ngrams;
+	ctdb::suffix_array_index<iterator> index;
+
+	std::vector<std::pair<std::string_view, iterator>> documents;
+
+	for (auto it = strings.begin(); it != strings.end(); ++it) {
+		documents.emplace_back(*it, it);
+	}
+
+	ngrams.emplace_batch(documents);
+	index.emplace_batch(documents);
+
+	REQUIRE(index.size() == strings.size());
+
+	// same answers as ngram index
+	for (auto query: {"char"sv, "charlotte"sv, "lotte is"sv, "is the"sv, "lorem ipsum"sv, "best dog"sv, "androids"sv, "šarlota"sv}) {
+		REQUIRE(index.find_all(query) == ngrams.find_all(query));
+	}
+
+	// but it can find queries shorter than N
+	REQUIRE(ngrams.find_all("og"sv).empty());
+	REQUIRE(index.find_all("og"sv).size() == 2z);
+	REQUIRE(index.find_all("a"sv).size() == 24z);
+	REQUIRE(index.find_all(""sv).empty());
+
+	// match can't cross documents
+	REQUIRE(index.find_all("pokus\0hana"sv).empty());
+	REQUIRE(index.find_all("xxcharlotte"sv).size() == 1z);
+
+	for (const auto & e: index.find_all("is"sv)) {
+		REQUIRE(std::string_view{*e.pkey}.substr(e.position, 2z) == "is");
+	}
+
+	// removal
+	index.remove(strings.begin() + 2);
+	REQUIRE(index.find_all("dog"sv).size() == 1z);
+	REQUIRE(index.size() == strings.size() - 1z);
+
+	index.compact();
+	REQUIRE(index.find_all("dog"sv).size() == 1z);
+	REQUIRE(index.find_all("hana"sv).empty());
+	REQUIRE(index.documents.size() == strings.size() - 1z);
+
+	// emplace single document
+	index.emplace("hana", strings.begin() + 2);
+	REQUIRE(index.find_all("hana"sv).size() == 1z);
+	REQUIRE(index.find_all("hana"sv).begin()->position == 0u);
+}
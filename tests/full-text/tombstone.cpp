@@ -0,0 +1,88 @@
+#include <ctdb/indices/full-text.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <list>
+#include <string>
+
+using namespace std::string_view_literals;
+
+TEST_CASE("simple fulltext (tombstones)") {
+	std::list<std::string> strings;
+
+	ctdb::simple_fulltext_reverse_index<decltype(strings)::iterator, 4> index;
+
+	auto add = [&](std::string_view in) {
+		const auto it = strings.emplace(strings.end(), in);
+		index.emplace(in, it);
+		return it;
+	};
+
+	add("xxcharlotte");
+	add("pokus");
+	const auto a = add("hana is owner of charlotte the dog");
+	add("some charlatan");
+	const auto b = add("charchar");
+	add("charlotte is the best dog");
+
+	const auto known = index.ngram_known();
+	const auto count = index.ngram_count();
+
+	REQUIRE(index.find_all("char"sv).size() == 6z);
+	REQUIRE(index.search("charlotte"sv).count() == 3z);
+
+	// removal doesn't need the text of the record anymore
+	index.remove(a);
+	index.remove(b);
+	strings.erase(a);
+	strings.erase(b);
+
+	REQUIRE(index.removed_count() == 2z);
+
+	// postings are still there, but they are filtered out
+	REQUIRE(index.ngram_count() == count);
+	REQUIRE(index.find_all("char"sv).size() == 3z);
+	REQUIRE(index.search("char"sv).count() == 3z);
+	REQUIRE(index.search("charlotte"sv).count() == 2z);
+	REQUIRE(index.find_documents("dog"sv).empty());
+	REQUIRE(index.find_documents("best dog"sv).size() == 1z);
+	REQUIRE(index.find_fuzzy("charlotte", 0).size() == 2z);
+	REQUIRE(index.find_top_k("charlotte"sv, 10z).size() == 3z);
+
+	index.compact();
+
+	REQUIRE(index.removed_count() == 0z);
+	REQUIRE(index.ngram_count() == count - 31z - 5z);
+	REQUIRE(index.ngram_known() < known);
+
+	REQUIRE(index.find_all("char"sv).size() == 3z);
+	REQUIRE(index.search("charlotte"sv).count() == 2z);
+
+	// the index must give same answers as the one which never saw removed documents
+	ctdb::simple_fulltext_reverse_index<decltype(strings)::iterator, 4> fresh;
+
+	for (auto it = strings.begin(); it != strings.end(); ++it) {
+		fresh.emplace(std::string_view{*it}, it);
+	}
+
+	REQUIRE(index.data == fresh.data);
+	REQUIRE(index.ngram_count() == fresh.ngram_count());
+}
+
+TEST_CASE("simple fulltext (tombstones with reused address)") {
+	std::list<std::string> strings;
+
+	ctdb::simple_fulltext_reverse_index<decltype(strings)::iterator, 4> index;
+
+	const auto a = strings.emplace(strings.end(), "charlotte");
+	index.emplace("charlotte"sv, a);
+
+	index.remove(a);
+
+	// fake reuse of the same record for another document
+	*a = "hana";
+	index.emplace("hana"sv, a);
+
+	REQUIRE(index.removed_count() == 0z);
+	REQUIRE(index.find_all("char"sv).empty());
+	REQUIRE(index.find_all("hana"sv).size() == 1z);
+	REQUIRE(index.ngram_count() == 1z);
+}
@@ -0,0 +1,183 @@
+#include <ctdb/indices/full-text.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std::string_view_literals;
+
+namespace {
+
+using iterator = std::vector<std::string>::iterator;
+using index_type = ctdb::simple_fulltext_reverse_index<iterator, 3>;
+
+auto random_corpus(size_t size, unsigned seed) {
+	const std::vector<std::string_view> words{"charlotte", "dog", "hana", "owner", "best", "charlatan", "char", "coal", "lotte", "is", "the", "data", "lore", "android"};
+
+	std::mt19937 rng{seed};
+	std::vector<std::string> result{};
+
+	for (size_t i = 0z; i != size; ++i) {
+		std::string text{};
+		const size_t count = 1z + rng() % 12u;
+
+		for (size_t w = 0z; w != count; ++w) {
+			text += words[rng() % words.size()];
+			text += ' ';
+		}
+
+		result.push_back(text);
+	}
+
+	return result;
+}
+
+// scores of all documents computed directly from texts
+auto brute_force(const std::vector<std::string> & corpus, std::string_view query) {
+	const auto ngrams_of = [](std::string_view text) {
+		std::map<std::string_view, unsigned> result{};
+
+		for (size_t i = 0z; i + 3z <= text.size(); ++i) {
+			++result[text.substr(i, 3z)];
+		}
+
+		return result;
+	};
+
+	std::map<std::string_view, unsigned> df{};
+	double total = 0.0;
+
+	for (const auto & text: corpus) {
+		for (const auto & [ngram, tf]: ngrams_of(text)) {
+			++df[ngram];
+		}
+
+		total += static_cast<double>(text.size() - 2z);
+	}
+
+	const double documents = static_cast<double>(corpus.size());
+	const double average = total / documents;
+
+	std::vector<double> scores{};
+
+	for (const auto & text: corpus) {
+		const auto tfs = ngrams_of(text);
+		double score = 0.0;
+
+		for (const auto & [ngram, qf]: ngrams_of(query)) {
+			const auto it = tfs.find(ngram);
+
+			if (it == tfs.end()) {
+				continue;
+			}
+
+			const double idf = std::log(1.0 + (documents - df[ngram] + 0.5) / (df[ngram] + 0.5));
+			const double tf = it->second;
+			const double length = static_cast<double>(text.size() - 2z);
+
+			score += idf * qf * tf * 2.2 / (tf + 1.2 * (0.25 + 0.75 * length / average));
+		}
+
+		if (score > 0.0) {
+			scores.push_back(score);
+		}
+	}
+
+	std::sort(scores.begin(), scores.end(), std::greater<>{});
+
+	return scores;
+}
+
+} // namespace
+
+TEST_CASE("simple fulltext (statistics)") {
+	auto corpus = random_corpus(200z, 1u);
+
+	index_type batch;
+	index_type one_by_one;
+
+	std::vector<std::pair<std::string_view, iterator>> documents;
+
+	for (auto it = corpus.begin(); it != corpus.end(); ++it) {
+		documents.emplace_back(*it, it);
+		one_by_one.emplace(std::string_view{*it}, it);
+	}
+
+	batch.emplace_batch(documents);
+
+	REQUIRE(batch.document_count() == corpus.size());
+	REQUIRE(batch.total_length == one_by_one.total_length);
+	REQUIRE(batch.statistics.size() == one_by_one.statistics.size());
+
+	for (const auto & [value, stats]: one_by_one.statistics) {
+		REQUIRE(batch.document_frequency(value) == stats.documents);
+		REQUIRE(batch.statistics.at(value).max_frequency == stats.max_frequency);
+	}
+
+	const auto df = [](const index_type & index, std::string_view in) { return index.document_frequency(ctdb::support::ngram<3>{in.data()}); };
+
+	const auto containing = [&](std::string_view in) { return static_cast<unsigned>(std::count_if(corpus.begin(), corpus.end(), [&](const std::string & text) { return text.find(in) != std::string::npos; })); };
+
+	REQUIRE(df(batch, "dog") == containing("dog"));
+	REQUIRE(df(batch, "cha") == containing("cha"));
+
+	// tombstones are subtracted from ngram statistics during compaction
+	size_t removed_dogs = 0z;
+
+	for (size_t i = 0z; i < corpus.size(); i += 3z) {
+		removed_dogs += (corpus[i].find("dog") != std::string::npos);
+		batch.remove(corpus.begin() + static_cast<ptrdiff_t>(i));
+	}
+
+	REQUIRE(batch.document_count() == corpus.size() - 67z);
+
+	batch.compact();
+	REQUIRE(df(batch, "dog") == containing("dog") - removed_dogs);
+
+	// eager removal updates them immediately
+	one_by_one.remove(std::string_view{corpus[1]}, corpus.begin() + 1);
+	REQUIRE(df(one_by_one, "dog") == containing("dog") - (corpus[1].find("dog") != std::string::npos));
+}
+
+TEST_CASE("simple fulltext (top-k)") {
+	auto corpus = random_corpus(500z, 2u);
+
+	index_type index;
+
+	std::vector<std::pair<std::string_view, iterator>> documents;
+
+	for (auto it = corpus.begin(); it != corpus.end(); ++it) {
+		documents.emplace_back(*it, it);
+	}
+
+	index.emplace_batch(documents);
+
+	for (auto query: {"charlotte"sv, "dog owner"sv, "hana the android"sv, "coal"sv, "xyz"sv, "best lore data"sv}) {
+		const auto expected = brute_force(corpus, query);
+
+		for (size_t k: {1z, 5z, 20z, 1000z}) {
+			const auto result = index.find_top_k(query, k);
+
+			REQUIRE(result.size() == std::min(k, expected.size()));
+
+			for (size_t i = 0z; i != result.size(); ++i) {
+				REQUIRE(std::abs(result[i].score - expected[i]) < 1e-9);
+			}
+		}
+	}
+
+	REQUIRE(index.find_top_k("charlotte"sv, 0z).empty());
+
+	// removed documents are never returned
+	const auto top = index.find_top_k("charlotte"sv, 3z);
+	REQUIRE(top.size() == 3z);
+
+	index.remove(top[0].pkey);
+
+	const auto next = index.find_top_k("charlotte"sv, 3z);
+	REQUIRE(next.size() == 3z);
+	REQUIRE(std::addressof(*next[0].pkey) != std::addressof(*top[0].pkey));
+}
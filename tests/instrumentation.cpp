@@ -0,0 +1,189 @@
+#include <ctdb/indices/full-text.hpp>
+#include <ctdb/table.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <list>
+#include <set>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+using namespace std::string_view_literals;
+
+// disabled instrumentation doesn't change anything
+using plain_table = ctdb::table<std::string, ctdb::sorted<std::string_view>>;
+
+static_assert(std::is_same_v<plain_table::primary_key, std::list<std::string>::iterator>);
+static_assert(std::is_same_v<decltype(plain_table::indices)::storage_type, ctdb::index_storage_of<ctdb::sorted<std::string_view>, plain_table::primary_key>>);
+static_assert(std::is_empty_v<ctdb::no_instrumentation>);
+static_assert(std::is_same_v<ctdb::instrumented_storage_t<std::set<int>, ctdb::no_instrumentation>, std::set<int>>);
+static_assert(sizeof(plain_table) == sizeof(std::list<std::string>) + sizeof(ctdb::indices_tuple<plain_table::primary_key, ctdb::sorted<std::string_view>>));
+
+TEST_CASE("instrumented table") {
+	ctdb::instrumented_table<std::string, ctdb::sorted<std::string_view>, ctdb::unique<std::string_view>> tbl;
+
+	REQUIRE(tbl.stats().comparisons == 0u);
+
+	REQUIRE(tbl.emplace("hana"));
+	REQUIRE(tbl.emplace("charlotte"));
+	REQUIRE(tbl.emplace("lotte"));
+	REQUIRE_FALSE(tbl.emplace("hana"));
+
+	const auto inserted = tbl.stats();
+
+	REQUIRE(inserted.comparisons != 0u);
+	REQUIRE(inserted.probes >= 4u);
+	REQUIRE(inserted.allocations != 0u);
+	REQUIRE(inserted.allocated_bytes >= inserted.allocations);
+	REQUIRE(inserted[ctdb::operation::insert].count == 4u);
+	REQUIRE(inserted[ctdb::operation::lookup].count == 0u);
+
+	// lookup by hashed index is a probe, by sorted index comparisons
+	REQUIRE(tbl.equal("charlotte"sv).size() == 1z);
+
+	const auto looked_up = tbl.stats();
+	REQUIRE(looked_up[ctdb::operation::lookup].count == 1u);
+	REQUIRE(looked_up.allocations == inserted.allocations);
+
+	// histogram and counters agree
+	uint64_t in_buckets = 0u;
+
+	for (const auto bucket: looked_up[ctdb::operation::insert].buckets) {
+		in_buckets += bucket;
+	}
+
+	REQUIRE(in_buckets == 4u);
+
+	const auto rng = tbl.equal("lotte"sv);
+	REQUIRE(tbl.erase(*rng.first));
+	REQUIRE(tbl.stats()[ctdb::operation::erase].count == 1u);
+
+	// copy has its own counters
+	auto copy = tbl;
+	REQUIRE(copy.stats()[ctdb::operation::insert].count == 0u);
+	REQUIRE(copy.equal("hana"sv).size() == 1z);
+	REQUIRE(tbl.stats()[ctdb::operation::lookup].count == 2u);
+
+	tbl.instrumentation.reset();
+	REQUIRE(tbl.stats().comparisons == 0u);
+	REQUIRE(tbl.stats()[ctdb::operation::insert].count == 0u);
+
+	// nothing is counted without instrumentation
+	plain_table plain;
+	plain.emplace("hana");
+	REQUIRE(plain.stats().comparisons == 0u);
+	REQUIRE(plain.stats()[ctdb::operation::insert].count == 0u);
+}
+
+TEST_CASE("instrumented fulltext index") {
+	std::vector<std::string> corpus{"charlotte the dog", "hana is the owner", "charlotte is the best", "coal"};
+
+	using iterator = std::vector<std::string>::iterator;
+
+	ctdb::simple_fulltext_reverse_index<iterator, 3, 3, ctdb::counting_instrumentation> index;
+
+	for (auto it = corpus.begin(); it != corpus.end(); ++it) {
+		index.emplace(std::string_view{*it}, it);
+	}
+
+	REQUIRE(index.stats()[ctdb::operation::insert].count == corpus.size());
+
+	// each ngram of the query is looked up once and intersected with the rest
+	REQUIRE(index.find_all("charlotte"sv).size() == 2z);
+
+	const auto stats = index.stats();
+	REQUIRE(stats[ctdb::operation::lookup].count == 1u);
+	REQUIRE(stats.probes == 7u);
+	REQUIRE(stats.intersections == 6u);
+	REQUIRE(stats.intersected_entries == 12u);
+
+	REQUIRE(index.find_documents("the"sv).size() == 3z);
+	REQUIRE(index.stats()[ctdb::operation::lookup].count == 2u);
+
+	index.remove(corpus.begin());
+	REQUIRE(index.stats()[ctdb::operation::erase].count == 1u);
+
+	// default index has no counters at all
+	ctdb::simple_fulltext_reverse_index<iterator, 3> plain;
+	plain.emplace(std::string_view{corpus[0]}, corpus.begin());
+	REQUIRE(plain.find_all("charlotte"sv).size() == 1z);
+	REQUIRE(plain.stats().probes == 0u);
+}
+
+TEST_CASE("memory usage of instrumented table") {
+	using table_type = ctdb::instrumented_table<std::string, ctdb::sorted<std::string_view>, ctdb::unique<std::string_view>>;
+
+	table_type tbl;
+
+	for (int i = 0; i != 100; ++i) {
+		tbl.emplace("record number " + std::to_string(i));
+	}
+
+	const auto usage = tbl.memory_usage();
+
+	// one node per record in the list and in each index (hashed index has also its buckets)
+	REQUIRE(usage.records.blocks == 100z);
+	REQUIRE(usage.records.bytes >= 100z * sizeof(std::string));
+	REQUIRE(usage.indices[0].blocks == 100z);
+	REQUIRE(usage.indices[1].blocks > 100z);
+	REQUIRE(usage.total() == usage.records + usage.indices[0] + usage.indices[1]);
+	REQUIRE(tbl.memory_usage<std::string_view>() == usage.indices[0]);
+
+	// copy has same shape, but its own memory
+	table_type copy = tbl;
+	REQUIRE(copy.memory_usage().records == usage.records);
+	REQUIRE(copy.memory_usage().indices[0] == usage.indices[0]);
+
+	while (tbl.size() != 0z) {
+		tbl.erase(tbl.content.begin());
+	}
+
+	const auto empty = tbl.memory_usage();
+	REQUIRE(empty.records == ctdb::memory_footprint{});
+	REQUIRE(empty.indices[0] == ctdb::memory_footprint{});
+	REQUIRE(copy.memory_usage().records == usage.records);
+
+	// batch uses same accounts
+	std::vector<std::string> batch{"a", "b", "c"};
+	copy.emplace_batch(batch);
+	REQUIRE(copy.memory_usage().records.blocks == 103z);
+
+	// moved table keeps its memory
+	const table_type moved = std::move(copy);
+	REQUIRE(moved.memory_usage().records.blocks == 103z);
+	REQUIRE(moved.memory_usage().indices[0].blocks == 103z);
+}
+
+TEST_CASE("memory usage of instrumented fulltext index") {
+	std::vector<std::string> corpus{"charlotte the dog", "hana is the owner", "charlotte is the best", "coal"};
+
+	using iterator = std::vector<std::string>::iterator;
+	using index_type = ctdb::simple_fulltext_reverse_index<iterator, 3, 2, ctdb::counting_instrumentation>;
+
+	index_type index;
+
+	for (auto it = corpus.begin(); it != corpus.end(); ++it) {
+		index.emplace(std::string_view{*it}, it);
+	}
+
+	const auto usage = index.memory_usage();
+
+	// each posting is one node, each ngram (or tail) one node of the dictionary
+	REQUIRE(usage.postings.blocks == index.ngram_count());
+	REQUIRE(usage.dictionary.blocks == index.ngram_known());
+	REQUIRE(usage.statistics.blocks != 0z);
+	REQUIRE(usage.total() == usage.dictionary + usage.postings + usage.statistics);
+
+	// copy builds its own postings
+	const index_type copy = index;
+	REQUIRE(copy.memory_usage().postings == usage.postings);
+	REQUIRE(copy.memory_usage().dictionary == usage.dictionary);
+	REQUIRE(copy.find_all("charlotte"sv).size() == 2z);
+
+	index.remove(corpus.begin());
+	index.compact();
+
+	REQUIRE(index.memory_usage().postings.blocks == index.ngram_count());
+	REQUIRE(index.memory_usage().postings.bytes < usage.postings.bytes);
+	REQUIRE(copy.memory_usage().postings == usage.postings);
+}
@@ -0,0 +1,185 @@
+#include <ctdb/join.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace {
+
+struct customer {
+	unsigned id;
+	std::string name;
+
+	friend bool operator==(const customer &, const customer &) = default;
+
+	explicit operator unsigned() const noexcept {
+		return id;
+	}
+
+	explicit operator std::string_view() const noexcept {
+		return name;
+	}
+};
+
+struct order {
+	std::string code;
+	unsigned customer_id;
+
+	friend bool operator==(const order &, const order &) = default;
+
+	explicit operator std::string_view() const noexcept {
+		return code;
+	}
+
+	explicit operator unsigned() const noexcept {
+		return customer_id;
+	}
+};
+
+using matches = std::vector<std::pair<const void *, const void *>>;
+
+// nested loop over all records
+template <typename Left, typename Right> auto expected_matches(const Left & left, const Right & right) {
+	matches result{};
+
+	for (const auto & l: left.all()) {
+		for (const auto & r: right.all()) {
+			if (static_cast<unsigned>(l) == static_cast<unsigned>(r)) {
+				result.emplace_back(&l, &r);
+			}
+		}
+	}
+
+	std::ranges::sort(result);
+	return result;
+}
+
+template <typename Range> auto found_matches(const Range & range) {
+	matches result{};
+
+	for (const auto & [l, r]: range) {
+		REQUIRE(static_cast<unsigned>(l) == static_cast<unsigned>(r));
+		result.emplace_back(&l, &r);
+	}
+
+	std::ranges::sort(result);
+	return result;
+}
+
+template <typename Customers, typename Orders> void fill(Customers & customers, Orders & orders, unsigned customer_count, unsigned order_count, bool duplicates) {
+	std::mt19937 rng{7u};
+
+	for (unsigned i = 0u; i != customer_count; ++i) {
+		// every third id is missing and (optionally) every fifth is there twice
+		if (i % 3u != 1u) {
+			customers.emplace(i, "customer " + std::to_string(i));
+		}
+
+		if (duplicates && i % 5u == 0u) {
+			customers.emplace(i, "other customer " + std::to_string(i));
+		}
+	}
+
+	for (unsigned i = 0u; i != order_count; ++i) {
+		// some orders don't belong to any customer
+		orders.emplace("order " + std::to_string(i), static_cast<unsigned>(rng() % (customer_count + 10u)));
+	}
+}
+
+} // namespace
+
+TEST_CASE("merge join of sorted indices") {
+	ctdb::table<customer, ctdb::sorted<unsigned>> customers;
+	ctdb::table<order, ctdb::unique<std::string_view>, ctdb::sorted<unsigned>> orders;
+
+	// empty tables
+	REQUIRE(ctdb::join(customers, orders, ctdb::on<unsigned>).begin() == std::default_sentinel);
+
+	fill(customers, orders, 200u, 1000u, true);
+
+	const auto range = ctdb::join(customers, orders, ctdb::on<unsigned, unsigned>);
+	static_assert(decltype(range)::strategy == ctdb::join_strategy::merge);
+
+	REQUIRE(found_matches(range) == expected_matches(customers, orders));
+
+	// pairs come in order of the key
+	std::vector<unsigned> keys{};
+
+	for (const auto & [c, o]: range) {
+		keys.push_back(c.id);
+	}
+
+	REQUIRE(std::ranges::is_sorted(keys));
+
+	// tables swapped
+	const auto swapped = ctdb::join(orders, customers, ctdb::on<unsigned>);
+	REQUIRE(found_matches(swapped) == expected_matches(orders, customers));
+
+	// nothing is shared
+	ctdb::table<order, ctdb::unique<std::string_view>, ctdb::sorted<unsigned>> far_orders;
+	far_orders.emplace("far", 1'000'000u);
+
+	REQUIRE(ctdb::join(customers, far_orders, ctdb::on<unsigned>).begin() == std::default_sentinel);
+}
+
+TEST_CASE("hash join with unique index") {
+	ctdb::table<customer, ctdb::unique<unsigned>> customers;
+	ctdb::table<order, ctdb::unique<std::string_view>> orders;
+
+	fill(customers, orders, 300u, 2000u, false);
+
+	// orders are walked, customers are looked up
+	const auto range = ctdb::join(orders, customers, ctdb::on<unsigned>);
+	static_assert(decltype(range)::strategy == ctdb::join_strategy::hash);
+
+	REQUIRE(found_matches(range) == expected_matches(orders, customers));
+
+	// customers are looked up even when they are on the left side
+	const auto swapped = ctdb::join(customers, orders, ctdb::on<unsigned>);
+	static_assert(decltype(swapped)::strategy == ctdb::join_strategy::hash);
+
+	REQUIRE(found_matches(swapped) == expected_matches(customers, orders));
+
+	// hashed index is preferred over a sorted one
+	ctdb::table<order, ctdb::sorted<unsigned>> sorted_orders;
+
+	for (const order & o: orders.all()) {
+		sorted_orders.emplace(o);
+	}
+
+	const auto mixed = ctdb::join(sorted_orders, customers, ctdb::on<unsigned>);
+	static_assert(decltype(mixed)::strategy == ctdb::join_strategy::hash);
+
+	REQUIRE(found_matches(mixed) == expected_matches(sorted_orders, customers));
+}
+
+TEST_CASE("join with lookups into sorted index") {
+	ctdb::table<customer, ctdb::unique<std::string_view>> customers;
+	ctdb::table<order, ctdb::sorted<unsigned>> orders;
+
+	fill(customers, orders, 100u, 500u, false);
+
+	const auto range = ctdb::join(customers, orders, ctdb::on<unsigned>);
+	static_assert(decltype(range)::strategy == ctdb::join_strategy::index_lookup);
+
+	REQUIRE(found_matches(range) == expected_matches(customers, orders));
+
+	const auto swapped = ctdb::join(orders, customers, ctdb::on<unsigned>);
+	static_assert(decltype(swapped)::strategy == ctdb::join_strategy::index_lookup);
+
+	REQUIRE(found_matches(swapped) == expected_matches(orders, customers));
+
+	// after removals
+	for (auto it = orders.content.begin(); it != orders.content.end();) {
+		auto current = it++;
+
+		if (current->customer_id % 2u == 0u) {
+			REQUIRE(orders.erase(current));
+		}
+	}
+
+	REQUIRE(found_matches(range) == expected_matches(customers, orders));
+}
@@ -0,0 +1,206 @@
+#include <ctdb/table.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct reading {
+	std::string sensor;
+	unsigned value;
+	double weight;
+
+	friend bool operator==(const reading &, const reading &) = default;
+
+	explicit operator std::string_view() const noexcept {
+		return sensor;
+	}
+};
+
+using readings = ctdb::table<reading, ctdb::unique<std::string_view>, ctdb::scan_chunks>;
+
+auto fill(size_t count) {
+	readings tbl;
+
+	for (size_t i = 0z; i != count; ++i) {
+		tbl.emplace("sensor" + std::to_string(i), static_cast<unsigned>(i * 7919u % 1000u), 1.0 / static_cast<double>(i + 1z));
+	}
+
+	return tbl;
+}
+
+} // namespace
+
+TEST_CASE("parallel scan of a table") {
+	// more than `parallel_threshold`, so chunks are run by the pool
+	const auto tbl = fill(30'000z);
+	ctdb::support::work_stealing_pool pool{4z};
+
+	std::vector<const reading *> expected{};
+
+	for (const reading & r: tbl.all()) {
+		if (r.value < 100u) {
+			expected.push_back(&r);
+		}
+	}
+
+	const auto pred = [](const reading & r) { return r.value < 100u; };
+
+	// same records in same order as a serial walk
+	std::vector<const reading *> found{};
+
+	for (const reading & r: tbl.scan(pred, &pool)) {
+		found.push_back(&r);
+	}
+
+	REQUIRE(found == expected);
+	REQUIRE(tbl.count_if(pred, &pool) == expected.size());
+	REQUIRE(tbl.count_if(pred) == expected.size());
+
+	// predicate really runs in more threads (chunks are independent tasks)
+	std::atomic<size_t> calls{0z};
+	const auto counted = tbl.scan([&](const reading &) { calls.fetch_add(1z, std::memory_order_relaxed); return true; }, &pool);
+
+	REQUIRE(calls.load() == tbl.size());
+	REQUIRE(counted.size() == tbl.size());
+
+	// non-associative reduction gives same result with any number of threads
+	const auto sum = [](double lhs, double rhs) { return lhs + rhs; };
+	const auto weight = [](const reading & r) { return r.weight; };
+
+	ctdb::support::work_stealing_pool other{2z};
+
+	const double parallel = tbl.reduce(0.0, sum, weight, &pool);
+	REQUIRE(parallel == tbl.reduce(0.0, sum, weight, &other));
+
+	unsigned total = 0u;
+
+	for (const reading & r: tbl.all()) {
+		total += r.value;
+	}
+
+	REQUIRE(tbl.reduce(0u, std::plus<>{}, [](const reading & r) { return r.value; }, &pool) == total);
+}
+
+TEST_CASE("scan of a small table") {
+	const auto empty = fill(0z);
+
+	REQUIRE(empty.scan([](const reading &) { return true; }).empty());
+	REQUIRE(empty.count_if([](const reading &) { return true; }) == 0z);
+	REQUIRE(empty.reduce(42u, std::plus<>{}, [](const reading & r) { return r.value; }) == 42u);
+
+	// under the threshold it is scanned by the calling thread
+	const auto tbl = fill(100z);
+	const auto caller = std::this_thread::get_id();
+
+	const auto found = tbl.scan([&](const reading & r) {
+		REQUIRE(std::this_thread::get_id() == caller);
+		return r.sensor.ends_with('7');
+	});
+
+	REQUIRE(found.size() == 10z);
+
+	for (const reading & r: found.descending()) {
+		REQUIRE(r.sensor.back() == '7');
+	}
+}
+
+TEST_CASE("scan after changes of a table") {
+	auto tbl = fill(20'000z);
+	ctdb::support::work_stealing_pool pool{3z};
+
+	std::vector<reading> batch{};
+
+	for (size_t i = 20'000z; i != 30'000z; ++i) {
+		batch.push_back(reading{"sensor" + std::to_string(i), static_cast<unsigned>(i % 1000u), 0.5});
+	}
+
+	// duplicate is refused, so records are inserted one by one
+	batch.push_back(reading{"sensor5", 0u, 0.5});
+	tbl.emplace_batch(batch, &pool);
+
+	// erase records at chunk boundaries too
+	size_t i = 0z;
+
+	for (auto it = tbl.content.begin(); it != tbl.content.end(); ++i) {
+		auto current = it++;
+
+		if (i % 3z == 0z) {
+			REQUIRE(tbl.erase(current));
+		}
+	}
+
+	const auto check = [&](const readings & t) {
+		std::vector<const reading *> expected{};
+
+		for (const reading & r: t.all()) {
+			expected.push_back(&r);
+		}
+
+		std::vector<const reading *> found{};
+
+		for (const reading & r: t.scan([](const reading &) { return true; }, &pool)) {
+			found.push_back(&r);
+		}
+
+		REQUIRE(found == expected);
+		REQUIRE(t.count_if([](const reading & r) { return r.value % 2u == 0u; }, &pool) == static_cast<size_t>(std::ranges::count_if(t.all(), [](const reading & r) { return r.value % 2u == 0u; })));
+	};
+
+	REQUIRE(tbl.size() == 20'000z);
+	check(tbl);
+
+	const auto copy = tbl;
+	check(copy);
+}
+
+TEST_CASE("scan of a table without chunks") {
+	ctdb::table<reading, ctdb::unique<std::string_view>> tbl;
+
+	for (size_t i = 0z; i != 10'000z; ++i) {
+		tbl.emplace("sensor" + std::to_string(i), static_cast<unsigned>(i % 1000u), 1.0);
+	}
+
+	ctdb::support::work_stealing_pool pool{4z};
+
+	// whole table is one chunk, so it's scanned by one thread
+	std::mutex lock{};
+	std::set<std::thread::id> threads{};
+
+	const auto found = tbl.scan([&](const reading & r) {
+		const std::lock_guard _{lock};
+		threads.insert(std::this_thread::get_id());
+		return r.value < 10u;
+	}, &pool);
+
+	REQUIRE(threads.size() == 1z);
+	REQUIRE(found.size() == 100z);
+	REQUIRE(tbl.count_if([](const reading & r) { return r.value < 10u; }, &pool) == 100z);
+	REQUIRE(tbl.reduce(0z, std::plus<>{}, [](const reading & r) { return static_cast<size_t>(r.value); }, &pool) == 10z * 499'500z);
+
+	std::vector<const reading *> expected{};
+
+	for (const reading & r: tbl.all()) {
+		if (r.value < 10u) {
+			expected.push_back(&r);
+		}
+	}
+
+	std::vector<const reading *> scanned{};
+
+	for (const reading & r: found) {
+		scanned.push_back(&r);
+	}
+
+	REQUIRE(scanned == expected);
+
+	// chunks don't change size of the table by more than the index
+	static_assert(sizeof(ctdb::table<reading, ctdb::scan_chunks>) == sizeof(ctdb::table<reading>) + sizeof(ctdb::index_storage_of<ctdb::scan_chunks, ctdb::table<reading>::primary_key>));
+}
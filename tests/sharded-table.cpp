@@ -0,0 +1,217 @@
+#include <ctdb/sharded-table.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct person {
+	std::string name;
+	unsigned age;
+
+	friend bool operator==(const person &, const person &) = default;
+
+	explicit operator std::string_view() const noexcept {
+		return name;
+	}
+
+	explicit operator unsigned() const noexcept {
+		return age;
+	}
+};
+
+using people = ctdb::sharded_table<person, 4, ctdb::unique<std::string_view>, ctdb::sorted<unsigned>>;
+
+} // namespace
+
+TEST_CASE("work stealing pool") {
+	ctdb::support::work_stealing_pool pool{3z};
+
+	std::vector<std::atomic<unsigned>> visited(1000z);
+
+	pool.parallel_for(visited.size(), [&](size_t i) { ++visited[i]; });
+
+	for (const auto & v: visited) {
+		REQUIRE(v.load() == 1u);
+	}
+
+	// nested calls are executed by waiting threads too
+	std::atomic<size_t> inner{0z};
+
+	pool.parallel_for(8z, [&](size_t) { pool.parallel_for(8z, [&](size_t) { ++inner; }); });
+
+	REQUIRE(inner.load() == 64z);
+
+	REQUIRE_THROWS_AS(pool.parallel_for(10z, [](size_t i) {
+		if (i == 7z) {
+			throw std::runtime_error{"task failed"};
+		}
+	}),
+		std::runtime_error);
+}
+
+TEST_CASE("sharded table") {
+	people tbl;
+
+	REQUIRE(tbl.emplace("hana", 32u));
+	REQUIRE(tbl.emplace("charlotte", 5u));
+	REQUIRE(tbl.emplace("jan", 40u));
+	REQUIRE(tbl.emplace("eva", 5u));
+	REQUIRE(tbl.emplace("adam", 18u));
+
+	// first index is unique across all shards
+	REQUIRE_FALSE(tbl.emplace("hana", 99u));
+
+	REQUIRE(tbl.size() == 5z);
+	REQUIRE(tbl.size<unsigned>() == 5z);
+	REQUIRE(tbl.all().size() == 5z);
+
+	const auto hana = tbl.equal(std::string_view{"hana"});
+	REQUIRE(hana.size() == 1z);
+	REQUIRE((*hana.begin()).age == 32u);
+
+	// secondary index is queried in all shards and merged in its order
+	std::vector<unsigned> ages{};
+
+	for (const person & p: tbl.all<unsigned>()) {
+		ages.push_back(p.age);
+	}
+
+	REQUIRE(ages == std::vector<unsigned>{5u, 5u, 18u, 32u, 40u});
+
+	ages.clear();
+
+	for (const person & p: tbl.all<unsigned>().descending()) {
+		ages.push_back(p.age);
+	}
+
+	REQUIRE(ages == std::vector<unsigned>{40u, 32u, 18u, 5u, 5u});
+
+	REQUIRE(tbl.equal(5u).size() == 2z);
+	REQUIRE(tbl.range(6u, 40u).size() == 2z);
+	REQUIRE(tbl.range(0u, 100u).size() == 5z);
+
+	REQUIRE(tbl.erase(hana.keys.front()));
+	REQUIRE(tbl.equal(std::string_view{"hana"}).empty());
+	REQUIRE(tbl.size() == 4z);
+	REQUIRE(tbl.emplace("hana", 33u));
+}
+
+TEST_CASE("sharded table (batch and concurrent writers)") {
+	people tbl;
+
+	std::vector<person> batch{};
+
+	for (unsigned i = 0u; i != 1000u; ++i) {
+		batch.push_back(person{"batch" + std::to_string(i), i % 100u});
+	}
+
+	// duplicate is refused by its shard
+	batch.push_back(person{"batch7", 1u});
+
+	REQUIRE(tbl.emplace_batch(batch) == 1000z);
+
+	{
+		std::vector<std::jthread> writers{};
+
+		for (unsigned t = 0u; t != 4u; ++t) {
+			writers.emplace_back([&tbl, t] {
+				for (unsigned i = 0u; i != 250u; ++i) {
+					tbl.emplace("writer" + std::to_string(t) + "-" + std::to_string(i), i);
+				}
+			});
+		}
+	}
+
+	REQUIRE(tbl.size() == 2000z);
+	REQUIRE(tbl.equal(42u).size() == 10z + 4z);
+
+	const auto sorted = tbl.all<unsigned>();
+	REQUIRE(sorted.size() == 2000z);
+	unsigned previous = 0u;
+
+	for (const person & p: sorted) {
+		REQUIRE(previous <= p.age);
+		previous = p.age;
+	}
+}
+
+namespace {
+
+struct email_view {
+	std::string_view value;
+
+	friend constexpr bool operator==(email_view, email_view) noexcept = default;
+	friend constexpr auto operator<=>(email_view, email_view) noexcept = default;
+};
+
+} // namespace
+
+template <> struct std::hash<email_view> {
+	size_t operator()(email_view e) const noexcept {
+		return std::hash<std::string_view>{}(e.value);
+	}
+};
+
+namespace {
+
+struct user {
+	std::string name;
+	std::string email;
+
+	friend bool operator==(const user &, const user &) = default;
+
+	explicit operator std::string_view() const noexcept {
+		return name;
+	}
+
+	explicit operator email_view() const noexcept {
+		return {email};
+	}
+};
+
+using users = ctdb::sharded_table<user, 8, ctdb::unique<std::string_view>, ctdb::unique<email_view>>;
+
+} // namespace
+
+TEST_CASE("sharded table (unique secondary index)") {
+	users tbl;
+
+	// names go to different shards, but email must be unique in all of them
+	size_t inserted = 0z;
+
+	for (int i = 0; i != 8; ++i) {
+		inserted += tbl.emplace(user{"user" + std::to_string(i), "same@example.com"}).has_value();
+	}
+
+	REQUIRE(inserted == 1z);
+	REQUIRE(tbl.equal(email_view{"same@example.com"}).size() == 1z);
+
+	std::vector<user> batch{};
+
+	for (int i = 0; i != 8; ++i) {
+		batch.push_back(user{"batch" + std::to_string(i), (i % 2 == 0) ? "even@example.com" : "odd@example.com"});
+	}
+
+	REQUIRE(tbl.emplace_batch(batch) == 2z);
+	REQUIRE(tbl.size() == 3z);
+
+	// concurrent writers can't insert same email either
+	{
+		std::vector<std::jthread> writers{};
+
+		for (int t = 0; t != 4; ++t) {
+			writers.emplace_back([&tbl, t] {
+				for (int i = 0; i != 50; ++i) {
+					tbl.emplace(user{"writer" + std::to_string(t) + "-" + std::to_string(i), "shared" + std::to_string(i) + "@example.com"});
+				}
+			});
+		}
+	}
+
+	REQUIRE(tbl.size() == 3z + 50z);
+}
@@ -0,0 +1,246 @@
+#include <ctdb/versioned-table.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+TEST_CASE("table copy") {
+	ctdb::table<std::string, ctdb::sorted<std::string_view>, ctdb::unique<std::string_view>> original;
+
+	original.emplace("b");
+	original.emplace("a");
+	original.emplace("c");
+
+	auto copy = original;
+
+	REQUIRE(copy.size() == 3z);
+	REQUIRE(copy.size<std::string_view>() == 3z);
+
+	// indices of the copy point to its own records
+	const auto rng = copy.equal(std::string_view{"a"});
+	REQUIRE(rng.size() == 1z);
+	REQUIRE(copy.erase(*rng.first));
+
+	REQUIRE(copy.size() == 2z);
+	REQUIRE(copy.equal(std::string_view{"a"}).size() == 0z);
+	REQUIRE(original.size() == 3z);
+	REQUIRE(original.equal(std::string_view{"a"}).size() == 1z);
+
+	REQUIRE_FALSE(copy.emplace("b").has_value());
+	REQUIRE(copy.emplace("a").has_value());
+}
+
+TEST_CASE("versioned table (snapshots)") {
+	ctdb::versioned_table<std::string, ctdb::unique_sorted<std::string_view>> tbl;
+
+	REQUIRE(tbl.emplace("hello"));
+	REQUIRE(tbl.emplace("there"));
+	REQUIRE_FALSE(tbl.emplace("hello"));
+
+	const auto before = tbl.snapshot();
+	REQUIRE(before->size() == 2z);
+
+	const auto version = tbl.version();
+
+	// both records are published together
+	tbl.update([](auto & t) {
+		t.emplace("hana");
+		t.emplace("charlotte");
+
+		const auto rng = t.equal(std::string_view{"hello"});
+		t.erase(*rng.first);
+	});
+
+	REQUIRE(tbl.version() == version + 1u);
+
+	// old snapshot doesn't change
+	REQUIRE(before->size() == 2z);
+	REQUIRE(before->equal(std::string_view{"hello"}).size() == 1z);
+
+	const auto after = tbl.snapshot();
+	REQUIRE(after->size() == 3z);
+	REQUIRE(after->equal(std::string_view{"hello"}).size() == 0z);
+	REQUIRE(after->equal(std::string_view{"hana"}).size() == 1z);
+
+	// failed transaction publishes nothing
+	try {
+		tbl.update([](auto & t) {
+			t.emplace("lost");
+			throw 42;
+		});
+	} catch (int) { }
+
+	REQUIRE(tbl.snapshot()->version() == after->version());
+	REQUIRE(tbl.snapshot()->equal(std::string_view{"lost"}).size() == 0z);
+}
+
+TEST_CASE("versioned table (nothing changed)") {
+	ctdb::versioned_table<std::string, ctdb::unique<std::string_view>> tbl;
+
+	REQUIRE(tbl.emplace("hello"));
+	REQUIRE(tbl.version() == 1u);
+
+	// refused record doesn't publish a new version
+	REQUIRE_FALSE(tbl.emplace("hello"));
+	REQUIRE(tbl.version() == 1u);
+
+	tbl.update([](auto & t) {
+		REQUIRE_FALSE(t.emplace("hello").has_value());
+	});
+
+	REQUIRE(tbl.version() == 1u);
+	REQUIRE(tbl.snapshot()->version() == 1u);
+	REQUIRE(tbl.size() == 1z);
+}
+
+TEST_CASE("versioned table (ordered queries)") {
+	ctdb::versioned_table<std::string, ctdb::sorted<std::string_view>> tbl;
+
+	tbl.update([](auto & t) {
+		for (const char * name: {"delta", "alpha", "charlie", "bravo", "alpha"}) {
+			t.emplace(name);
+		}
+	});
+
+	const auto snapshot = tbl.snapshot();
+
+	std::vector<std::string_view> sorted{};
+
+	for (const std::string & record: snapshot->all<std::string_view>()) {
+		sorted.emplace_back(record);
+	}
+
+	REQUIRE(sorted == std::vector<std::string_view>{"alpha", "alpha", "bravo", "charlie", "delta"});
+
+	std::vector<std::string_view> inserted{};
+
+	for (const std::string & record: snapshot->all()) {
+		inserted.emplace_back(record);
+	}
+
+	REQUIRE(inserted == std::vector<std::string_view>{"delta", "alpha", "charlie", "bravo", "alpha"});
+
+	REQUIRE(snapshot->equal(std::string_view{"alpha"}).size() == 2z);
+	REQUIRE(snapshot->range(std::string_view{"b"}, std::string_view{"d"}).size() == 2z);
+}
+
+namespace {
+
+struct counted {
+	static inline std::atomic<int> alive{0};
+
+	std::string name;
+
+	counted(std::string n): name{std::move(n)} {
+		++alive;
+	}
+
+	counted(const counted & other): name{other.name} {
+		++alive;
+	}
+
+	~counted() {
+		--alive;
+	}
+
+	explicit operator std::string_view() const noexcept {
+		return name;
+	}
+};
+
+} // namespace
+
+TEST_CASE("versioned table (reclamation)") {
+	{
+		ctdb::versioned_table<counted, ctdb::unique<std::string_view>> tbl;
+
+		tbl.update([](auto & t) {
+			for (int i = 0; i != 100; ++i) {
+				t.emplace("record" + std::to_string(i));
+			}
+		});
+
+		// records are shared by versions, they aren't copied
+		REQUIRE(counted::alive == 100);
+
+		{
+			const auto snapshot = tbl.snapshot();
+
+			tbl.update([](auto & t) {
+				t.erase(*t.template equal(std::string_view{"record0"}).first);
+			});
+
+			// snapshot can still see the removed record
+			REQUIRE(counted::alive == 100);
+			REQUIRE(snapshot->equal(std::string_view{"record0"}).size() == 1z);
+			REQUIRE((*snapshot->equal(std::string_view{"record0"}).begin()).name == "record0");
+		}
+
+		// removed record is released by a later writer
+		REQUIRE(tbl.emplace("another"));
+		REQUIRE(counted::alive == 100);
+
+		// record created and removed by same update is never published
+		tbl.update([](auto & t) {
+			const auto key = t.emplace("temporary");
+			REQUIRE(key.has_value());
+			REQUIRE(t.erase(*key));
+			REQUIRE_FALSE(t.erase(*key));
+		});
+
+		REQUIRE(counted::alive == 100);
+		REQUIRE(tbl.size() == 100z);
+	}
+
+	REQUIRE(counted::alive == 0);
+}
+
+TEST_CASE("versioned table (concurrent readers)") {
+	ctdb::versioned_table<std::string, ctdb::sorted<std::string_view>> tbl;
+
+	std::atomic<bool> done{false};
+	std::atomic<size_t> inconsistent{0z};
+
+	std::vector<std::thread> readers{};
+
+	for (int i = 0; i != 4; ++i) {
+		readers.emplace_back([&] {
+			while (!done.load()) {
+				const auto snapshot = tbl.snapshot();
+
+				// records are always added in pairs and index must see same records
+				if (snapshot->size() % 2z != 0z || snapshot->size<std::string_view>() != snapshot->size()) {
+					++inconsistent;
+				}
+
+				size_t count = 0z;
+
+				for ([[maybe_unused]] const auto & record: snapshot->all<std::string_view>()) {
+					++count;
+				}
+
+				if (count != snapshot->size()) {
+					++inconsistent;
+				}
+			}
+		});
+	}
+
+	for (int i = 0; i != 200; ++i) {
+		tbl.update([&](auto & t) {
+			t.emplace("left" + std::to_string(i));
+			t.emplace("right" + std::to_string(i));
+		});
+	}
+
+	done = true;
+
+	for (auto & t: readers) {
+		t.join();
+	}
+
+	REQUIRE(inconsistent == 0z);
+	REQUIRE(tbl.size() == 400z);
+}